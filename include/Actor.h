@@ -0,0 +1,71 @@
+#ifndef ZUTIL_CONCURRENT_ACTOR_H
+#define ZUTIL_CONCURRENT_ACTOR_H
+
+#include "ExecutorService.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#endif
+
+/**
+ * The header of a message, the first member of the message structures sent to actors. The mailbox links the
+ * messages through it, so sending allocates nothing. A message is owned by the actor from send to receive.
+ */
+typedef struct ActorMessage {
+    struct ActorMessage *next;
+} ActorMessage;
+
+typedef struct Actor Actor;
+
+/**
+ * The behavior of an actor, called for each message in the order of the mailbox. The calls of an actor never
+ * overlap, so the state needs no lock.
+ *
+ * @param state     the state of the actor.
+ * @param message   the received message.
+ */
+typedef void (*ActorReceive)(void *state, ActorMessage *message);
+
+/**
+ * New an actor. An actor owns no thread: its mailbox is a lock-free multi producer single consumer queue, and the
+ * actor is submitted to the executor only when its mailbox goes from empty to non-empty. Each run receives up to
+ * batchSize messages, then the actor is submitted again if messages are left, so that busy actors share the
+ * workers with the others. Idle actors cost a few dozen bytes each.
+ *
+ * Prefer an executor with an unbounded queue: a send waits while the executor queue is full, so actors sending to
+ * each other from all the workers at once could wait forever on a bounded one.
+ *
+ * @param executor  the executor which runs the actor, shared by any number of actors.
+ * @param receive   the behavior of the actor.
+ * @param state     the state of the actor, passed to receive.
+ * @param batchSize the maximum number of messages received per run, at least 1.
+ * @return          return NULL if failed.
+ */
+Actor *newActor(ExecutorService *executor, ActorReceive receive, void *state, size_t batchSize);
+
+/**
+ * Free the actor, which must be idle: no message pending, and not running, e.g. after the executor is shut down.
+ *
+ * @param actor     the actor.
+ */
+void freeActor(Actor *actor);
+
+/**
+ * Send a message to the actor, from any thread. Never waits, except while the executor rejects the actor because
+ * its queue is full.
+ *
+ * @param actor     the actor.
+ * @param message   the message, owned by the actor until it is received.
+ * @return          return false if the executor is shut down. The message stays in the mailbox, never received.
+ */
+bool sendActor(Actor *actor, ActorMessage *message);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_ACTOR_H
@@ -13,6 +13,8 @@ extern "C" {
 #define MAXIMUM_SIZE_T (~((size_t) (0)))
 #define BLOCKING_QUEUE_UNBOUNDED MAXIMUM_SIZE_T
 
+struct ConditionWaiter;
+
 typedef struct BlockingQueue {
 
     /**
@@ -24,6 +26,7 @@ typedef struct BlockingQueue {
 
     /**
      * Poll an item from the blocking queue. If the queue is empty, the function will be blocked until the queue is not empty or reaches its timeout.
+     * A closed queue still returns its remaining items, then fails without waiting.
      * 
      * @param queue         the blocking queue to poll from.
      * @param timeoutMs     the timeout represented in milliseconds. The timeoutMs == -1 means waiting
@@ -35,6 +38,7 @@ typedef struct BlockingQueue {
 
     /**
      * Offer an item to the blocking queue. If the queue is full, the function will be blocked until the queue is not full or reaches its timeout.
+     * Fails without waiting if the queue is closed.
      * 
      * @param queue         the blocking queue to queueOffer.
      * @param item          the address of the item to be queueOffer.
@@ -43,8 +47,134 @@ typedef struct BlockingQueue {
      * @return              return true if success.
      */
     bool (*const offer)(struct BlockingQueue *queue, void *item, long timeoutMs);
+
+    /**
+     * Tag the internal locks and conditions of the blocking queue for lock profiling. See LockProfiler.h.
+     *
+     * @param queue         the blocking queue.
+     * @param name          the name of the queue.
+     */
+    void (*const profile)(struct BlockingQueue *queue, const char *name);
+
+    /**
+     * Register a waiter which is notified whenever the queue may have become non-empty, see Condition.h. NULL if the
+     * queue cannot notify waiters.
+     *
+     * @param queue         the blocking queue.
+     * @param waiter        the waiter.
+     * @return              return false if failed.
+     */
+    bool (*const registerWaiter)(struct BlockingQueue *queue, struct ConditionWaiter *waiter);
+
+    /**
+     * Unregister a waiter registered by registerWaiter. NULL if the queue cannot notify waiters.
+     *
+     * @param queue         the blocking queue.
+     * @param waiter        the waiter.
+     */
+    void (*const unregisterWaiter)(struct BlockingQueue *queue, struct ConditionWaiter *waiter);
+
+    /**
+     * Close the blocking queue and wake up all the waiting threads: offers fail from now on, polls drain the remaining
+     * items and then fail. Closing twice does nothing.
+     *
+     * @param queue         the blocking queue.
+     */
+    void (*const close)(struct BlockingQueue *queue);
+
+    /**
+     * Check if the blocking queue is closed.
+     *
+     * @param queue         the blocking queue.
+     * @return              return true if closed.
+     */
+    bool (*const isClosed)(struct BlockingQueue *queue);
+
+    /**
+     * Poll up to maxItems items at once, under one acquisition of the lock. Waits like poll for the first item only.
+     * NULL if the queue cannot, see drainBlockingQueue.
+     *
+     * @param queue         the blocking queue.
+     * @param items         the writer buffer of maxItems items.
+     * @param maxItems      the maximum number of items.
+     * @param timeoutMs     the timeout represented in milliseconds, see poll.
+     * @return              the number of polled items, 0 if timeout, or closed and empty.
+     */
+    size_t (*const drain)(struct BlockingQueue *queue, void *items, size_t maxItems, long timeoutMs);
 } BlockingQueue;
 
+/**
+ * The order pollAnyBlockingQueue checks the queues in.
+ */
+typedef enum PollAnyOrder {
+    /* from the first queue, so an earlier queue always wins */
+    POLL_ANY_PRIORITY,
+    /* from the queue after *index, so passing the index of the previous poll rotates over the queues */
+    POLL_ANY_FAIR
+} PollAnyOrder;
+
+/**
+ * Poll an item from any of the queues, waiting on all of them at once if they are all empty. The queues must have
+ * the same item size. A queue without registerWaiter, e.g. a SharedMemoryQueue, is checked every millisecond.
+ * Fails without waiting once all the queues are closed and empty.
+ *
+ * @param queues        the blocking queues.
+ * @param size          the number of queues.
+ * @param index         the index of the queue the item is polled from, and the previous index for POLL_ANY_FAIR.
+ * @param item          the writer buffer.
+ * @param timeoutMs     the timeout represented in milliseconds, see BlockingQueue.poll.
+ * @param order         the order the queues are checked in.
+ * @return              return false if timeout or all the queues are closed.
+ */
+bool pollAnyBlockingQueue(BlockingQueue *const *queues, size_t size, size_t *index, void *item, long timeoutMs,
+                          PollAnyOrder order);
+
+/**
+ * Poll up to maxItems items at once with the drain of the queue, or with poll if it has none.
+ *
+ * @param queue         the blocking queue.
+ * @param items         the writer buffer of maxItems items.
+ * @param itemSize      the size of the item.
+ * @param maxItems      the maximum number of items.
+ * @param timeoutMs     the timeout for the first item, see BlockingQueue.poll.
+ * @return              the number of polled items, 0 if timeout, or closed and empty.
+ */
+size_t drainBlockingQueue(BlockingQueue *queue, void *items, size_t itemSize, size_t maxItems, long timeoutMs);
+
+typedef struct QueueEventFd QueueEventFd;
+
+/**
+ * Watch a queue with an eventfd, so that an epoll loop consumes it without blocking in poll. The eventfd becomes
+ * readable when the queue goes from empty to non-empty or is closed, and is written once until the next reset, not
+ * once per item. It is readable at first, for the items queued before.
+ *
+ * When the eventfd is readable, call resetQueueEventFd, then poll with timeoutMs == 0 until the queue is empty.
+ *
+ * @param queue     the blocking queue, which must support registerWaiter.
+ * @return          return NULL if failed or not supported, e.g. by a SharedMemoryQueue or a DelayQueue.
+ */
+QueueEventFd *newQueueEventFd(BlockingQueue *queue);
+
+/**
+ * Stop watching the queue, and close the eventfd.
+ *
+ * @param eventFd   the queue eventfd.
+ */
+void freeQueueEventFd(QueueEventFd *eventFd);
+
+/**
+ * @param eventFd   the queue eventfd.
+ * @return          the file descriptor to add to the epoll set, for EPOLLIN.
+ */
+int getQueueEventFd(QueueEventFd *eventFd);
+
+/**
+ * Consume the readiness, before draining the queue. An offer after the reset makes the eventfd readable again.
+ *
+ * @param eventFd   the queue eventfd.
+ */
+void resetQueueEventFd(QueueEventFd *eventFd);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,219 @@
+#ifndef ZUTIL_CONCURRENT_BLOCKINGQUEUE_HPP
+#define ZUTIL_CONCURRENT_BLOCKINGQUEUE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "BlockingQueue.h"
+#include "ArrayBlockingQueue.h"
+#include "Synchronizer.hpp"
+
+namespace zutil {
+
+    /**
+     * The builder of the C queue under a BlockingQueue of trivially copyable items.
+     */
+    using BlockingQueueBuilder = ::BlockingQueue *(*)(size_t capacity, size_t itemSize);
+
+    /**
+     * A typed blocking queue with move semantics. Trivially copyable items go through a C BlockingQueue, so any
+     * C implementation can be picked with the builder. Other items live in a ring of slots of this class,
+     * constructed in place by offer / emplace and moved out by poll, under a zutil::ReentrantLock.
+     *
+     * offer / poll return false on timeout, timeouts have the same meaning as in the C API. emplace waits forever.
+     * After close, offer fails and poll drains the remaining items, see BlockingQueue.close.
+     */
+    template<typename T, bool = std::is_trivially_copyable_v<T>>
+    class BlockingQueue;
+
+    template<typename T>
+    class BlockingQueue<T, true> {
+    public:
+        explicit BlockingQueue(size_t capacity, BlockingQueueBuilder builder = newArrayBlockingQueue)
+                : queue_(builder(capacity, sizeof(T))) {
+            if (queue_ == nullptr) {
+                throw std::bad_alloc();
+            }
+        }
+
+        BlockingQueue(BlockingQueue &&other) noexcept: queue_(std::exchange(other.queue_, nullptr)) {}
+
+        BlockingQueue &operator=(BlockingQueue &&other) noexcept {
+            std::swap(queue_, other.queue_);
+            return *this;
+        }
+
+        BlockingQueue(const BlockingQueue &) = delete;
+
+        BlockingQueue &operator=(const BlockingQueue &) = delete;
+
+        ~BlockingQueue() {
+            if (queue_ != nullptr) {
+                queue_->free(queue_);
+            }
+        }
+
+        bool offer(const T &item, long timeoutMs = -1) {
+            return queue_->offer(queue_, const_cast<T *>(&item), timeoutMs);
+        }
+
+        template<typename... Args>
+        bool emplace(Args &&... args) {
+            T item(std::forward<Args>(args)...);
+            return offer(item, -1);
+        }
+
+        bool poll(T &item, long timeoutMs = -1) {
+            return queue_->poll(queue_, &item, timeoutMs);
+        }
+
+        std::optional<T> poll(long timeoutMs = -1) {
+            // T may not be default constructible
+            alignas(T) unsigned char bytes[sizeof(T)];
+            if (!queue_->poll(queue_, bytes, timeoutMs)) {
+                return std::nullopt;
+            }
+            return std::optional<T>(*std::launder(reinterpret_cast<T *>(bytes)));
+        }
+
+        void close() {
+            queue_->close(queue_);
+        }
+
+        bool isClosed() const {
+            return queue_->isClosed(queue_);
+        }
+
+        ::BlockingQueue *native() const {
+            return queue_;
+        }
+
+    private:
+        ::BlockingQueue *queue_;
+    };
+
+    template<typename T>
+    class BlockingQueue<T, false> {
+    public:
+        explicit BlockingQueue(size_t capacity)
+                : nonFull_(lock_), nonEmpty_(lock_), capacity_(capacity) {
+            if (capacity == 0 || capacity == BLOCKING_QUEUE_UNBOUNDED) {
+                throw std::invalid_argument("the capacity must be bounded and positive");
+            }
+            slots_ = std::make_unique<Slot[]>(capacity);
+        }
+
+        BlockingQueue(const BlockingQueue &) = delete;
+
+        BlockingQueue &operator=(const BlockingQueue &) = delete;
+
+        ~BlockingQueue() {
+            for (; size_ > 0; --size_) {
+                item(head_)->~T();
+                head_ = next(head_);
+            }
+        }
+
+        bool offer(const T &item, long timeoutMs = -1) {
+            return put(timeoutMs, item);
+        }
+
+        bool offer(T &&item, long timeoutMs = -1) {
+            return put(timeoutMs, std::move(item));
+        }
+
+        template<typename... Args>
+        bool emplace(Args &&... args) {
+            return put(-1, std::forward<Args>(args)...);
+        }
+
+        bool poll(T &out, long timeoutMs = -1) {
+            std::lock_guard<ReentrantLock> guard(lock_);
+            if (!nonEmpty_.await([this] { return size_ > 0 || closed_; }, timeoutMs) || size_ == 0) {
+                return false;
+            }
+            T *slot = item(head_);
+            out = std::move(*slot);
+            slot->~T();
+            take();
+            return true;
+        }
+
+        std::optional<T> poll(long timeoutMs = -1) {
+            std::lock_guard<ReentrantLock> guard(lock_);
+            if (!nonEmpty_.await([this] { return size_ > 0 || closed_; }, timeoutMs) || size_ == 0) {
+                return std::nullopt;
+            }
+            T *slot = item(head_);
+            std::optional<T> out(std::move(*slot));
+            slot->~T();
+            take();
+            return out;
+        }
+
+        void close() {
+            std::lock_guard<ReentrantLock> guard(lock_);
+            closed_ = true;
+            nonEmpty_.signalAll();
+            nonFull_.signalAll();
+        }
+
+        bool isClosed() {
+            std::lock_guard<ReentrantLock> guard(lock_);
+            return closed_;
+        }
+
+    private:
+        struct Slot {
+            alignas(T) unsigned char bytes[sizeof(T)];
+        };
+
+        T *item(size_t index) {
+            return std::launder(reinterpret_cast<T *>(slots_[index].bytes));
+        }
+
+        size_t next(size_t index) const {
+            return index + 1 >= capacity_ ? 0 : index + 1;
+        }
+
+        /**
+         * Construct the item in the tail slot. If the constructor throws, the queue is unchanged.
+         */
+        template<typename... Args>
+        bool put(long timeoutMs, Args &&... args) {
+            std::lock_guard<ReentrantLock> guard(lock_);
+            if (!nonFull_.await([this] { return size_ < capacity_ || closed_; }, timeoutMs) || closed_) {
+                return false;
+            }
+            ::new(static_cast<void *>(slots_[tail_].bytes)) T(std::forward<Args>(args)...);
+            tail_ = next(tail_);
+            size_ += 1;
+            nonEmpty_.signalAll();
+            return true;
+        }
+
+        void take() {
+            head_ = next(head_);
+            size_ -= 1;
+            nonFull_.signalAll();
+        }
+
+        ReentrantLock lock_;
+        Condition nonFull_;
+        Condition nonEmpty_;
+        std::unique_ptr<Slot[]> slots_;
+        size_t capacity_;
+        size_t size_ = 0;
+        size_t head_ = 0;
+        size_t tail_ = 0;
+        bool closed_ = false;
+    };
+}
+
+#endif //ZUTIL_CONCURRENT_BLOCKINGQUEUE_HPP
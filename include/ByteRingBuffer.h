@@ -0,0 +1,99 @@
+#ifndef ZUTIL_CONCURRENT_BYTERINGBUFFER_H
+#define ZUTIL_CONCURRENT_BYTERINGBUFFER_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#endif
+
+typedef struct ByteRingBuffer ByteRingBuffer;
+
+/**
+ * A record polled from the ring buffer. The data stays in the ring buffer until it is released.
+ */
+typedef struct ByteRecord {
+    const void *data;
+    size_t length;
+} ByteRecord;
+
+/**
+ * Create a multi producer single consumer ring buffer of variable length records. Records are stored contiguously
+ * behind an 8 byte header and aligned to 8 bytes; a record which does not fit before the end of the buffer is
+ * placed at the start, and the gap is skipped as padding. Producers reserve space with a CAS on the tail, write
+ * the record in place and commit it; the consumer reads committed records in place and releases them in batches.
+ *
+ * Timeouts have the same meaning as in BlockingQueue: -1 waits forever, 0 never waits.
+ *
+ * @param capacity  the capacity in bytes, rounded up to a power of two. The maximum record length is
+ *                  capacity / 2 - 8.
+ * @return          the ring buffer (may be NULL if failed).
+ */
+ByteRingBuffer *newByteRingBuffer(size_t capacity);
+
+/**
+ * Free the ring buffer.
+ *
+ * @param ring the ring buffer.
+ */
+void freeByteRingBuffer(ByteRingBuffer *ring);
+
+/**
+ * @return the maximum length of a record.
+ */
+size_t maxRecordByteRingBuffer(ByteRingBuffer *ring);
+
+/**
+ * Reserve space for a record, waiting for the consumer to release space if the ring buffer is full. The record
+ * must be committed, otherwise the consumer stops at it.
+ *
+ * @param ring      the ring buffer.
+ * @param length    the length of the record.
+ * @param timeoutMs the timeout.
+ * @return          the space of the record (may be NULL if timeout or the record is too long).
+ */
+void *reserveByteRingBuffer(ByteRingBuffer *ring, size_t length, long timeoutMs);
+
+/**
+ * Commit a reserved record, making it visible to the consumer.
+ *
+ * @param ring      the ring buffer.
+ * @param record    the space returned by reserveByteRingBuffer.
+ */
+void commitByteRingBuffer(ByteRingBuffer *ring, void *record);
+
+/**
+ * Copy a record into the ring buffer, i.e. reserve + memcpy + commit.
+ *
+ * @return return false if timeout or the record is too long.
+ */
+bool offerByteRingBuffer(ByteRingBuffer *ring, const void *data, size_t length, long timeoutMs);
+
+/**
+ * Poll the committed records in order, waiting if there is none. (single consumer)
+ *
+ * The records are read in place and stay valid until releaseByteRingBuffer. Successive polls without a release
+ * continue after the records already polled.
+ *
+ * @param ring          the ring buffer.
+ * @param records       the polled records.
+ * @param maxRecords    the capacity of records.
+ * @param timeoutMs     the timeout.
+ * @return              the number of records (0 if timeout).
+ */
+size_t pollByteRingBuffer(ByteRingBuffer *ring, ByteRecord *records, size_t maxRecords, long timeoutMs);
+
+/**
+ * Release all the polled records, giving their space back to the producers. (single consumer)
+ *
+ * @param ring the ring buffer.
+ */
+void releaseByteRingBuffer(ByteRingBuffer *ring);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_BYTERINGBUFFER_H
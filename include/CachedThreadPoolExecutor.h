@@ -0,0 +1,44 @@
+#ifndef ZUTIL_CONCURRENT_CACHEDTHREADPOOLEXECUTOR_H
+#define ZUTIL_CONCURRENT_CACHEDTHREADPOOLEXECUTOR_H
+
+#include "ExecutorService.h"
+#include "Worker.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stddef.h>
+
+#endif
+
+/**
+ * New a cached thread pool, an elastic pool without task queue. A task is handed to an idle thread through a
+ * SynchronousQueue, and a new thread is started for it if no thread is idle. A thread idle for keepAliveMs exits, so
+ * the pool shrinks back to no thread when no task comes.
+ *
+ * submit fails if no thread is idle and maxThreadSize threads already run.
+ *
+ * @param maxThreadSize     the maximum number of thread.
+ * @param keepAliveMs       the time an idle thread waits for a task before it exits (milliseconds).
+ * @param format            the format of contexts.
+ * @return                  return NULL if failed.
+ */
+ExecutorService *newCachedThreadPoolExecutor(size_t maxThreadSize, long keepAliveMs, const char *format);
+
+/**
+ * New a cached thread pool whose workers call the hooks, see Worker.h. The worker ids count the started threads.
+ *
+ * @param maxThreadSize     the maximum number of thread.
+ * @param keepAliveMs       the time an idle thread waits for a task before it exits (milliseconds).
+ * @param format            the format of contexts.
+ * @param hooks             the hooks, copied, may be NULL.
+ * @return                  return NULL if failed.
+ */
+ExecutorService *newCachedThreadPoolExecutorWithHooks(size_t maxThreadSize, long keepAliveMs, const char *format,
+                                                      const WorkerHooks *hooks);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_CACHEDTHREADPOOLEXECUTOR_H
@@ -0,0 +1,121 @@
+#ifndef ZUTIL_CONCURRENT_CONCURRENTHASHMAP_H
+#define ZUTIL_CONCURRENT_CONCURRENTHASHMAP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#endif
+
+typedef struct ConcurrentHashMap ConcurrentHashMap;
+
+/**
+ * Create a concurrent hash map. Keys are byte strings (copied into the map), values are non-NULL pointers owned
+ * by the caller. `get` is lock-free, `put` / `remove` / `computeIfAbsent` lock one stripe of bins, and the
+ * table is resized incrementally by the writers.
+ *
+ * @param initialCapacity   the initial capacity of the map.
+ * @return                  return NULL if failed.
+ */
+ConcurrentHashMap *newConcurrentHashMap(size_t initialCapacity);
+
+/**
+ * Free the concurrent hash map. The values are not freed, see forEachConcurrentHashMap.
+ *
+ * @param map   the concurrent hash map.
+ */
+void freeConcurrentHashMap(ConcurrentHashMap *map);
+
+/**
+ * Get the value of the key. (lock-free)
+ *
+ * @param map       the concurrent hash map.
+ * @param key       the key.
+ * @param keyLength the length of the key.
+ * @return          the value (NULL if absent).
+ */
+void *getConcurrentHashMap(ConcurrentHashMap *map, const void *key, size_t keyLength);
+
+/**
+ * Put the value of the key.
+ *
+ * @param map       the concurrent hash map.
+ * @param key       the key.
+ * @param keyLength the length of the key.
+ * @param value     the value (must not be NULL).
+ * @param previous  the previous value (NULL if absent), may be NULL.
+ * @return          return false if failed.
+ */
+bool putConcurrentHashMap(ConcurrentHashMap *map, const void *key, size_t keyLength, void *value, void **previous);
+
+/**
+ * Remove the key.
+ *
+ * @param map       the concurrent hash map.
+ * @param key       the key.
+ * @param keyLength the length of the key.
+ * @return          the removed value (NULL if absent).
+ */
+void *removeConcurrentHashMap(ConcurrentHashMap *map, const void *key, size_t keyLength);
+
+/**
+ * Get the value of the key, or build and put it if absent. The builder is called at most once, while holding
+ * the lock of the key's stripe.
+ *
+ * @param map       the concurrent hash map.
+ * @param key       the key.
+ * @param keyLength the length of the key.
+ * @param builder   the builder of the value.
+ * @param arg       the argument of the builder.
+ * @return          the value (may be NULL if the builder returns NULL or failed).
+ */
+void *computeIfAbsentConcurrentHashMap(ConcurrentHashMap *map, const void *key, size_t keyLength,
+                                       void *(*builder)(const void *key, size_t keyLength, void *arg), void *arg);
+
+/**
+ * Get the number of entries of the map. The size is not an atomic snapshot if there are concurrent updates.
+ *
+ * @param map   the concurrent hash map.
+ * @return      the number of entries.
+ */
+size_t sizeConcurrentHashMap(ConcurrentHashMap *map);
+
+/**
+ * Visit all the entries of the map. Writers are blocked during the visit, so fn must not modify the map.
+ *
+ * @param map   the concurrent hash map.
+ * @param fn    the visitor.
+ * @param arg   the argument of the visitor.
+ */
+void forEachConcurrentHashMap(ConcurrentHashMap *map,
+                              void (*fn)(const void *key, size_t keyLength, void *value, void *arg), void *arg);
+
+/* uint64_t keys */
+
+inline static void *getU64ConcurrentHashMap(ConcurrentHashMap *map, uint64_t key) {
+    return getConcurrentHashMap(map, &key, sizeof(key));
+}
+
+inline static bool putU64ConcurrentHashMap(ConcurrentHashMap *map, uint64_t key, void *value, void **previous) {
+    return putConcurrentHashMap(map, &key, sizeof(key), value, previous);
+}
+
+inline static void *removeU64ConcurrentHashMap(ConcurrentHashMap *map, uint64_t key) {
+    return removeConcurrentHashMap(map, &key, sizeof(key));
+}
+
+inline static void *
+computeIfAbsentU64ConcurrentHashMap(ConcurrentHashMap *map, uint64_t key,
+                                    void *(*builder)(const void *key, size_t keyLength, void *arg), void *arg) {
+    return computeIfAbsentConcurrentHashMap(map, &key, sizeof(key), builder, arg);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_CONCURRENTHASHMAP_H
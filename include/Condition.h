@@ -18,6 +18,8 @@ extern "C" {
 
 typedef struct Condition Condition;
 
+typedef struct ConditionWaiter ConditionWaiter;
+
 /**
  * Create a condition variable from the reentrant lock. 
  * @param condition the condition variable.
@@ -51,6 +53,70 @@ void signalAllCondition(Condition *condition);
  */
 long awaitCondition(Condition *condition, long timeoutMs);
 
+/**
+ * Create a waiter, which a thread registers on several conditions to wait for any of them, e.g. the non-empty
+ * conditions of several queues. Every signal of a condition notifies all its registered waiters, besides the thread
+ * it wakes up.
+ * @return the waiter (may be NULL if failed).
+ */
+ConditionWaiter *newConditionWaiter();
+
+/**
+ * Create a waiter which also owns an eventfd, for an epoll loop instead of awaitConditionWaiter. The eventfd becomes
+ * readable at the first notification after a reset, and is written once however many notifications follow, so
+ * reset it when the eventfd is readable, then check the state the conditions guard.
+ * @return the waiter (may be NULL if failed).
+ */
+ConditionWaiter *newEventFdConditionWaiter();
+
+/**
+ * Get the eventfd of the waiter.
+ * @param waiter the waiter.
+ * @return       the eventfd, or -1 if the waiter has none.
+ */
+int getConditionWaiterEventFd(ConditionWaiter *waiter);
+
+/**
+ * Free the waiter, which must not be registered.
+ * @param waiter the waiter.
+ */
+void freeConditionWaiter(ConditionWaiter *waiter);
+
+/**
+ * Register the waiter on the condition. The lock of the condition must be held.
+ * @param condition the condition variable.
+ * @param waiter    the waiter.
+ * @return          return false if failed.
+ */
+bool registerConditionWaiter(Condition *condition, ConditionWaiter *waiter);
+
+/**
+ * Unregister the waiter from the condition. The lock of the condition must be held.
+ * @param condition the condition variable.
+ * @param waiter    the waiter.
+ */
+void unregisterConditionWaiter(Condition *condition, ConditionWaiter *waiter);
+
+/**
+ * Forget the notifications so far. Reset before checking the state the conditions guard, then await.
+ * @param waiter the waiter.
+ */
+void resetConditionWaiter(ConditionWaiter *waiter);
+
+/**
+ * Notify the waiter directly, as a signal of a condition it is registered on would, e.g. to hand it a result.
+ * @param waiter the waiter.
+ */
+void notifyConditionWaiter(ConditionWaiter *waiter);
+
+/**
+ * Wait until a condition the waiter is registered on is signaled after the last reset, without holding any lock.
+ * @param waiter    the waiter.
+ * @param timeoutMs the waiting timeout (milliseconds), see awaitCondition.
+ * @return          the leave time (milliseconds).
+ */
+long awaitConditionWaiter(ConditionWaiter *waiter, long timeoutMs);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,54 @@
+#ifndef ZUTIL_CONCURRENT_DELAYQUEUE_H
+#define ZUTIL_CONCURRENT_DELAYQUEUE_H
+
+#include "BlockingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdint.h>
+
+#endif
+
+/**
+ * Get the deadline of an item, in nanoseconds on CLOCK_MONOTONIC, see deadlineDelayQueue.
+ */
+typedef uint64_t (*DelayQueueDeadline)(const void *item);
+
+/**
+ * New a delay queue: poll returns the item of the earliest deadline, once the deadline expired. The deadline of an
+ * item is read once by offer.
+ *
+ * One waiting consumer sleeps until the earliest deadline, the others sleep until it takes the item, so an offer
+ * only wakes a consumer when it changes the earliest deadline. A closed queue still waits for the deadlines of its
+ * remaining items. The queue cannot notify waiters, so pollAnyBlockingQueue checks it periodically.
+ *
+ * @param capacity  the capacity of the blocking queue, or BLOCKING_QUEUE_UNBOUNDED.
+ * @param itemSize  the size of the item.
+ * @param deadline  the deadline of an item.
+ * @return          return NULL if failed.
+ */
+BlockingQueue *newDelayQueue(size_t capacity, size_t itemSize, DelayQueueDeadline deadline);
+
+/**
+ * @param delayMs   the delay (milliseconds).
+ * @return          the deadline `delayMs` from now.
+ */
+uint64_t deadlineDelayQueue(long delayMs);
+
+/**
+ * Define a BlockingQueueBuilder which creates delay queues of a fixed deadline function, e.g. for
+ * newFixedThreadPoolExecutor. Must be used at file scope.
+ *
+ *     DEFINE_DELAY_QUEUE_BUILDER(newTaskDelayQueue, taskDeadline)
+ */
+#define DEFINE_DELAY_QUEUE_BUILDER(Name, deadline) \
+    static BlockingQueue *Name(size_t capacity, size_t itemSize) { \
+        return newDelayQueue(capacity, itemSize, deadline); \
+    }
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_DELAYQUEUE_H
@@ -0,0 +1,104 @@
+#ifndef ZUTIL_CONCURRENT_DISRUPTOR_H
+#define ZUTIL_CONCURRENT_DISRUPTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#endif
+
+typedef struct Disruptor Disruptor;
+
+typedef struct DisruptorConsumer DisruptorConsumer;
+
+/**
+ * Create a multicast ring of fixed size entries, in the style of the LMAX Disruptor. Every entry is seen by every
+ * consumer, in place and in sequence order.
+ *
+ * Producers claim a batch of sequences, write the entries in place and publish them. Each consumer keeps its own
+ * sequence: it waits for the entries available to it, reads them in place, and releases them. A consumer with
+ * dependencies sees an entry only after all its dependencies released it, e.g. `process` after `journal` and
+ * `replicate`. Producers wait until the slowest consumers released the slot they claim.
+ *
+ * Timeouts have the same meaning as in BlockingQueue: -1 waits forever, 0 never waits.
+ *
+ * @param capacity  the number of entries, rounded up to a power of two.
+ * @param entrySize the size of an entry, entries are aligned to 8 bytes.
+ * @return          the disruptor (may be NULL if failed).
+ */
+Disruptor *newDisruptor(size_t capacity, size_t entrySize);
+
+/**
+ * Free the disruptor and its consumers.
+ *
+ * @param disruptor the disruptor.
+ */
+void freeDisruptor(Disruptor *disruptor);
+
+/**
+ * Add a consumer, which sees an entry after all of its dependencies released it. Consumers must be added before
+ * the first claim.
+ *
+ * @param disruptor         the disruptor.
+ * @param dependencies      the consumers this one depends on, of the same disruptor (may be NULL if none).
+ * @param dependencySize    the number of dependencies.
+ * @return                  the consumer, freed with the disruptor (may be NULL if failed).
+ */
+DisruptorConsumer *addConsumerDisruptor(Disruptor *disruptor, DisruptorConsumer *const *dependencies,
+                                        size_t dependencySize);
+
+/**
+ * Claim `count` consecutive sequences, waiting until the consumers released their slots. The claimed entries must
+ * be published, otherwise the consumers stop at them.
+ *
+ * @param disruptor the disruptor.
+ * @param count     the number of sequences, at most the capacity.
+ * @param first     the first claimed sequence.
+ * @param timeoutMs the timeout.
+ * @return          return false if timeout or count is out of range.
+ */
+bool claimDisruptor(Disruptor *disruptor, size_t count, uint64_t *first, long timeoutMs);
+
+/**
+ * @return the entry of a sequence, valid for the producer between claim and publish, and for a consumer between
+ *         wait and release.
+ */
+void *entryDisruptor(Disruptor *disruptor, uint64_t sequence);
+
+/**
+ * Publish the claimed sequences, making them visible to the consumers.
+ *
+ * @param disruptor the disruptor.
+ * @param first     the first sequence returned by claimDisruptor.
+ * @param count     the number of claimed sequences.
+ */
+void publishDisruptor(Disruptor *disruptor, uint64_t first, size_t count);
+
+/**
+ * Wait for the entries available to the consumer, i.e. published, and released by all its dependencies. (one thread
+ * per consumer)
+ *
+ * @param consumer  the consumer.
+ * @param first     the sequence of the first available entry.
+ * @param timeoutMs the timeout.
+ * @return          the number of consecutive available entries from `first` (0 if timeout).
+ */
+size_t waitForDisruptorConsumer(DisruptorConsumer *consumer, uint64_t *first, long timeoutMs);
+
+/**
+ * Release the first `count` waited entries, handing them to the dependent consumers, and to the producers once all
+ * consumers released them. (one thread per consumer)
+ *
+ * @param consumer  the consumer.
+ * @param count     the number of entries, at most the number returned by waitForDisruptorConsumer.
+ */
+void releaseDisruptorConsumer(DisruptorConsumer *consumer, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_DISRUPTOR_H
@@ -0,0 +1,62 @@
+#ifndef ZUTIL_CONCURRENT_EPOCHDOMAIN_H
+#define ZUTIL_CONCURRENT_EPOCHDOMAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct EpochDomain EpochDomain;
+
+/**
+ * Create an epoch based reclamation domain. Readers of a lock-free structure enter the domain before loading
+ * shared pointers and exit it when they drop them. Writers retire unlinked pointers, which are freed once every
+ * thread has left the critical regions that could still see them. Each thread registers itself in the domain
+ * through a ThreadLocal on its first entry and keeps per-thread limbo lists of retired pointers.
+ *
+ * @return the epoch domain (may be NULL if failed).
+ */
+EpochDomain *newEpochDomain();
+
+/**
+ * Free the epoch domain and all the pointers it still holds. No thread may be inside the domain.
+ *
+ * @param domain the epoch domain.
+ */
+void freeEpochDomain(EpochDomain *domain);
+
+/**
+ * Enter a critical region. Critical regions may be nested.
+ *
+ * @param domain the epoch domain.
+ */
+void enterEpochDomain(EpochDomain *domain);
+
+/**
+ * Exit a critical region.
+ *
+ * @param domain the epoch domain.
+ */
+void exitEpochDomain(EpochDomain *domain);
+
+/**
+ * Retire a pointer which is already unlinked from the shared structure. The deleter is called once no thread can
+ * still read it.
+ *
+ * @param domain    the epoch domain.
+ * @param ptr       the retired pointer.
+ * @param deleter   the deleter of the pointer.
+ */
+void retireEpochDomain(EpochDomain *domain, void *ptr, void (*deleter)(void *));
+
+/**
+ * Try to advance the epoch and free the retired pointers of the current thread which are safe to free. It is
+ * called by retireEpochDomain and exitEpochDomain, and may be called by idle threads.
+ *
+ * @param domain the epoch domain.
+ */
+void reclaimEpochDomain(EpochDomain *domain);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_EPOCHDOMAIN_H
@@ -0,0 +1,65 @@
+#ifndef ZUTIL_CONCURRENT_EXECUTORCOMPLETIONSERVICE_H
+#define ZUTIL_CONCURRENT_EXECUTORCOMPLETIONSERVICE_H
+
+#include "ExecutorService.h"
+#include "BlockingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdbool.h>
+
+#endif
+
+typedef struct ExecutorCompletionService ExecutorCompletionService;
+
+/**
+ * New a completion service, which runs tasks on an executor and queues every task once it finished, so that the
+ * results are collected in completion order, e.g. inside an epoll loop with getExecutorCompletionServiceEventFd.
+ *
+ * @param executor  the executor which runs the tasks, not owned by the completion service.
+ * @return          return NULL if failed.
+ */
+ExecutorCompletionService *newExecutorCompletionService(ExecutorService *executor);
+
+/**
+ * Free the completion service. The executor must be shut down before, so that no task still runs.
+ *
+ * @param service   the completion service.
+ */
+void freeExecutorCompletionService(ExecutorCompletionService *service);
+
+/**
+ * Submit a task to the executor.
+ *
+ * @param service   the completion service.
+ * @param fn        the function to submit.
+ * @param arg       the parameter of the function, which usually carries the result.
+ * @return          return false if the executor rejected the task.
+ */
+bool submitExecutorCompletionService(ExecutorCompletionService *service, void (*fn)(void *), void *arg);
+
+/**
+ * Poll a finished task, in completion order.
+ *
+ * @param service   the completion service.
+ * @param task      the finished task.
+ * @param timeoutMs the timeout represented in milliseconds, see BlockingQueue.poll.
+ * @return          return false if timeout.
+ */
+bool pollExecutorCompletionService(ExecutorCompletionService *service, Runnable *task, long timeoutMs);
+
+/**
+ * Get the eventfd of the completion queue, created at the first call, see newQueueEventFd. When it is readable,
+ * reset it and poll the finished tasks with timeoutMs == 0.
+ *
+ * @param service   the completion service.
+ * @return          return NULL if failed.
+ */
+QueueEventFd *getExecutorCompletionServiceEventFd(ExecutorCompletionService *service);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_EXECUTORCOMPLETIONSERVICE_H
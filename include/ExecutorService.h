@@ -6,9 +6,18 @@ extern "C" {
 #else
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #endif
 
+/**
+ * A task, i.e. a function and its parameter.
+ */
+typedef struct Runnable {
+    void (*fn)(void *);
+    void *arg;
+} Runnable;
+
 typedef struct ExecutorService {
     /**
      * Submit a Task to the executor service.
@@ -41,6 +50,16 @@ typedef struct ExecutorService {
      * @return              return true if the the executor service is shutdown.
      */
     bool (*const isShutdown)(struct ExecutorService *executor);
+
+    /**
+     * Shutdown the executor service without running the queued tasks: the running tasks finish, and the tasks which
+     * never started are returned.
+     *
+     * @param executor      the executor service.
+     * @param size          the number of returned tasks.
+     * @return              the tasks which never started, freed by the caller (may be NULL if none or failed).
+     */
+    Runnable *(*const shutdownNow)(struct ExecutorService *executor, size_t *size);
 } ExecutorService;
 
 
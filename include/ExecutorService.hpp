@@ -0,0 +1,119 @@
+#ifndef ZUTIL_CONCURRENT_EXECUTORSERVICE_HPP
+#define ZUTIL_CONCURRENT_EXECUTORSERVICE_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "ExecutorService.h"
+#include "FixedThreadPoolExecutor.h"
+#include "LinkedBlockingQueue.h"
+
+namespace zutil {
+
+    /**
+     * An owner of a C ExecutorService which submits any callable. A callable which is trivially copyable and fits
+     * in a pointer, e.g. a lambda capturing one pointer or reference, is packed into the `arg` of the C task, so
+     * the submit allocates nothing. Larger callables are moved to the heap and freed after they run.
+     *
+     * A task must not throw: an exception escaping a task calls std::terminate.
+     */
+    class ExecutorService {
+    public:
+        /**
+         * Take the ownership of a C executor.
+         */
+        explicit ExecutorService(::ExecutorService *executor) : executor_(executor) {
+            if (executor_ == nullptr) {
+                throw std::bad_alloc();
+            }
+        }
+
+        static ExecutorService fixed(size_t threadSize, size_t taskQueueSize = BLOCKING_QUEUE_UNBOUNDED,
+                                     const char *format = "executor-%d",
+                                     BlockingQueueBuilder builder = newLinkedBlockingQueue) {
+            return ExecutorService(newFixedThreadPoolExecutor(threadSize, taskQueueSize, format, builder));
+        }
+
+        ExecutorService(ExecutorService &&other) noexcept: executor_(std::exchange(other.executor_, nullptr)) {}
+
+        ExecutorService &operator=(ExecutorService &&other) noexcept {
+            std::swap(executor_, other.executor_);
+            return *this;
+        }
+
+        ExecutorService(const ExecutorService &) = delete;
+
+        ExecutorService &operator=(const ExecutorService &) = delete;
+
+        /**
+         * Shutdown, which runs the queued tasks, and free the executor.
+         */
+        ~ExecutorService() {
+            if (executor_ != nullptr) {
+                executor_->free(executor_);
+            }
+        }
+
+        /**
+         * Submit a callable, see ExecutorService.submit.
+         *
+         * @return return false if failed, the callable is destroyed then.
+         */
+        template<typename F>
+        bool submit(F &&fn) {
+            using Task = std::decay_t<F>;
+            if constexpr (isInline<Task>()) {
+                void *arg = nullptr;
+                std::memcpy(&arg, &fn, sizeof(Task));
+                return executor_->submit(executor_, runInline<Task>, arg);
+            } else {
+                auto task = std::make_unique<Task>(std::forward<F>(fn));
+                if (!executor_->submit(executor_, runHeap<Task>, task.get())) {
+                    return false;
+                }
+                task.release();
+                return true;
+            }
+        }
+
+        void shutdown() {
+            executor_->shutdown(executor_);
+        }
+
+        bool isShutdown() const {
+            return executor_->isShutdown(executor_);
+        }
+
+        ::ExecutorService *native() const {
+            return executor_;
+        }
+
+    private:
+        template<typename Task>
+        static constexpr bool isInline() {
+            return sizeof(Task) <= sizeof(void *) && alignof(Task) <= alignof(void *)
+                   && std::is_trivially_copyable_v<Task>;
+        }
+
+        template<typename Task>
+        static void runInline(void *arg) noexcept {
+            alignas(void *) unsigned char bytes[sizeof(void *)];
+            std::memcpy(bytes, &arg, sizeof(void *));
+            (*std::launder(reinterpret_cast<Task *>(bytes)))();
+        }
+
+        template<typename Task>
+        static void runHeap(void *arg) noexcept {
+            std::unique_ptr<Task> task(static_cast<Task *>(arg));
+            (*task)();
+        }
+
+        ::ExecutorService *executor_;
+    };
+}
+
+#endif //ZUTIL_CONCURRENT_EXECUTORSERVICE_HPP
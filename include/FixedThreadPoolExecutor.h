@@ -3,6 +3,7 @@
 
 #include "ExecutorService.h"
 #include "BlockingQueue.h"
+#include "Worker.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +31,20 @@ typedef BlockingQueue *(*BlockingQueueBuilder)(size_t, size_t);
 ExecutorService *
 newFixedThreadPoolExecutor(size_t threadSize, size_t taskQueueSize, const char *format, BlockingQueueBuilder builder);
 
+/**
+ * New a fixed thread pool whose workers call the hooks, see Worker.h. A task gets its worker with currentWorker, the
+ * worker ids are 0 to threadSize - 1.
+ *
+ * @param threadSize        the number of thread.
+ * @param taskQueueSize     the number of queue size.
+ * @param format            the format of contexts.
+ * @param builder           the builder of queue.
+ * @param hooks             the hooks, copied, may be NULL.
+ * @return                  return NULL if failed.
+ */
+ExecutorService *newFixedThreadPoolExecutorWithHooks(size_t threadSize, size_t taskQueueSize, const char *format,
+                                                     BlockingQueueBuilder builder, const WorkerHooks *hooks);
+
 #ifdef __cplusplus
 }
 #endif
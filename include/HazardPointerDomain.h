@@ -0,0 +1,70 @@
+#ifndef ZUTIL_CONCURRENT_HAZARDPOINTERDOMAIN_H
+#define ZUTIL_CONCURRENT_HAZARDPOINTERDOMAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stddef.h>
+
+#endif
+
+typedef struct HazardPointerDomain HazardPointerDomain;
+
+/**
+ * Create a hazard pointer domain. Every thread owns `hazards` hazard pointers in the domain, registered through a
+ * ThreadLocal on first use. A retired pointer is freed once no hazard pointer protects it, so the number of
+ * retired but unfreed pointers is bounded even if a reader stalls, unlike EpochDomain.
+ *
+ * @param hazards   the number of hazard pointers per thread.
+ * @return          the hazard pointer domain (may be NULL if failed).
+ */
+HazardPointerDomain *newHazardPointerDomain(size_t hazards);
+
+/**
+ * Free the hazard pointer domain and all the pointers it still holds. No pointer may be protected.
+ *
+ * @param domain the hazard pointer domain.
+ */
+void freeHazardPointerDomain(HazardPointerDomain *domain);
+
+/**
+ * Load a shared pointer and protect it with the hazard pointer `index` of the current thread.
+ *
+ * @param domain    the hazard pointer domain.
+ * @param index     the index of the hazard pointer (less than `hazards`).
+ * @param source    the address of the shared pointer.
+ * @return          the protected pointer, NULL if the shared pointer is NULL or if the thread cannot be registered
+ *                  in the domain.
+ */
+void *protectHazardPointerDomain(HazardPointerDomain *domain, size_t index, void *const *source);
+
+/**
+ * Clear the hazard pointer `index` of the current thread.
+ *
+ * @param domain    the hazard pointer domain.
+ * @param index     the index of the hazard pointer.
+ */
+void clearHazardPointerDomain(HazardPointerDomain *domain, size_t index);
+
+/**
+ * Retire a pointer which is already unlinked from the shared structure. The deleter is called once no hazard
+ * pointer protects it.
+ *
+ * @param domain    the hazard pointer domain.
+ * @param ptr       the retired pointer.
+ * @param deleter   the deleter of the pointer.
+ */
+void retireHazardPointerDomain(HazardPointerDomain *domain, void *ptr, void (*deleter)(void *));
+
+/**
+ * Scan the hazard pointers and free the retired pointers of the current thread which are not protected.
+ *
+ * @param domain the hazard pointer domain.
+ */
+void reclaimHazardPointerDomain(HazardPointerDomain *domain);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_HAZARDPOINTERDOMAIN_H
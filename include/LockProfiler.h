@@ -0,0 +1,118 @@
+#ifndef ZUTIL_CONCURRENT_LOCKPROFILER_H
+#define ZUTIL_CONCURRENT_LOCKPROFILER_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#endif
+
+#include "ReentrantLock.h"
+#include "Condition.h"
+#include "BlockingQueue.h"
+
+/*
+ * Lock contention profiling. The profiler is compiled in only when ZUTIL_CONCURRENT_PROFILING is defined
+ * (cmake -DZUTIL_CONCURRENT_PROFILING=ON). Otherwise every function below is a no-op and the lock / condition
+ * fast paths are exactly the same as an unprofiled build.
+ *
+ * Only named objects are profiled, and an object should be named before it is shared with other threads. The
+ * records of freed objects are kept, so the report still covers short-lived queues.
+ */
+
+#define LOCK_PROFILE_NAME_MAX 64
+
+enum LockProfileKind {
+    LOCK_PROFILE_LOCK,
+    LOCK_PROFILE_CONDITION
+};
+
+enum LockProfileOrder {
+    LOCK_PROFILE_ORDER_WAIT_TIME,
+    LOCK_PROFILE_ORDER_CONTENTIONS,
+    LOCK_PROFILE_ORDER_HOLD_TIME,
+    LOCK_PROFILE_ORDER_PARKED_TIME
+};
+
+typedef struct LockProfile {
+    char name[LOCK_PROFILE_NAME_MAX];
+    enum LockProfileKind kind;
+
+    /* ReentrantLock statistics (all times in nanoseconds) */
+    unsigned long long acquisitions;
+    unsigned long long contentions;
+    unsigned long long waitTimeNs;
+    unsigned long long maxWaitTimeNs;
+    unsigned long long holdTimeNs;
+    unsigned long long maxHoldTimeNs;
+
+    /* Condition statistics (all times in nanoseconds) */
+    unsigned long long awaits;
+    unsigned long long parkedTimeNs;
+    unsigned long long maxParkedTimeNs;
+} LockProfile;
+
+/**
+ * Check if the library is built with lock profiling.
+ *
+ * @return return true if ZUTIL_CONCURRENT_PROFILING is enabled.
+ */
+bool isLockProfilingEnabled();
+
+/**
+ * Tag the reentrant lock with a name and start profiling it.
+ *
+ * @param lock  the reentrant lock.
+ * @param name  the name of the lock (copied, truncated to LOCK_PROFILE_NAME_MAX - 1).
+ */
+void profileReentrantLock(ReentrantLock *lock, const char *name);
+
+/**
+ * Tag the condition variable with a name and start profiling it.
+ *
+ * @param condition the condition variable.
+ * @param name      the name of the condition (copied, truncated to LOCK_PROFILE_NAME_MAX - 1).
+ */
+void profileCondition(Condition *condition, const char *name);
+
+/**
+ * Tag the locks and conditions of the blocking queue as `name.<member>` and start profiling them.
+ *
+ * @param queue the blocking queue.
+ * @param name  the name of the queue.
+ */
+void profileBlockingQueue(BlockingQueue *queue, const char *name);
+
+/**
+ * Copy the profiles sorted by `order` (descending).
+ *
+ * @param profiles      the output buffer (may be NULL if maxProfiles == 0).
+ * @param maxProfiles   the capacity of the output buffer.
+ * @param order         the sort key.
+ * @return              the number of profiles recorded (may be larger than maxProfiles).
+ */
+size_t snapshotLockProfiles(LockProfile *profiles, size_t maxProfiles, enum LockProfileOrder order);
+
+/**
+ * Print a report of all the profiles sorted by `order`.
+ *
+ * @param out   the output stream.
+ * @param order the sort key.
+ */
+void dumpLockProfiles(FILE *out, enum LockProfileOrder order);
+
+/**
+ * Reset the statistics of all the profiles. Names are kept. The profiled objects may be in use, an update racing
+ * with the reset may keep the maximum it raises.
+ */
+void resetLockProfiles();
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_LOCKPROFILER_H
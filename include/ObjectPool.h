@@ -0,0 +1,52 @@
+#ifndef ZUTIL_CONCURRENT_OBJECTPOOL_H
+#define ZUTIL_CONCURRENT_OBJECTPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stddef.h>
+
+#endif
+
+typedef struct ObjectPool ObjectPool;
+
+/**
+ * Create a pool of fixed-size blocks. Each thread caches two magazines of blocks, and full or empty magazines are
+ * exchanged through a lock-free depot, so a block freed by a consumer thread goes back to the producers in
+ * batches of a magazine. The depot keeps a bounded number of full magazines, the blocks freed beyond it are given
+ * back to the system, so the pool does not keep the memory of its peak usage.
+ *
+ * @param blockSize the size of the blocks.
+ * @return          the object pool (may be NULL if failed).
+ */
+ObjectPool *newObjectPool(size_t blockSize);
+
+/**
+ * Free the object pool and the blocks cached by it. The blocks still allocated from the pool must be given back
+ * before, or they are leaked.
+ *
+ * @param pool the object pool.
+ */
+void freeObjectPool(ObjectPool *pool);
+
+/**
+ * Allocate a block from the pool. The block is not initialized.
+ *
+ * @param pool  the object pool.
+ * @return      the block (may be NULL if failed).
+ */
+void *allocateObjectPool(ObjectPool *pool);
+
+/**
+ * Give a block back to the pool. The block may be allocated by any thread.
+ *
+ * @param pool  the object pool.
+ * @param block the block allocated from the pool.
+ */
+void deallocateObjectPool(ObjectPool *pool, void *block);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_OBJECTPOOL_H
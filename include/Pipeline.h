@@ -0,0 +1,116 @@
+#ifndef ZUTIL_CONCURRENT_PIPELINE_H
+#define ZUTIL_CONCURRENT_PIPELINE_H
+
+#include "BlockingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#endif
+
+typedef struct Pipeline Pipeline;
+
+/**
+ * Process an item of a stage.
+ *
+ * @param item  the item, from the previous stage or submitPipeline.
+ * @param arg   the arg of the stage.
+ * @return      the item passed to the next stage, NULL to drop it. Ignored for the last stage.
+ */
+typedef void *(*PipelineProcess)(void *item, void *arg);
+
+/**
+ * The declaration of a stage.
+ */
+typedef struct PipelineStageConfig {
+    /* the name of the stage, in the stats and the thread names */
+    const char *name;
+    PipelineProcess process;
+    void *arg;
+    /* the initial number of threads, at least 1 */
+    size_t parallelism;
+    /* the builder of the input queue of the stage, NULL for ArrayBlockingQueue */
+    BlockingQueue *(*builder)(size_t capacity, size_t itemSize);
+    size_t capacity;
+    /* the maximum number of items a thread takes from the queue at once, at least 1 */
+    size_t batchSize;
+} PipelineStageConfig;
+
+/**
+ * The stats of a stage.
+ */
+typedef struct PipelineStageStats {
+    const char *name;
+    size_t threads;
+    /* the items in the queue */
+    long long depth;
+    long long processed;
+    /* the processed items per second since the previous getPipelineStats */
+    double throughput;
+} PipelineStageStats;
+
+/**
+ * New a staged pipeline (SEDA): every stage has an input queue and its own threads, which take batches of items from
+ * the queue, process them and offer the results to the queue of the next stage. A full queue makes the previous
+ * stage wait, so the slowest stage paces the pipeline.
+ *
+ * With rebalanceMs > 0, a thread rebalances the pipeline every rebalanceMs, see rebalancePipeline.
+ *
+ * @param stages        the stages, in order.
+ * @param stageSize     the number of stages.
+ * @param rebalanceMs   the interval of the rebalancing (milliseconds), 0 to rebalance only with rebalancePipeline.
+ * @return              return NULL if failed.
+ */
+Pipeline *newPipeline(const PipelineStageConfig *stages, size_t stageSize, long rebalanceMs);
+
+/**
+ * Shutdown and free the pipeline.
+ *
+ * @param pipeline  the pipeline.
+ */
+void freePipeline(Pipeline *pipeline);
+
+/**
+ * Submit an item to the first stage.
+ *
+ * @param pipeline  the pipeline.
+ * @param item      the item.
+ * @param timeoutMs the timeout while the first queue is full, see BlockingQueue.offer.
+ * @return          return false if timeout or shutdown.
+ */
+bool submitPipeline(Pipeline *pipeline, void *item, long timeoutMs);
+
+/**
+ * Wait until all the submitted items went through all the stages, and stop the threads.
+ *
+ * @param pipeline  the pipeline.
+ */
+void shutdownPipeline(Pipeline *pipeline);
+
+/**
+ * Get the stats of the stages.
+ *
+ * @param pipeline  the pipeline.
+ * @param stats     the stats, one per stage.
+ */
+void getPipelineStats(Pipeline *pipeline, PipelineStageStats *stats);
+
+/**
+ * Move a thread toward the bottleneck, by the queue depths averaged over the calls: from the stage of the shortest
+ * queue which has several threads, to the stage of the longest queue (the later one if they differ by less than its
+ * batch), if it holds more than a batch and twice the items. The moved thread leaves its stage after its current
+ * batch, and a new one starts in the other stage.
+ *
+ * @param pipeline  the pipeline.
+ * @return          return true if a thread was moved.
+ */
+bool rebalancePipeline(Pipeline *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_PIPELINE_H
@@ -0,0 +1,43 @@
+#ifndef ZUTIL_CONCURRENT_PRIORITYBLOCKINGQUEUE_H
+#define ZUTIL_CONCURRENT_PRIORITYBLOCKINGQUEUE_H
+
+#include "BlockingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compare two items, like the comparator of qsort.
+ *
+ * @return a negative value if a goes before b, 0 if they are equal, a positive value if a goes after b.
+ */
+typedef int (*BlockingQueueComparator)(const void *a, const void *b);
+
+/**
+ * New a priority blocking queue: poll returns the least item by the comparator. Items of the same priority are
+ * polled in no particular order. The items are stored inline in a 4-ary heap, in one contiguous array which grows
+ * up to the capacity.
+ *
+ * @param capacity      the capacity of the blocking queue, or BLOCKING_QUEUE_UNBOUNDED.
+ * @param itemSize      the size of the item.
+ * @param comparator    the order of the items.
+ * @return              return NULL if failed.
+ */
+BlockingQueue *newPriorityBlockingQueue(size_t capacity, size_t itemSize, BlockingQueueComparator comparator);
+
+/**
+ * Define a BlockingQueueBuilder which creates priority blocking queues of a fixed comparator, e.g. for
+ * newFixedThreadPoolExecutor. Must be used at file scope.
+ *
+ *     DEFINE_PRIORITY_BLOCKING_QUEUE_BUILDER(newTaskPriorityQueue, compareTaskPriority)
+ */
+#define DEFINE_PRIORITY_BLOCKING_QUEUE_BUILDER(Name, comparator) \
+    static BlockingQueue *Name(size_t capacity, size_t itemSize) { \
+        return newPriorityBlockingQueue(capacity, itemSize, comparator); \
+    }
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_PRIORITYBLOCKINGQUEUE_H
@@ -0,0 +1,65 @@
+#ifndef ZUTIL_CONCURRENT_SCHEDULEDEXECUTORSERVICE_H
+#define ZUTIL_CONCURRENT_SCHEDULEDEXECUTORSERVICE_H
+
+#include "ExecutorService.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#endif
+
+/**
+ * An ExecutorService which also runs tasks after a delay, or periodically. A scheduled task is identified by the
+ * id returned by schedule, which stays safe to cancel after the task ran.
+ *
+ * The parent is the first member, so a ScheduledExecutorService can be used as an ExecutorService: submit runs the
+ * task at once, shutdown cancels the scheduled tasks and runs the submitted ones, shutdownNow also returns the
+ * scheduled tasks which never ran.
+ */
+typedef struct ScheduledExecutorService {
+    ExecutorService parent;
+
+    /**
+     * Run a task once after a delay.
+     *
+     * @param executor      the executor service.
+     * @param fn            the function to run.
+     * @param arg           the parameter of the function.
+     * @param delayMs       the delay (milliseconds), the task never runs earlier.
+     * @return              the id of the task (0 if failed).
+     */
+    uint64_t (*const schedule)(struct ScheduledExecutorService *executor, void (*fn)(void *), void *arg, long delayMs);
+
+    /**
+     * Run a task after a delay, then every period from the previous planned start. A run which takes longer than
+     * the period delays the next one, runs of the same task never overlap.
+     *
+     * @param executor      the executor service.
+     * @param fn            the function to run.
+     * @param arg           the parameter of the function.
+     * @param initialDelayMs the delay of the first run (milliseconds).
+     * @param periodMs      the period (milliseconds), at least 1.
+     * @return              the id of the task (0 if failed).
+     */
+    uint64_t (*const scheduleAtFixedRate)(struct ScheduledExecutorService *executor, void (*fn)(void *), void *arg,
+                                          long initialDelayMs, long periodMs);
+
+    /**
+     * Cancel a scheduled task. A running periodic task finishes its run, and never runs again.
+     *
+     * @param executor      the executor service.
+     * @param task          the id returned by schedule or scheduleAtFixedRate.
+     * @return              return false if the task already ran, or was cancelled.
+     */
+    bool (*const cancel)(struct ScheduledExecutorService *executor, uint64_t task);
+} ScheduledExecutorService;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZUTIL_CONCURRENT_SCHEDULEDEXECUTORSERVICE_H
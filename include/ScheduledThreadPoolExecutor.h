@@ -0,0 +1,37 @@
+#ifndef ZUTIL_CONCURRENT_SCHEDULEDTHREADPOOLEXECUTOR_H
+#define ZUTIL_CONCURRENT_SCHEDULEDTHREADPOOLEXECUTOR_H
+
+#include "ScheduledExecutorService.h"
+#include "FixedThreadPoolExecutor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stddef.h>
+
+#endif
+
+/**
+ * New a scheduled thread pool. The scheduled tasks are kept in a hierarchical timing wheel, so schedule and cancel
+ * are O(1) whatever the number of pending tasks. A ticker thread advances the wheel every tick, and dispatches the
+ * expired tasks in batches into a FixedThreadPoolExecutor, which runs them.
+ *
+ * A task runs in the first tick after its delay, so the tick bounds the lateness of the tasks. Periods are rounded
+ * up to whole ticks.
+ *
+ * @param threadSize        the number of thread of the fixed thread pool.
+ * @param taskQueueSize     the size of the queue of the fixed thread pool, when it is full the ticker keeps the rest
+ *                          of the expired tasks and retries at the next tick.
+ * @param format            the format of contexts.
+ * @param builder           the builder of queue.
+ * @param tickMs            the tick of the wheel (milliseconds), at least 1.
+ * @return                  return NULL if failed.
+ */
+ScheduledExecutorService *newScheduledThreadPoolExecutor(size_t threadSize, size_t taskQueueSize, const char *format,
+                                                         BlockingQueueBuilder builder, long tickMs);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_SCHEDULEDTHREADPOOLEXECUTOR_H
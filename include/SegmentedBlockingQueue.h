@@ -0,0 +1,27 @@
+#ifndef ZUTIL_CONCURRENT_SEGMENTEDBLOCKINGQUEUE_H
+#define ZUTIL_CONCURRENT_SEGMENTEDBLOCKINGQUEUE_H
+
+#include "BlockingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * New a segmented blocking queue, a linked list of fixed size arrays of items. Producers and consumers move through
+ * a segment by index, so the queue costs one allocation and one pointer chase per segment instead of per item, and
+ * the items are contiguous in memory. A drained segment is kept for the next one a producer needs.
+ *
+ * It is the unbounded queue to prefer for small items, and supports bounded capacity too.
+ *
+ * @param capacity  the capacity of the blocking queue, or BLOCKING_QUEUE_UNBOUNDED.
+ * @param itemSize  the size of the item.
+ * @return          return NULL if failed.
+ */
+BlockingQueue *newSegmentedBlockingQueue(size_t capacity, size_t itemSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZUTIL_CONCURRENT_SEGMENTEDBLOCKINGQUEUE_H
@@ -0,0 +1,41 @@
+#ifndef ZUTIL_CONCURRENT_SHARDEDBLOCKINGQUEUE_H
+#define ZUTIL_CONCURRENT_SHARDEDBLOCKINGQUEUE_H
+
+#include "BlockingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * New a sharded blocking queue of one lane per processor (up to 64). A bounded queue is made of ArrayBlockingQueue
+ * lanes, an unbounded one of SegmentedBlockingQueue lanes.
+ *
+ * @param capacity  the capacity of the blocking queue, split evenly over the lanes, or BLOCKING_QUEUE_UNBOUNDED.
+ * @param itemSize  the size of the item.
+ * @return          return NULL if failed.
+ */
+BlockingQueue *newShardedBlockingQueue(size_t capacity, size_t itemSize);
+
+/**
+ * New a sharded blocking queue, which spreads the producers and the consumers over several inner queues (lanes), so
+ * that they do not all contend on one head and one tail. Every thread has a home lane. An offer goes to the home
+ * lane, or to the next lane which is not full. A poll takes from the home lane first, then steals from the other
+ * lanes, and waits on all of them when they are all empty.
+ *
+ * The items of a lane keep their order, but the queue as a whole is not FIFO.
+ *
+ * @param laneSize  the number of lanes.
+ * @param capacity  the capacity of the blocking queue, split evenly over the lanes, or BLOCKING_QUEUE_UNBOUNDED.
+ * @param itemSize  the size of the item.
+ * @param builder   the builder of the lanes, which should support registerWaiter.
+ * @return          return NULL if failed.
+ */
+BlockingQueue *newShardedBlockingQueueWithLanes(size_t laneSize, size_t capacity, size_t itemSize,
+                                                BlockingQueue *(*builder)(size_t, size_t));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZUTIL_CONCURRENT_SHARDEDBLOCKINGQUEUE_H
@@ -0,0 +1,66 @@
+#ifndef ZUTIL_CONCURRENT_SHAREDMEMORYQUEUE_H
+#define ZUTIL_CONCURRENT_SHAREDMEMORYQUEUE_H
+
+#include "BlockingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A bounded array blocking queue in a POSIX shared memory object, for producers and consumers in different
+ * processes. Items are copied into the shared memory once by offer and once out by poll.
+ *
+ * The shared memory holds a process-shared robust mutex, two process-shared conditions, and the items indexed by
+ * offsets, so every process may map it at a different address. Each process creates or attaches its own
+ * BlockingQueue, whose `free` unmaps the shared memory of that process only; the shared memory object lives until
+ * it is unlinked and unmapped by all processes. `close` closes the queue for all the processes.
+ *
+ * If a process dies holding the lock, the next process taking it recovers the lock, the item being copied by the
+ * dead process may be lost or duplicated. `profile` does nothing, the lock profiler is process local, and
+ * `registerWaiter` is NULL, a waiter in another process cannot be notified.
+ *
+ * Items must not hold pointers, unless they point into memory mapped at the same address by all processes.
+ */
+
+/**
+ * Create the shared memory object of the name and a queue in it. Fails if the object exists.
+ *
+ * @param name      the name of the shared memory object, see shm_open, e.g. "/my-queue".
+ * @param capacity  the capacity of the queue.
+ * @param itemSize  the size of the item.
+ * @return          return NULL if failed.
+ */
+BlockingQueue *createSharedMemoryQueue(const char *name, size_t capacity, size_t itemSize);
+
+/**
+ * Attach to the queue created by createSharedMemoryQueue, possibly in another process. Fails until the creator
+ * has initialized the queue.
+ *
+ * @param name      the name of the shared memory object.
+ * @return          return NULL if failed.
+ */
+BlockingQueue *attachSharedMemoryQueue(const char *name);
+
+/**
+ * Remove the name of the shared memory object, the processes which have attached keep using it.
+ *
+ * @param name      the name of the shared memory object.
+ * @return          return false if failed.
+ */
+bool unlinkSharedMemoryQueue(const char *name);
+
+/**
+ * @return the capacity of the queue, which is the same in every process.
+ */
+size_t capacitySharedMemoryQueue(BlockingQueue *queue);
+
+/**
+ * @return the item size of the queue, which is the same in every process.
+ */
+size_t itemSizeSharedMemoryQueue(BlockingQueue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_SHAREDMEMORYQUEUE_H
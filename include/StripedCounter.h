@@ -0,0 +1,53 @@
+#ifndef ZUTIL_CONCURRENT_STRIPEDCOUNTER_H
+#define ZUTIL_CONCURRENT_STRIPEDCOUNTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct StripedCounter StripedCounter;
+
+/**
+ * Create a striped counter (LongAdder). The counter is split into cache line padded cells, and each thread
+ * updates its own cell, so concurrent updates do not contend on a single cache line. The sum is computed on read.
+ *
+ * @return the striped counter (may be NULL if failed).
+ */
+StripedCounter *newStripedCounter();
+
+/**
+ * Free the striped counter.
+ *
+ * @param counter the striped counter.
+ */
+void freeStripedCounter(StripedCounter *counter);
+
+/**
+ * Add x to the striped counter.
+ *
+ * @param counter   the striped counter.
+ * @param x         the value to add.
+ */
+void addStripedCounter(StripedCounter *counter, long long x);
+
+/**
+ * Get the sum of the striped counter. The sum is not an atomic snapshot if there are concurrent updates.
+ *
+ * @param counter   the striped counter.
+ * @return          the sum.
+ */
+long long sumStripedCounter(StripedCounter *counter);
+
+/**
+ * Get the sum of the striped counter and reset it to zero. Updates concurrent with the reset are either
+ * included in the returned sum or kept in the counter.
+ *
+ * @param counter   the striped counter.
+ * @return          the sum before reset.
+ */
+long long sumThenResetStripedCounter(StripedCounter *counter);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_STRIPEDCOUNTER_H
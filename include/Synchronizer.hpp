@@ -0,0 +1,179 @@
+#ifndef ZUTIL_CONCURRENT_SYNCHRONIZER_HPP
+#define ZUTIL_CONCURRENT_SYNCHRONIZER_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "ReentrantLock.h"
+#include "Condition.h"
+#include "CountDownLatch.h"
+
+/**
+ * C++17 RAII owners of the C synchronizers. The wrappers own the C objects, are movable but not copyable, and
+ * throw std::bad_alloc if the C constructor fails. Timeouts have the same meaning as in the C API.
+ */
+namespace zutil {
+
+    /**
+     * A reentrant lock, which is BasicLockable, so std::lock_guard and std::unique_lock work with it.
+     */
+    class ReentrantLock {
+    public:
+        ReentrantLock() : lock_(newReentrantLock()) {
+            if (lock_ == nullptr) {
+                throw std::bad_alloc();
+            }
+        }
+
+        ReentrantLock(ReentrantLock &&other) noexcept: lock_(std::exchange(other.lock_, nullptr)) {}
+
+        ReentrantLock &operator=(ReentrantLock &&other) noexcept {
+            std::swap(lock_, other.lock_);
+            return *this;
+        }
+
+        ReentrantLock(const ReentrantLock &) = delete;
+
+        ReentrantLock &operator=(const ReentrantLock &) = delete;
+
+        ~ReentrantLock() {
+            if (lock_ != nullptr) {
+                freeReentrantLock(lock_);
+            }
+        }
+
+        void lock() {
+            lockReentrantLock(lock_);
+        }
+
+        void unlock() {
+            unlockReentrantLock(lock_);
+        }
+
+        bool try_lock() {
+            return tryLockReentrantLock(lock_);
+        }
+
+        ::ReentrantLock *native() const {
+            return lock_;
+        }
+
+    private:
+        ::ReentrantLock *lock_;
+    };
+
+    /**
+     * A condition of a ReentrantLock. The lock must outlive the condition and be held by the callers.
+     */
+    class Condition {
+    public:
+        explicit Condition(ReentrantLock &lock) : condition_(newCondition(lock.native())) {
+            if (condition_ == nullptr) {
+                throw std::bad_alloc();
+            }
+        }
+
+        Condition(Condition &&other) noexcept: condition_(std::exchange(other.condition_, nullptr)) {}
+
+        Condition &operator=(Condition &&other) noexcept {
+            std::swap(condition_, other.condition_);
+            return *this;
+        }
+
+        Condition(const Condition &) = delete;
+
+        Condition &operator=(const Condition &) = delete;
+
+        ~Condition() {
+            if (condition_ != nullptr) {
+                freeCondition(condition_);
+            }
+        }
+
+        void signal() {
+            signalCondition(condition_);
+        }
+
+        void signalAll() {
+            signalAllCondition(condition_);
+        }
+
+        /**
+         * @return the leave time, see awaitCondition.
+         */
+        long await(long timeoutMs = -1) {
+            return awaitCondition(condition_, timeoutMs);
+        }
+
+        /**
+         * Wait until the predicate holds.
+         *
+         * @return return false if timeout.
+         */
+        template<typename Predicate>
+        bool await(Predicate predicate, long timeoutMs = -1) {
+            while (!predicate()) {
+                timeoutMs = awaitCondition(condition_, timeoutMs);
+                if (timeoutMs == 0) {
+                    return predicate();
+                }
+            }
+            return true;
+        }
+
+        ::Condition *native() const {
+            return condition_;
+        }
+
+    private:
+        ::Condition *condition_;
+    };
+
+    class CountDownLatch {
+    public:
+        explicit CountDownLatch(int count) : latch_(newCountDownLatch(count)) {
+            if (latch_ == nullptr) {
+                throw std::bad_alloc();
+            }
+        }
+
+        CountDownLatch(CountDownLatch &&other) noexcept: latch_(std::exchange(other.latch_, nullptr)) {}
+
+        CountDownLatch &operator=(CountDownLatch &&other) noexcept {
+            std::swap(latch_, other.latch_);
+            return *this;
+        }
+
+        CountDownLatch(const CountDownLatch &) = delete;
+
+        CountDownLatch &operator=(const CountDownLatch &) = delete;
+
+        ~CountDownLatch() {
+            if (latch_ != nullptr) {
+                freeCountDownLatch(latch_);
+            }
+        }
+
+        void countDown() {
+            decreaseCountDownLatch(latch_);
+        }
+
+        /**
+         * @return return false if timeout.
+         */
+        bool await(long timeoutMs = -1) {
+            return awaitCountDownLatch(latch_, timeoutMs);
+        }
+
+        ::CountDownLatch *native() const {
+            return latch_;
+        }
+
+    private:
+        ::CountDownLatch *latch_;
+    };
+}
+
+#endif //ZUTIL_CONCURRENT_SYNCHRONIZER_HPP
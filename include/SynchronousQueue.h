@@ -0,0 +1,27 @@
+#ifndef ZUTIL_CONCURRENT_SYNCHRONOUSQUEUE_H
+#define ZUTIL_CONCURRENT_SYNCHRONOUSQUEUE_H
+
+#include "BlockingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * New a synchronous queue, which holds no item: an offer hands its item directly to a waiting poll, and a poll
+ * takes it directly from a waiting offer. offer / poll with timeoutMs == 0 only succeed if a peer waits. Waiting
+ * offers and polls are paired in arrival order.
+ *
+ * A waiter spins a little before it parks, on a machine of several processors, so a handoff to a spinning waiter
+ * costs no system call. Closing the queue fails the waiting offers and polls.
+ *
+ * @param capacity  ignored, the queue holds no item. Any capacity, e.g. 0, gives the same queue.
+ * @param itemSize  the size of the item.
+ * @return          return NULL if failed.
+ */
+BlockingQueue *newSynchronousQueue(size_t capacity, size_t itemSize);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_SYNCHRONOUSQUEUE_H
@@ -13,13 +13,19 @@ extern "C" {
 #include <pthread.h>
 #include <string.h>
 
+/**
+ * A thread local variable. The values are stored in a per-thread slot array indexed by a process-wide slot id,
+ * so there is no limit on the number of thread local variables and the lookup does not go through
+ * pthread_getspecific. The deleters of the values run at thread exit.
+ */
 typedef struct {
     pthread_mutex_t mutex;
-    pthread_key_t key;
+    size_t slot;
+    unsigned long long generation;
     bool initialized;
 } ThreadLocal;
     
-#define THREAD_LOCAL_INITIALIZER  {.mutex = PTHREAD_MUTEX_INITIALIZER, .key = -1, .initialized = false}
+#define THREAD_LOCAL_INITIALIZER  {.mutex = PTHREAD_MUTEX_INITIALIZER, .slot = 0, .generation = 0, .initialized = false}
     
 /**
 * Init the thread local variable. It is same as marco THREAD_LOCAL_INITIALIZER.
@@ -40,13 +46,51 @@ inline static void initThreadLocal(ThreadLocal *threadLocal) {
  */
 bool setThreadLocal(ThreadLocal *threadLocal, void *item, void (*deleter)(void *));
 
+/* implementation details of the inline getThreadLocal, see ThreadLocal.c */
+
+/**
+ * The number of slots stored in the static TLS block of each thread, slots beyond it live in a growable
+ * overflow array.
+ */
+#define THREAD_LOCAL_INLINE_SLOTS 64
+
+/**
+ * The value of a thread local variable in one thread. The generation identifies the ThreadLocal that owns the
+ * slot, so the value left by a destroyed ThreadLocal is never visible to the next owner of the slot. A free entry
+ * has generation 0 and no item.
+ */
+struct ThreadLocalEntry {
+    unsigned long long generation;
+
+    void *item;
+
+    void (*deleter)(void *);
+};
+
+extern __thread struct ThreadLocalEntry threadLocalInlineEntries[THREAD_LOCAL_INLINE_SLOTS];
+
 /**
- * Get the thread local variable.
+ * The out of line part of getThreadLocal, for the slots in the overflow array.
+ */
+void *getOverflowThreadLocal(ThreadLocal *threadLocal);
+
+/**
+ * Get the thread local variable. For the first THREAD_LOCAL_INLINE_SLOTS variables of the process this is two
+ * loads from the ThreadLocal and one from the TLS block, with no function call.
  * 
  * @param threadLocal the thread local variable.
  * @return            the item (may be NULL).
  */
-void *getThreadLocal(ThreadLocal *threadLocal);
+inline static void *getThreadLocal(ThreadLocal *threadLocal) {
+    // an uninitialized or destroyed ThreadLocal has generation 0, which only matches a free entry
+    size_t slot = __atomic_load_n(&threadLocal->slot, __ATOMIC_RELAXED);
+    unsigned long long generation = __atomic_load_n(&threadLocal->generation, __ATOMIC_RELAXED);
+    if (slot < THREAD_LOCAL_INLINE_SLOTS) {
+        struct ThreadLocalEntry *entry = &threadLocalInlineEntries[slot];
+        return entry->generation == generation ? entry->item : NULL;
+    }
+    return getOverflowThreadLocal(threadLocal);
+}
 
 /**
  * Set the thread local variable if absent.
@@ -61,7 +105,8 @@ void *
 computeIfAbsentThreadLocal(ThreadLocal *threadLocal, void *(*builder)(void *), void *arg, void (*deleter)(void *));
 
 /**
- * Destroy the thread local variable and free all the allocated memory.
+ * Destroy the thread local variable and free all the allocated memory. The value of the current thread is deleted
+ * immediately, the values of other threads are deleted when they exit or reuse the slot.
  * 
  * @param threadLocal the thread local variable.
  */
@@ -0,0 +1,213 @@
+#ifndef ZUTIL_CONCURRENT_TYPEDBLOCKINGQUEUE_H
+#define ZUTIL_CONCURRENT_TYPEDBLOCKINGQUEUE_H
+
+#include "BlockingQueue.h"
+#include "ReentrantLock.h"
+#include "Condition.h"
+#include "LockProfiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Typed array blocking queues generated by macros. The generated offer / poll are inline and copy items by
+ * assignment, so the compiler sees the item type and size, and no call goes through the BlockingQueue vtable.
+ *
+ *     DEFINE_BLOCKING_QUEUE(IntQueue, int)
+ *
+ * generates:
+ *
+ *     IntQueue *newIntQueue(size_t capacity);
+ *     void freeIntQueue(IntQueue *queue);
+ *     bool offerIntQueue(IntQueue *queue, int item, long timeoutMs);
+ *     bool pollIntQueue(IntQueue *queue, int *item, long timeoutMs);
+ *     void closeIntQueue(IntQueue *queue);
+ *     bool isClosedIntQueue(IntQueue *queue);
+ *
+ * DEFINE_FIXED_BLOCKING_QUEUE(Name, T, CAPACITY) takes a power of two capacity at compile time, so the ring is
+ * indexed by a mask, and newName takes no argument.
+ *
+ * The first member of the queue, `parent`, is a BlockingQueue which dispatches to the typed functions, so
+ * `&queue->parent` can be handed to code using the generic interface, e.g. an executor or a benchmark. Its `free`
+ * frees the typed queue.
+ *
+ * Timeouts have the same meaning as in BlockingQueue. The macros must be used at file scope, once per Name.
+ */
+#define DEFINE_BLOCKING_QUEUE(Name, T) \
+    BLOCKING_QUEUE_TYPE(Name, T) \
+    inline static size_t nextIndex##Name(Name *queue, size_t index) { \
+        return index + 1 >= queue->capacity ? 0 : index + 1; \
+    } \
+    inline static Name *new##Name(size_t capacity) { \
+        if (capacity == 0 || BLOCKING_QUEUE_UNBOUNDED / sizeof(T) <= capacity) { \
+            return NULL; \
+        } \
+        return allocate##Name(capacity); \
+    } \
+    BLOCKING_QUEUE_FUNCTIONS(Name, T)
+
+#define DEFINE_FIXED_BLOCKING_QUEUE(Name, T, CAPACITY) \
+    _Static_assert((CAPACITY) > 0 && ((CAPACITY) & ((CAPACITY) - 1)) == 0, #Name " capacity is not a power of two"); \
+    BLOCKING_QUEUE_TYPE(Name, T) \
+    inline static size_t nextIndex##Name(Name *queue, size_t index) { \
+        return (index + 1) & ((CAPACITY) - 1); \
+    } \
+    inline static Name *new##Name() { \
+        return allocate##Name(CAPACITY); \
+    } \
+    BLOCKING_QUEUE_FUNCTIONS(Name, T)
+
+/* implementation details of the macros above */
+
+#define BLOCKING_QUEUE_TYPE(Name, T) \
+    typedef struct Name { \
+        BlockingQueue parent; \
+        ReentrantLock *lock; \
+        Condition *nonFull; \
+        Condition *nonEmpty; \
+        size_t capacity; \
+        size_t size; \
+        size_t head; \
+        size_t tail; \
+        bool closed; \
+        T items[]; \
+    } Name; \
+    static void free##Name(Name *queue); \
+    static bool poll##Name##Item(BlockingQueue *queue, void *item, long timeoutMs); \
+    static bool offer##Name##Item(BlockingQueue *queue, void *item, long timeoutMs); \
+    static void profile##Name(BlockingQueue *queue, const char *name); \
+    static bool registerWaiter##Name(BlockingQueue *queue, struct ConditionWaiter *waiter); \
+    static void unregisterWaiter##Name(BlockingQueue *queue, struct ConditionWaiter *waiter); \
+    static void closeParent##Name(BlockingQueue *queue); \
+    static bool isClosedParent##Name(BlockingQueue *queue); \
+    static Name *allocate##Name(size_t capacity) { \
+        Name *queue = calloc(1, sizeof(Name) + capacity * sizeof(T)); \
+        if (queue == NULL) { \
+            return NULL; \
+        } \
+        BlockingQueue parent = { \
+                .offer = offer##Name##Item, \
+                .poll = poll##Name##Item, \
+                .free = (void (*)(struct BlockingQueue *)) free##Name, \
+                .profile = profile##Name, \
+                .registerWaiter = registerWaiter##Name, \
+                .unregisterWaiter = unregisterWaiter##Name, \
+                .close = closeParent##Name, \
+                .isClosed = isClosedParent##Name \
+        }; \
+        memcpy(&queue->parent, &parent, sizeof(BlockingQueue)); \
+        queue->capacity = capacity; \
+        queue->lock = newReentrantLock(); \
+        if (queue->lock == NULL) { \
+            free##Name(queue); \
+            return NULL; \
+        } \
+        queue->nonFull = newCondition(queue->lock); \
+        queue->nonEmpty = newCondition(queue->lock); \
+        if (queue->nonFull == NULL || queue->nonEmpty == NULL) { \
+            free##Name(queue); \
+            return NULL; \
+        } \
+        return queue; \
+    }
+
+#define BLOCKING_QUEUE_FUNCTIONS(Name, T) \
+    static void free##Name(Name *queue) { \
+        if (queue->nonEmpty) { \
+            freeCondition(queue->nonEmpty); \
+        } \
+        if (queue->nonFull) { \
+            freeCondition(queue->nonFull); \
+        } \
+        if (queue->lock) { \
+            freeReentrantLock(queue->lock); \
+        } \
+        free(queue); \
+    } \
+    static void close##Name(Name *queue) { \
+        lockReentrantLock(queue->lock); \
+        queue->closed = true; \
+        signalAllCondition(queue->nonEmpty); \
+        signalAllCondition(queue->nonFull); \
+        unlockReentrantLock(queue->lock); \
+    } \
+    static bool isClosed##Name(Name *queue) { \
+        lockReentrantLock(queue->lock); \
+        bool closed = queue->closed; \
+        unlockReentrantLock(queue->lock); \
+        return closed; \
+    } \
+    inline static bool offer##Name(Name *queue, T item, long timeoutMs) { \
+        lockReentrantLock(queue->lock); \
+        while (queue->size == queue->capacity || queue->closed) { \
+            timeoutMs = queue->closed ? 0 : awaitCondition(queue->nonFull, timeoutMs); \
+            if (timeoutMs == 0) { \
+                unlockReentrantLock(queue->lock); \
+                return false; \
+            } \
+        } \
+        queue->items[queue->tail] = item; \
+        queue->tail = nextIndex##Name(queue, queue->tail); \
+        queue->size += 1; \
+        signalAllCondition(queue->nonEmpty); \
+        unlockReentrantLock(queue->lock); \
+        return true; \
+    } \
+    inline static bool poll##Name(Name *queue, T *item, long timeoutMs) { \
+        lockReentrantLock(queue->lock); \
+        while (queue->size == 0) { \
+            timeoutMs = queue->closed ? 0 : awaitCondition(queue->nonEmpty, timeoutMs); \
+            if (timeoutMs == 0) { \
+                unlockReentrantLock(queue->lock); \
+                return false; \
+            } \
+        } \
+        *item = queue->items[queue->head]; \
+        queue->head = nextIndex##Name(queue, queue->head); \
+        queue->size -= 1; \
+        signalAllCondition(queue->nonFull); \
+        unlockReentrantLock(queue->lock); \
+        return true; \
+    } \
+    static bool offer##Name##Item(BlockingQueue *queue, void *item, long timeoutMs) { \
+        T value; \
+        memcpy(&value, item, sizeof(T)); \
+        return offer##Name((Name *) queue, value, timeoutMs); \
+    } \
+    static bool poll##Name##Item(BlockingQueue *queue, void *item, long timeoutMs) { \
+        T value; \
+        if (!poll##Name((Name *) queue, &value, timeoutMs)) { \
+            return false; \
+        } \
+        memcpy(item, &value, sizeof(T)); \
+        return true; \
+    } \
+    static void profile##Name(BlockingQueue *queue, const char *name) { \
+        char buffer[LOCK_PROFILE_NAME_MAX]; \
+        snprintf(buffer, sizeof(buffer), "%s.lock", name); \
+        profileReentrantLock(((Name *) queue)->lock, buffer); \
+        snprintf(buffer, sizeof(buffer), "%s.nonEmpty", name); \
+        profileCondition(((Name *) queue)->nonEmpty, buffer); \
+        snprintf(buffer, sizeof(buffer), "%s.nonFull", name); \
+        profileCondition(((Name *) queue)->nonFull, buffer); \
+    } \
+    static bool registerWaiter##Name(BlockingQueue *queue, struct ConditionWaiter *waiter) { \
+        lockReentrantLock(((Name *) queue)->lock); \
+        bool registered = registerConditionWaiter(((Name *) queue)->nonEmpty, waiter); \
+        unlockReentrantLock(((Name *) queue)->lock); \
+        return registered; \
+    } \
+    static void unregisterWaiter##Name(BlockingQueue *queue, struct ConditionWaiter *waiter) { \
+        lockReentrantLock(((Name *) queue)->lock); \
+        unregisterConditionWaiter(((Name *) queue)->nonEmpty, waiter); \
+        unlockReentrantLock(((Name *) queue)->lock); \
+    } \
+    static void closeParent##Name(BlockingQueue *queue) { \
+        close##Name((Name *) queue); \
+    } \
+    static bool isClosedParent##Name(BlockingQueue *queue) { \
+        return isClosed##Name((Name *) queue); \
+    }
+
+#endif //ZUTIL_CONCURRENT_TYPEDBLOCKINGQUEUE_H
@@ -0,0 +1,78 @@
+#ifndef ZUTIL_CONCURRENT_WORKER_H
+#define ZUTIL_CONCURRENT_WORKER_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+
+#include <stddef.h>
+
+#endif
+
+/**
+ * A worker thread of an executor, seen by the tasks it runs through currentWorker.
+ */
+typedef struct Worker Worker;
+
+/**
+ * The lifecycle hooks of the workers of an executor, and the size of their arenas.
+ */
+typedef struct WorkerHooks {
+    /* called on the worker thread before its first task, e.g. to setWorkerData, may be NULL */
+    void (*onStart)(Worker *worker, void *arg);
+    /* called on the worker thread after its last task, may be NULL */
+    void (*onStop)(Worker *worker, void *arg);
+    void *arg;
+    /* the size of the scratch arena of a worker, 0 for WORKER_ARENA_DEFAULT_SIZE */
+    size_t arenaSize;
+} WorkerHooks;
+
+#define WORKER_ARENA_DEFAULT_SIZE (64 * 1024)
+
+/**
+ * Get the worker of the current thread.
+ *
+ * @return the worker, or NULL if the current thread is not a worker of an executor.
+ */
+Worker *currentWorker();
+
+/**
+ * Get the id of the worker, from 0 to the number of threads - 1 in a FixedThreadPoolExecutor, so that it indexes
+ * per-worker data. A CachedThreadPoolExecutor numbers its workers from 0 as it starts them.
+ *
+ * @param worker the worker.
+ * @return       the id.
+ */
+size_t getWorkerId(Worker *worker);
+
+/**
+ * Get the data of the worker, set by setWorkerData, NULL by default.
+ *
+ * @param worker the worker.
+ * @return       the data.
+ */
+void *getWorkerData(Worker *worker);
+
+/**
+ * Set the data of the worker, e.g. in onStart. The worker does not own it.
+ *
+ * @param worker the worker.
+ * @param data   the data.
+ */
+void setWorkerData(Worker *worker, void *data);
+
+/**
+ * Allocate scratch memory from the arena of the worker, by bumping a pointer. The whole arena is reset after each
+ * task, so the memory is only valid until the current task returns, and is never freed. The arena is allocated at
+ * the first call of the worker.
+ *
+ * @param worker the worker.
+ * @param size   the size.
+ * @return       the memory aligned for any type, or NULL if the arena is exhausted or failed.
+ */
+void *allocateWorkerArena(Worker *worker, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif //ZUTIL_CONCURRENT_WORKER_H
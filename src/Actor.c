@@ -0,0 +1,143 @@
+#include "Actor.h"
+
+#include <malloc.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+/**
+ * An actor, with the intrusive MPSC queue of Dmitry Vyukov as its mailbox: producers exchange the head, then link
+ * the previous head to their message, and the single consumer follows the links from the tail. The stub message
+ * keeps the queue non-empty, so push and pop never contend on the same pointer.
+ */
+struct Actor {
+    /* the last pushed message, exchanged by the producers */
+    ActorMessage *head;
+    /* the number of messages sent and not received yet, its 0 -> 1 transition submits the actor */
+    size_t pending;
+
+    /* the next message to receive, only touched by the running actor */
+    ActorMessage *tail;
+    ActorMessage stub;
+
+    ExecutorService *executor;
+    ActorReceive receive;
+    void *state;
+    size_t batchSize;
+};
+
+static void runActor(void *arg);
+
+Actor *newActor(ExecutorService *executor, ActorReceive receive, void *state, size_t batchSize) {
+    if (batchSize == 0) {
+        return NULL;
+    }
+
+    Actor *actor = calloc(1, sizeof(Actor));
+    if (actor == NULL) {
+        return NULL;
+    }
+
+    atomic_init(&actor->stub.next, NULL);
+    atomic_init(&actor->head, &actor->stub);
+    atomic_init(&actor->pending, 0);
+    actor->tail = &actor->stub;
+    actor->executor = executor;
+    actor->receive = receive;
+    actor->state = state;
+    actor->batchSize = batchSize;
+    return actor;
+}
+
+void freeActor(Actor *actor) {
+    free(actor);
+}
+
+inline static void pushMailbox(Actor *actor, ActorMessage *message) {
+    atomic_store_explicit(&message->next, NULL, memory_order_relaxed);
+    ActorMessage *prev = atomic_exchange_explicit(&actor->head, message, memory_order_acq_rel);
+    // the consumer sees the message once it is linked
+    atomic_store_explicit(&prev->next, message, memory_order_release);
+}
+
+/**
+ * Pop a message, the mailbox must hold one. A producer between its exchange and its link makes the message not
+ * reachable yet, for a few instructions, so wait for the link then.
+ */
+inline static ActorMessage *popMailbox(Actor *actor) {
+    for (;;) {
+        ActorMessage *tail = actor->tail;
+        ActorMessage *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+        if (tail == &actor->stub) {
+            if (next == NULL) {
+                sched_yield();
+                continue;
+            }
+            // skip the stub
+            actor->tail = next;
+            tail = next;
+            next = atomic_load_explicit(&tail->next, memory_order_acquire);
+        }
+        if (next != NULL) {
+            actor->tail = next;
+            return tail;
+        }
+
+        // the tail is the last message linked, push the stub behind it so that it can be taken
+        if (tail == atomic_load_explicit(&actor->head, memory_order_acquire)) {
+            pushMailbox(actor, &actor->stub);
+            next = atomic_load_explicit(&tail->next, memory_order_acquire);
+            if (next != NULL) {
+                actor->tail = next;
+                return tail;
+            }
+        }
+        sched_yield();
+    }
+}
+
+/**
+ * Submit the actor, retrying while the executor rejects it because its queue is full.
+ *
+ * @return return false if the executor is shut down.
+ */
+static bool submitActor(Actor *actor) {
+    ExecutorService *executor = actor->executor;
+    while (!executor->submit(executor, runActor, actor)) {
+        if (executor->isShutdown(executor)) {
+            return false;
+        }
+        sched_yield();
+    }
+    return true;
+}
+
+bool sendActor(Actor *actor, ActorMessage *message) {
+    pushMailbox(actor, message);
+    // the sender which makes the mailbox non-empty schedules the actor, the others find it scheduled
+    if (atomic_fetch_add(&actor->pending, 1) == 0) {
+        return submitActor(actor);
+    }
+    return true;
+}
+
+static void runActor(void *arg) {
+    Actor *actor = arg;
+    ExecutorService *executor = actor->executor;
+    for (;;) {
+        size_t pending = atomic_load(&actor->pending);
+        size_t batch = pending < actor->batchSize ? pending : actor->batchSize;
+        for (size_t i = 0; i < batch; ++i) {
+            ActorMessage *message = popMailbox(actor);
+            actor->receive(actor->state, message);
+        }
+
+        if (atomic_fetch_sub(&actor->pending, batch) == batch) {
+            return;
+        }
+        // leave the messages sent meanwhile to the next run, at the back of the executor queue. If the queue is
+        // full, go on here rather than wait for a worker, all the workers may be waiting too
+        if (executor->submit(executor, runActor, actor) || executor->isShutdown(executor)) {
+            return;
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #include "ArrayBlockingQueue.h"
 #include "ReentrantLock.h"
 #include "Condition.h"
+#include "LockProfiler.h"
 #include <malloc.h>
 #include <string.h>
 
@@ -19,6 +20,7 @@ typedef struct ArrayBlockingQueue {
     size_t size;
     size_t head;
     size_t tail;
+    bool closed;
 
     char data[];
 } ArrayBlockingQueue;
@@ -30,6 +32,18 @@ static bool queuePoll(ArrayBlockingQueue *queue, void *item, long timeoutMs);
 
 static bool queueOffer(ArrayBlockingQueue *queue, void *item, long timeoutMs);
 
+static void queueProfile(ArrayBlockingQueue *queue, const char *name);
+
+static bool queueRegisterWaiter(ArrayBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueUnregisterWaiter(ArrayBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueClose(ArrayBlockingQueue *queue);
+
+static bool queueIsClosed(ArrayBlockingQueue *queue);
+
+static size_t queueDrain(ArrayBlockingQueue *queue, void *items, size_t maxItems, long timeoutMs);
+
 /* private member functions */
 inline static void enqueue(ArrayBlockingQueue *queue, void *item);
 
@@ -49,7 +63,13 @@ BlockingQueue *newArrayBlockingQueue(size_t capacity, size_t itemSize) {
     BlockingQueue parent = {
             .offer = (bool (*)(struct BlockingQueue *, void *, long)) queueOffer,
             .free = (void (*)(struct BlockingQueue *)) queueFree,
-            .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll
+            .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll,
+            .profile = (void (*)(struct BlockingQueue *, const char *)) queueProfile,
+            .registerWaiter = (bool (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueRegisterWaiter,
+            .unregisterWaiter = (void (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueUnregisterWaiter,
+            .close = (void (*)(struct BlockingQueue *)) queueClose,
+            .isClosed = (bool (*)(struct BlockingQueue *)) queueIsClosed,
+            .drain = (size_t (*)(struct BlockingQueue *, void *, size_t, long)) queueDrain
     };
     memcpy(&queue->parent, &parent, sizeof(BlockingQueue));
 
@@ -117,7 +137,7 @@ static bool queuePoll(ArrayBlockingQueue *queue, void *item, long timeoutMs) {
     lockReentrantLock(queue->lock);
 
     while (queue->size == 0) {
-        timeoutMs = awaitCondition(queue->nonEmpty, timeoutMs);
+        timeoutMs = queue->closed ? 0 : awaitCondition(queue->nonEmpty, timeoutMs);
         
         if (timeoutMs == 0) {
             unlockReentrantLock(queue->lock);
@@ -131,10 +151,35 @@ static bool queuePoll(ArrayBlockingQueue *queue, void *item, long timeoutMs) {
     return true;
 }
 
+static size_t queueDrain(ArrayBlockingQueue *queue, void *items, size_t maxItems, long timeoutMs) {
+    if (maxItems == 0) {
+        return 0;
+    }
+    lockReentrantLock(queue->lock);
+
+    while (queue->size == 0) {
+        timeoutMs = queue->closed ? 0 : awaitCondition(queue->nonEmpty, timeoutMs);
+
+        if (timeoutMs == 0) {
+            unlockReentrantLock(queue->lock);
+            return 0;
+        }
+    }
+
+    size_t size = queue->size < maxItems ? queue->size : maxItems;
+    for (size_t i = 0; i < size; ++i) {
+        dequeue(queue, (char *) items + i * queue->itemSize);
+    }
+    signalAllCondition(queue->nonFull);
+
+    unlockReentrantLock(queue->lock);
+    return size;
+}
+
 static bool queueOffer(ArrayBlockingQueue *queue, void *item, long timeoutMs) {
     lockReentrantLock(queue->lock);
 
-    while (queue->size == queue->capacity) {
+    while (queue->size == queue->capacity && !queue->closed) {
         timeoutMs = awaitCondition(queue->nonFull, timeoutMs);
         
         if (timeoutMs == 0) {
@@ -143,7 +188,7 @@ static bool queueOffer(ArrayBlockingQueue *queue, void *item, long timeoutMs) {
         }
     }
 
-    if (queue->size == queue->capacity) {
+    if (queue->size == queue->capacity || queue->closed) {
         unlockReentrantLock(queue->lock);
         return false;
     }
@@ -154,3 +199,41 @@ static bool queueOffer(ArrayBlockingQueue *queue, void *item, long timeoutMs) {
     unlockReentrantLock(queue->lock);
     return true;
 }
+
+static void queueProfile(ArrayBlockingQueue *queue, const char *name) {
+    char buffer[LOCK_PROFILE_NAME_MAX];
+    snprintf(buffer, sizeof(buffer), "%s.lock", name);
+    profileReentrantLock(queue->lock, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonEmpty", name);
+    profileCondition(queue->nonEmpty, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonFull", name);
+    profileCondition(queue->nonFull, buffer);
+}
+
+static bool queueRegisterWaiter(ArrayBlockingQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->lock);
+    bool registered = registerConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->lock);
+    return registered;
+}
+
+static void queueUnregisterWaiter(ArrayBlockingQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->lock);
+    unregisterConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->lock);
+}
+
+static void queueClose(ArrayBlockingQueue *queue) {
+    lockReentrantLock(queue->lock);
+    queue->closed = true;
+    signalAllCondition(queue->nonEmpty);
+    signalAllCondition(queue->nonFull);
+    unlockReentrantLock(queue->lock);
+}
+
+static bool queueIsClosed(ArrayBlockingQueue *queue) {
+    lockReentrantLock(queue->lock);
+    bool closed = queue->closed;
+    unlockReentrantLock(queue->lock);
+    return closed;
+}
@@ -0,0 +1,183 @@
+#include "BlockingQueue.h"
+#include "Condition.h"
+#include "ThreadLocal.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+struct QueueEventFd {
+    BlockingQueue *queue;
+    ConditionWaiter *waiter;
+};
+
+/**
+ * The waiter of the current thread, registered on the queues of a pollAny only while it waits.
+ */
+static ThreadLocal threadWaiter = THREAD_LOCAL_INITIALIZER;
+
+static void *newWaiterTL(void *arg) {
+    return newConditionWaiter();
+}
+
+static void freeWaiterTL(void *arg) {
+    freeConditionWaiter(arg);
+}
+
+/**
+ * Poll the queues once without waiting, in the order.
+ *
+ * @return return false if all the queues are empty.
+ */
+static bool tryPollAny(BlockingQueue *const *queues, size_t size, size_t start, size_t *index, void *item) {
+    for (size_t i = 0; i < size; ++i) {
+        size_t current = start + i < size ? start + i : start + i - size;
+        BlockingQueue *queue = queues[current];
+        if (queue->poll(queue, item, 0)) {
+            *index = current;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @return return true if all the queues are closed. Check it before polling, so that no item is offered after.
+ */
+static bool allClosed(BlockingQueue *const *queues, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (!queues[i]->isClosed(queues[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline static long elapsedMs(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long) (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+/**
+ * Check the queues every millisecond, for queues which cannot notify a waiter.
+ */
+static bool sleepPollAny(BlockingQueue *const *queues, size_t size, size_t start, size_t *index, void *item,
+                         long timeoutMs) {
+    struct timespec begin;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    struct timespec interval = {.tv_sec = 0, .tv_nsec = 1000000};
+    for (;;) {
+        bool closed = allClosed(queues, size);
+        if (tryPollAny(queues, size, start, index, item)) {
+            return true;
+        }
+        if (closed || (timeoutMs != -1 && elapsedMs(&begin) >= timeoutMs)) {
+            return false;
+        }
+        nanosleep(&interval, NULL);
+    }
+}
+
+bool pollAnyBlockingQueue(BlockingQueue *const *queues, size_t size, size_t *index, void *item, long timeoutMs,
+                          PollAnyOrder order) {
+    if (size == 0) {
+        return false;
+    }
+    size_t start = order == POLL_ANY_FAIR && *index + 1 < size ? *index + 1 : 0;
+    // the fast path takes no other lock than the one of the queue it polls
+    if (tryPollAny(queues, size, start, index, item)) {
+        return true;
+    }
+    if (timeoutMs == 0) {
+        return false;
+    }
+    // an item offered before the close is polled by the second try
+    bool closed = allClosed(queues, size);
+    if (tryPollAny(queues, size, start, index, item)) {
+        return true;
+    }
+    if (closed) {
+        return false;
+    }
+
+    ConditionWaiter *waiter = computeIfAbsentThreadLocal(&threadWaiter, newWaiterTL, NULL, freeWaiterTL);
+    size_t registered = 0;
+    while (waiter != NULL && registered < size && queues[registered]->registerWaiter != NULL
+           && queues[registered]->registerWaiter(queues[registered], waiter)) {
+        registered += 1;
+    }
+
+    bool polled = false;
+    if (registered < size) {
+        polled = sleepPollAny(queues, size, start, index, item, timeoutMs);
+    } else {
+        // an offer or a close after the check below notifies the waiter, so the await returns at once
+        for (;;) {
+            resetConditionWaiter(waiter);
+            closed = allClosed(queues, size);
+            if ((polled = tryPollAny(queues, size, start, index, item)) || closed || timeoutMs == 0) {
+                break;
+            }
+            timeoutMs = awaitConditionWaiter(waiter, timeoutMs);
+        }
+    }
+
+    for (size_t i = 0; i < registered; ++i) {
+        queues[i]->unregisterWaiter(queues[i], waiter);
+    }
+    return polled;
+}
+
+size_t drainBlockingQueue(BlockingQueue *queue, void *items, size_t itemSize, size_t maxItems, long timeoutMs) {
+    if (queue->drain != NULL) {
+        return queue->drain(queue, items, maxItems, timeoutMs);
+    }
+    if (maxItems == 0 || !queue->poll(queue, items, timeoutMs)) {
+        return 0;
+    }
+    size_t size = 1;
+    while (size < maxItems && queue->poll(queue, (char *) items + size * itemSize, 0)) {
+        size += 1;
+    }
+    return size;
+}
+
+QueueEventFd *newQueueEventFd(BlockingQueue *queue) {
+    if (queue->registerWaiter == NULL) {
+        return NULL;
+    }
+
+    QueueEventFd *eventFd = malloc(sizeof(QueueEventFd));
+    if (eventFd == NULL) {
+        return NULL;
+    }
+    eventFd->queue = queue;
+    eventFd->waiter = newEventFdConditionWaiter();
+    if (eventFd->waiter == NULL) {
+        free(eventFd);
+        return NULL;
+    }
+
+    // readable at first, the queue may be non-empty already
+    notifyConditionWaiter(eventFd->waiter);
+    if (!queue->registerWaiter(queue, eventFd->waiter)) {
+        freeConditionWaiter(eventFd->waiter);
+        free(eventFd);
+        return NULL;
+    }
+    return eventFd;
+}
+
+void freeQueueEventFd(QueueEventFd *eventFd) {
+    eventFd->queue->unregisterWaiter(eventFd->queue, eventFd->waiter);
+    freeConditionWaiter(eventFd->waiter);
+    free(eventFd);
+}
+
+int getQueueEventFd(QueueEventFd *eventFd) {
+    return getConditionWaiterEventFd(eventFd->waiter);
+}
+
+void resetQueueEventFd(QueueEventFd *eventFd) {
+    resetConditionWaiter(eventFd->waiter);
+}
@@ -0,0 +1,260 @@
+#include "ByteRingBuffer.h"
+#include "ReentrantLock.h"
+#include "Condition.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE_SIZE 64
+#define RECORD_ALIGNMENT 8
+#define MAX_RING_CAPACITY ((size_t) 1 << 31)
+
+/**
+ * The state of a record header. The space of released records is zeroed, so a header which is not committed yet
+ * reads as RECORD_STATE_EMPTY.
+ */
+enum RecordState {
+    RECORD_STATE_EMPTY,
+    RECORD_STATE_COMMITTED,
+    RECORD_STATE_PADDING
+};
+
+typedef struct RecordHeader {
+    uint32_t state;
+    uint32_t length;
+} RecordHeader;
+
+struct ByteRingBuffer {
+    size_t capacity;
+    size_t mask;
+    char *buffer;
+
+    ReentrantLock *lock;
+    Condition *nonFull;
+    Condition *nonEmpty;
+
+    /* claimed by the producers */
+    _Alignas(CACHE_LINE_SIZE) uint64_t tail;
+    int producerWaiters;
+
+    /* released by the consumer */
+    _Alignas(CACHE_LINE_SIZE) uint64_t head;
+    bool consumerWaiting;
+
+    /* owned by the consumer, the position after the polled records */
+    _Alignas(CACHE_LINE_SIZE) uint64_t polled;
+};
+
+inline static size_t recordSize(size_t length) {
+    return (sizeof(RecordHeader) + length + RECORD_ALIGNMENT - 1) & ~(size_t) (RECORD_ALIGNMENT - 1);
+}
+
+inline static RecordHeader *getHeader(ByteRingBuffer *ring, uint64_t position) {
+    return (RecordHeader *) (ring->buffer + (position & ring->mask));
+}
+
+ByteRingBuffer *newByteRingBuffer(size_t capacity) {
+    if (capacity > MAX_RING_CAPACITY) {
+        return NULL;
+    }
+    size_t size = CACHE_LINE_SIZE;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    ByteRingBuffer *ring = aligned_alloc(CACHE_LINE_SIZE, sizeof(ByteRingBuffer));
+    if (ring == NULL) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(ByteRingBuffer));
+
+    ring->capacity = size;
+    ring->mask = size - 1;
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->producerWaiters, 0);
+    atomic_init(&ring->consumerWaiting, false);
+
+    ring->buffer = aligned_alloc(CACHE_LINE_SIZE, size);
+    ring->lock = newReentrantLock();
+    if (ring->buffer == NULL || ring->lock == NULL) {
+        freeByteRingBuffer(ring);
+        return NULL;
+    }
+    memset(ring->buffer, 0, size);
+
+    ring->nonFull = newCondition(ring->lock);
+    ring->nonEmpty = newCondition(ring->lock);
+    if (ring->nonFull == NULL || ring->nonEmpty == NULL) {
+        freeByteRingBuffer(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+void freeByteRingBuffer(ByteRingBuffer *ring) {
+    if (ring->nonEmpty) {
+        freeCondition(ring->nonEmpty);
+    }
+    if (ring->nonFull) {
+        freeCondition(ring->nonFull);
+    }
+    if (ring->lock) {
+        freeReentrantLock(ring->lock);
+    }
+    free(ring->buffer);
+    free(ring);
+}
+
+size_t maxRecordByteRingBuffer(ByteRingBuffer *ring) {
+    return ring->capacity / 2 - sizeof(RecordHeader);
+}
+
+/**
+ * Wait until `size` bytes after `position` are released by the consumer.
+ *
+ * @return return false if timeout.
+ */
+static bool awaitSpace(ByteRingBuffer *ring, uint64_t position, size_t size, long *timeoutMs) {
+    if (*timeoutMs == 0) {
+        return false;
+    }
+
+    lockReentrantLock(ring->lock);
+    atomic_fetch_add(&ring->producerWaiters, 1);
+    // the consumer stores the head before it checks the waiters, so the head read here is not stale
+    while (position + size > atomic_load(&ring->head) + ring->capacity && *timeoutMs != 0) {
+        *timeoutMs = awaitCondition(ring->nonFull, *timeoutMs);
+    }
+    atomic_fetch_sub(&ring->producerWaiters, 1);
+    unlockReentrantLock(ring->lock);
+    return *timeoutMs != 0 || position + size <= atomic_load(&ring->head) + ring->capacity;
+}
+
+void *reserveByteRingBuffer(ByteRingBuffer *ring, size_t length, long timeoutMs) {
+    if (length > maxRecordByteRingBuffer(ring)) {
+        return NULL;
+    }
+
+    size_t size = recordSize(length);
+    uint64_t tail = atomic_load(&ring->tail);
+    for (;;) {
+        size_t offset = tail & ring->mask;
+        size_t padding = offset + size > ring->capacity ? ring->capacity - offset : 0;
+
+        // the tail may be stale and behind the head, so do not subtract
+        if (tail + padding + size > atomic_load(&ring->head) + ring->capacity) {
+            if (!awaitSpace(ring, tail, padding + size, &timeoutMs)) {
+                return NULL;
+            }
+            tail = atomic_load(&ring->tail);
+            continue;
+        }
+
+        if (atomic_compare_exchange_weak(&ring->tail, &tail, tail + padding + size)) {
+            if (padding > 0) {
+                RecordHeader *header = getHeader(ring, tail);
+                header->length = (uint32_t) (padding - sizeof(RecordHeader));
+                atomic_store_explicit(&header->state, RECORD_STATE_PADDING, memory_order_release);
+            }
+
+            RecordHeader *header = getHeader(ring, tail + padding);
+            header->length = (uint32_t) length;
+            return header + 1;
+        }
+    }
+}
+
+void commitByteRingBuffer(ByteRingBuffer *ring, void *record) {
+    RecordHeader *header = (RecordHeader *) record - 1;
+    atomic_store(&header->state, RECORD_STATE_COMMITTED);
+
+    // the consumer sets the flag before it checks the records, see pollByteRingBuffer
+    if (atomic_load(&ring->consumerWaiting)) {
+        lockReentrantLock(ring->lock);
+        signalCondition(ring->nonEmpty);
+        unlockReentrantLock(ring->lock);
+    }
+}
+
+bool offerByteRingBuffer(ByteRingBuffer *ring, const void *data, size_t length, long timeoutMs) {
+    void *record = reserveByteRingBuffer(ring, length, timeoutMs);
+    if (record == NULL) {
+        return false;
+    }
+    memcpy(record, data, length);
+    commitByteRingBuffer(ring, record);
+    return true;
+}
+
+/**
+ * Collect the committed records after the polled position, up to the first record which is not committed.
+ *
+ * @return the number of records.
+ */
+static size_t collectRecords(ByteRingBuffer *ring, ByteRecord *records, size_t maxRecords) {
+    uint64_t polled = ring->polled;
+    uint64_t limit = atomic_load_explicit(&ring->head, memory_order_relaxed) + ring->capacity;
+    size_t size = 0;
+
+    while (size < maxRecords && polled < limit) {
+        RecordHeader *header = getHeader(ring, polled);
+        uint32_t state = atomic_load(&header->state);
+        if (state == RECORD_STATE_EMPTY) {
+            break;
+        }
+
+        if (state == RECORD_STATE_COMMITTED) {
+            records[size].data = header + 1;
+            records[size].length = header->length;
+            size += 1;
+        }
+        polled += recordSize(header->length);
+    }
+    ring->polled = polled;
+    return size;
+}
+
+size_t pollByteRingBuffer(ByteRingBuffer *ring, ByteRecord *records, size_t maxRecords, long timeoutMs) {
+    size_t size = collectRecords(ring, records, maxRecords);
+    if (size > 0 || timeoutMs == 0 || maxRecords == 0) {
+        return size;
+    }
+
+    lockReentrantLock(ring->lock);
+    atomic_store(&ring->consumerWaiting, true);
+    while ((size = collectRecords(ring, records, maxRecords)) == 0 && timeoutMs != 0) {
+        timeoutMs = awaitCondition(ring->nonEmpty, timeoutMs);
+    }
+    atomic_store(&ring->consumerWaiting, false);
+    unlockReentrantLock(ring->lock);
+    return size;
+}
+
+void releaseByteRingBuffer(ByteRingBuffer *ring) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t polled = ring->polled;
+    if (head == polled) {
+        return;
+    }
+
+    // zero the released space, so the headers of the next records read as empty until they are committed
+    size_t offset = head & ring->mask;
+    size_t size = polled - head;
+    if (offset + size > ring->capacity) {
+        memset(ring->buffer + offset, 0, ring->capacity - offset);
+        memset(ring->buffer, 0, offset + size - ring->capacity);
+    } else {
+        memset(ring->buffer + offset, 0, size);
+    }
+    atomic_store(&ring->head, polled);
+
+    // producers increase the waiters before they check the head, see awaitSpace
+    if (atomic_load(&ring->producerWaiters) > 0) {
+        lockReentrantLock(ring->lock);
+        signalAllCondition(ring->nonFull);
+        unlockReentrantLock(ring->lock);
+    }
+}
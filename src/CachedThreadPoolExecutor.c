@@ -0,0 +1,229 @@
+#include "CachedThreadPoolExecutor.h"
+#include "SynchronousQueue.h"
+#include "WorkerInternal.h"
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREAD_NAME_MAX_LENGTH 64
+
+// forward declaration
+struct CachedThreadPoolExecutor;
+
+/**
+ * The state of the executor. SHUTDOWN runs the submitted tasks, STOP stops waiting for new ones too.
+ */
+enum ExecutorState {
+    EXECUTOR_STATE_RUNNING,
+    EXECUTOR_STATE_SHUTDOWN,
+    EXECUTOR_STATE_STOP
+};
+
+/**
+ * The context of a worker, freed by the worker when it exits.
+ */
+typedef struct ThreadContext {
+    struct CachedThreadPoolExecutor *executor;
+    char name[THREAD_NAME_MAX_LENGTH];
+    size_t id;
+    Runnable firstTask;
+} ThreadContext;
+
+/**
+ * An implementation of CachedThreadPoolExecutor. The workers are detached, shutdown waits until the number of live
+ * workers drops to 0.
+ */
+typedef struct CachedThreadPoolExecutor {
+    ExecutorService parent;
+    BlockingQueue *queue;
+    size_t maxThreadSize;
+    long keepAliveMs;
+    char format[THREAD_NAME_MAX_LENGTH];
+    enum ExecutorState s;
+    WorkerHooks hooks;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t terminated;
+    size_t threadSize;
+    size_t threadCount;
+} CachedThreadPoolExecutor;
+
+/* member functions */
+static void *executorThread(void *arg);
+static void executorFree(CachedThreadPoolExecutor *executor);
+static void executorShutdown(CachedThreadPoolExecutor *executor);
+static bool executorGetShutdown(CachedThreadPoolExecutor *executor);
+static bool executorSubmit(CachedThreadPoolExecutor *executor, void (*fn)(void *), void *arg);
+static Runnable *executorShutdownNow(CachedThreadPoolExecutor *executor, size_t *size);
+
+ExecutorService *newCachedThreadPoolExecutor(size_t maxThreadSize, long keepAliveMs, const char *format) {
+    return newCachedThreadPoolExecutorWithHooks(maxThreadSize, keepAliveMs, format, NULL);
+}
+
+ExecutorService *newCachedThreadPoolExecutorWithHooks(size_t maxThreadSize, long keepAliveMs, const char *format,
+                                                      const WorkerHooks *hooks) {
+    if (maxThreadSize == 0 || strlen(format) >= THREAD_NAME_MAX_LENGTH) {
+        return NULL;
+    }
+
+    CachedThreadPoolExecutor *executor = calloc(1, sizeof(CachedThreadPoolExecutor));
+    if (executor == NULL) {
+        return NULL;
+    }
+
+    // member function binding
+    ExecutorService parent = {
+            .free = (void (*)(struct ExecutorService *)) executorFree,
+            .shutdown = (void (*)(struct ExecutorService *)) executorShutdown,
+            .submit = (bool (*)(struct ExecutorService *, void (*)(void *), void *)) executorSubmit,
+            .isShutdown = (bool (*)(struct ExecutorService *)) executorGetShutdown,
+            .shutdownNow = (Runnable *(*)(struct ExecutorService *, size_t *)) executorShutdownNow
+    };
+    memcpy(&executor->parent, &parent, sizeof(ExecutorService));
+
+    executor->maxThreadSize = maxThreadSize;
+    executor->keepAliveMs = keepAliveMs;
+    strcpy(executor->format, format);
+    if (hooks != NULL) {
+        executor->hooks = *hooks;
+    }
+    pthread_mutex_init(&executor->mutex, NULL);
+    pthread_cond_init(&executor->terminated, NULL);
+    atomic_init(&executor->s, EXECUTOR_STATE_SHUTDOWN);
+
+    executor->queue = newSynchronousQueue(0, sizeof(Runnable));
+    if (executor->queue == NULL) {
+        executorFree(executor);
+        return NULL;
+    }
+
+    atomic_store(&executor->s, EXECUTOR_STATE_RUNNING);
+    return &executor->parent;
+}
+
+static void *executorThread(void *arg) {
+    ThreadContext *context = arg;
+    CachedThreadPoolExecutor *executor = context->executor;
+    BlockingQueue *queue = executor->queue;
+    Runnable r = context->firstTask;
+    Worker worker;
+
+#ifdef _GNU_SOURCE
+    pthread_setname_np(pthread_self(), context->name);
+#endif
+    startWorker(&worker, context->id, &executor->hooks);
+    free(context);
+
+    // a poll fails when the worker stays idle for keepAliveMs, or the queue is closed
+    do {
+        runWorkerTask(&worker, &r);
+    } while (atomic_load(&executor->s) != EXECUTOR_STATE_STOP && queue->poll(queue, &r, executor->keepAliveMs));
+    stopWorker(&worker);
+
+    pthread_mutex_lock(&executor->mutex);
+    if (--executor->threadSize == 0) {
+        pthread_cond_broadcast(&executor->terminated);
+    }
+    pthread_mutex_unlock(&executor->mutex);
+    return NULL;
+}
+
+/**
+ * Start a worker which runs the task first.
+ *
+ * @return return false if the pool is full, shutdown or failed.
+ */
+static bool addWorker(CachedThreadPoolExecutor *executor, Runnable *task) {
+    pthread_mutex_lock(&executor->mutex);
+    // checked under the mutex, so that shutdown waits for the worker
+    if (atomic_load(&executor->s) != EXECUTOR_STATE_RUNNING || executor->threadSize == executor->maxThreadSize) {
+        pthread_mutex_unlock(&executor->mutex);
+        return false;
+    }
+    executor->threadSize += 1;
+    size_t id = executor->threadCount++;
+    pthread_mutex_unlock(&executor->mutex);
+
+    ThreadContext *context = malloc(sizeof(ThreadContext));
+    pthread_t thread;
+    pthread_attr_t attr;
+    bool started = false;
+    if (context != NULL && pthread_attr_init(&attr) == 0) {
+        context->executor = executor;
+        context->id = id;
+        context->firstTask = *task;
+        if (strstr(executor->format, "%d") != NULL) {
+            snprintf(context->name, sizeof(context->name), executor->format, (int) id);
+        } else {
+            strcpy(context->name, executor->format);
+        }
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        started = pthread_create(&thread, &attr, executorThread, context) == 0;
+        pthread_attr_destroy(&attr);
+    }
+
+    if (!started) {
+        free(context);
+        pthread_mutex_lock(&executor->mutex);
+        if (--executor->threadSize == 0) {
+            pthread_cond_broadcast(&executor->terminated);
+        }
+        pthread_mutex_unlock(&executor->mutex);
+    }
+    return started;
+}
+
+static bool executorSubmit(CachedThreadPoolExecutor *executor, void (*fn)(void *), void *arg) {
+    if (atomic_load(&executor->s) != EXECUTOR_STATE_RUNNING) {
+        return false;
+    }
+    Runnable r = {.fn = fn, .arg = arg};
+    // hand the task to an idle worker, or start a new one if none waits
+    return executor->queue->offer(executor->queue, &r, 0) || addWorker(executor, &r);
+}
+
+static void executorFree(CachedThreadPoolExecutor *executor) {
+    executorShutdown(executor);
+    if (executor->queue) {
+        executor->queue->free(executor->queue);
+    }
+    pthread_cond_destroy(&executor->terminated);
+    pthread_mutex_destroy(&executor->mutex);
+    free(executor);
+}
+
+/**
+ * Close the queue, so that the idle workers exit, and wait for all the workers.
+ */
+static void terminateWorkers(CachedThreadPoolExecutor *executor) {
+    executor->queue->close(executor->queue);
+    pthread_mutex_lock(&executor->mutex);
+    while (executor->threadSize > 0) {
+        pthread_cond_wait(&executor->terminated, &executor->mutex);
+    }
+    pthread_mutex_unlock(&executor->mutex);
+}
+
+static void executorShutdown(CachedThreadPoolExecutor *executor) {
+    enum ExecutorState state = EXECUTOR_STATE_RUNNING;
+    if (atomic_compare_exchange_strong(&executor->s, &state, EXECUTOR_STATE_SHUTDOWN)) {
+        terminateWorkers(executor);
+    }
+}
+
+static Runnable *executorShutdownNow(CachedThreadPoolExecutor *executor, size_t *size) {
+    // no task is ever queued, every submitted task already runs
+    *size = 0;
+    enum ExecutorState state = EXECUTOR_STATE_RUNNING;
+    if (atomic_compare_exchange_strong(&executor->s, &state, EXECUTOR_STATE_STOP)) {
+        terminateWorkers(executor);
+    }
+    return NULL;
+}
+
+static bool executorGetShutdown(CachedThreadPoolExecutor *executor) {
+    return atomic_load(&executor->s) != EXECUTOR_STATE_RUNNING;
+}
@@ -0,0 +1,564 @@
+#include "ConcurrentHashMap.h"
+#include "ReentrantLock.h"
+#include "StripedCounter.h"
+#include "EpochDomain.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The number of lock stripes. It is also the minimum length of a table, so that the bins i and i + n of the
+ * next table always share the stripe of the bin i.
+ */
+#define STRIPES 64
+#define STRIPE_MASK (STRIPES - 1)
+
+/**
+ * The number of bins claimed by a writer each time it helps a resize.
+ */
+#define TRANSFER_STRIDE 16
+
+/**
+ * The keyLength of a forwarding node.
+ */
+#define FORWARD_KEY_LENGTH (~((size_t) 0))
+
+/**
+ * The entry of the map. The key and the hash are immutable, next and value are updated with release stores so
+ * that the lock-free readers always see an initialized node.
+ */
+typedef struct HashNode {
+    struct HashNode *next;
+    void *value;
+    uint64_t hash;
+    size_t keyLength;
+    char key[];
+} HashNode;
+
+typedef struct HashTable {
+    size_t length;
+
+    /* resize state, valid if the table is the next table of a resize */
+    struct HashTable *source;
+    HashNode *forward;
+    size_t transferIndex;
+    size_t transferred;
+    /* a helper failed to transfer some bins of its stride, which are left to a later helper */
+    bool failed;
+
+    HashNode *bins[];
+} HashTable;
+
+struct ConcurrentHashMap {
+    HashTable *table;
+    HashTable *nextTable;
+    StripedCounter *count;
+
+    ReentrantLock *resizeLock;
+    ReentrantLock *locks[STRIPES];
+
+    EpochDomain *epoch;
+};
+
+/* private member functions */
+inline static uint64_t hashKey(const void *key, size_t keyLength);
+static HashTable *newHashTable(size_t length);
+static void freeHashTable(void *ptr);
+static void freeHashChain(void *ptr);
+static void tryResize(ConcurrentHashMap *map, HashTable *table);
+static void helpTransfer(ConcurrentHashMap *map);
+
+ConcurrentHashMap *newConcurrentHashMap(size_t initialCapacity) {
+    ConcurrentHashMap *map = calloc(1, sizeof(ConcurrentHashMap));
+    if (map == NULL) {
+        return NULL;
+    }
+
+    // table length = next power of two of initialCapacity / 0.75
+    size_t length = STRIPES;
+    while (length - (length >> 2) < initialCapacity) {
+        length <<= 1;
+    }
+
+    atomic_init(&map->nextTable, NULL);
+    atomic_init(&map->table, newHashTable(length));
+    map->count = newStripedCounter();
+    map->resizeLock = newReentrantLock();
+    map->epoch = newEpochDomain();
+    if (map->table == NULL || map->count == NULL || map->resizeLock == NULL || map->epoch == NULL) {
+        freeConcurrentHashMap(map);
+        return NULL;
+    }
+
+    for (int i = 0; i < STRIPES; ++i) {
+        map->locks[i] = newReentrantLock();
+        if (map->locks[i] == NULL) {
+            freeConcurrentHashMap(map);
+            return NULL;
+        }
+    }
+    return map;
+}
+
+void freeConcurrentHashMap(ConcurrentHashMap *map) {
+    HashTable *tables[2] = {map->table, map->nextTable};
+    for (int t = 0; t < 2; ++t) {
+        if (tables[t] == NULL) {
+            continue;
+        }
+        for (size_t i = 0; i < tables[t]->length; ++i) {
+            HashNode *bin = tables[t]->bins[i];
+            if (bin != NULL && bin->keyLength != FORWARD_KEY_LENGTH) {
+                freeHashChain(bin);
+            }
+        }
+        freeHashTable(tables[t]);
+    }
+
+    if (map->epoch) {
+        freeEpochDomain(map->epoch);
+    }
+
+    for (int i = 0; i < STRIPES; ++i) {
+        if (map->locks[i]) {
+            freeReentrantLock(map->locks[i]);
+        }
+    }
+    if (map->resizeLock) {
+        freeReentrantLock(map->resizeLock);
+    }
+    if (map->count) {
+        freeStripedCounter(map->count);
+    }
+    free(map);
+}
+
+/**
+ * Hash the key. 8-byte keys are mixed directly, other keys are hashed by FNV-1a.
+ *
+ * @param key       the key.
+ * @param keyLength the length of the key.
+ * @return          the hash.
+ */
+inline static uint64_t hashKey(const void *key, size_t keyLength) {
+    uint64_t h;
+    if (keyLength == sizeof(uint64_t)) {
+        memcpy(&h, key, sizeof(uint64_t));
+    } else {
+        const unsigned char *bytes = key;
+        h = 14695981039346656037ull;
+        for (size_t i = 0; i < keyLength; ++i) {
+            h = (h ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+
+    // murmur3 finalizer
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+inline static bool matchNode(HashNode *node, uint64_t hash, const void *key, size_t keyLength) {
+    return node->hash == hash && node->keyLength == keyLength && memcmp(node->key, key, keyLength) == 0;
+}
+
+inline static HashNode *newHashNode(uint64_t hash, const void *key, size_t keyLength, void *value, HashNode *next) {
+    HashNode *node = malloc(sizeof(HashNode) + keyLength);
+    if (node == NULL) {
+        return NULL;
+    }
+    atomic_init(&node->next, next);
+    atomic_init(&node->value, value);
+    node->hash = hash;
+    node->keyLength = keyLength;
+    memcpy(node->key, key, keyLength);
+    return node;
+}
+
+static HashTable *newHashTable(size_t length) {
+    HashTable *table = calloc(1, sizeof(HashTable) + sizeof(HashNode *) * length);
+    if (table == NULL) {
+        return NULL;
+    }
+    table->length = length;
+    return table;
+}
+
+static void freeHashTable(void *ptr) {
+    HashTable *table = ptr;
+    free(table->forward);
+    free(table);
+}
+
+static void freeHashChain(void *ptr) {
+    HashNode *node = ptr;
+    while (node != NULL) {
+        HashNode *next = node->next;
+        free(node);
+        node = next;
+    }
+}
+
+/**
+ * Enter the read-side critical section. Nodes and tables retired after this call are not freed until the
+ * matching exitRead.
+ */
+inline static void enterRead(ConcurrentHashMap *map) {
+    enterEpochDomain(map->epoch);
+}
+
+inline static void exitRead(ConcurrentHashMap *map) {
+    exitEpochDomain(map->epoch);
+}
+
+inline static void retire(ConcurrentHashMap *map, void *ptr, void (*deleter)(void *)) {
+    retireEpochDomain(map->epoch, ptr, deleter);
+}
+
+inline static ReentrantLock *stripeLock(ConcurrentHashMap *map, size_t index) {
+    return map->locks[index & STRIPE_MASK];
+}
+
+inline static bool isForward(HashNode *node) {
+    return node != NULL && node->keyLength == FORWARD_KEY_LENGTH;
+}
+
+void *getConcurrentHashMap(ConcurrentHashMap *map, const void *key, size_t keyLength) {
+    uint64_t hash = hashKey(key, keyLength);
+    void *value = NULL;
+
+    enterRead(map);
+    HashTable *table = atomic_load(&map->table);
+    HashNode *node = atomic_load(&table->bins[hash & (table->length - 1)]);
+    while (isForward(node)) {
+        table = node->value;
+        node = atomic_load(&table->bins[hash & (table->length - 1)]);
+    }
+
+    for (; node != NULL; node = atomic_load(&node->next)) {
+        if (matchNode(node, hash, key, keyLength)) {
+            value = atomic_load(&node->value);
+            break;
+        }
+    }
+    exitRead(map);
+    return value;
+}
+
+/**
+ * Lock the bin of the hash, following the forwarding nodes of resizes.
+ *
+ * @param map   the concurrent hash map.
+ * @param hash  the hash of the key.
+ * @param index the index of the bin.
+ * @return      the table of the bin.
+ */
+inline static HashTable *lockBin(ConcurrentHashMap *map, uint64_t hash, size_t *index) {
+    HashTable *table = atomic_load(&map->table);
+    for (;;) {
+        size_t i = hash & (table->length - 1);
+        ReentrantLock *lock = stripeLock(map, i);
+        lockReentrantLock(lock);
+
+        HashNode *bin = atomic_load(&table->bins[i]);
+        if (!isForward(bin)) {
+            *index = i;
+            return table;
+        }
+
+        unlockReentrantLock(lock);
+        table = bin->value;
+    }
+}
+
+/**
+ * Insert a node into a locked bin and trigger a resize if the bin is crowded.
+ */
+inline static bool insertBin(ConcurrentHashMap *map, HashTable *table, size_t index, uint64_t hash,
+                             const void *key, size_t keyLength, void *value, bool *crowded) {
+    HashNode *bin = atomic_load_explicit(&table->bins[index], memory_order_relaxed);
+    HashNode *node = newHashNode(hash, key, keyLength, value, bin);
+    if (node == NULL) {
+        return false;
+    }
+    atomic_store_explicit(&table->bins[index], node, memory_order_release);
+    addStripedCounter(map->count, 1);
+    *crowded = bin != NULL;
+    return true;
+}
+
+/**
+ * Finish the update of the map: resize if needed and help the resize in progress.
+ */
+inline static void afterUpdate(ConcurrentHashMap *map, HashTable *table, bool crowded) {
+    if (crowded) {
+        tryResize(map, table);
+    }
+    if (atomic_load_explicit(&map->nextTable, memory_order_relaxed) != NULL) {
+        helpTransfer(map);
+    }
+}
+
+bool putConcurrentHashMap(ConcurrentHashMap *map, const void *key, size_t keyLength, void *value, void **previous) {
+    uint64_t hash = hashKey(key, keyLength);
+    bool crowded = false;
+    bool success = true;
+    void *old = NULL;
+
+    enterRead(map);
+    size_t index;
+    HashTable *table = lockBin(map, hash, &index);
+
+    HashNode *node = atomic_load_explicit(&table->bins[index], memory_order_relaxed);
+    for (; node != NULL; node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+        if (matchNode(node, hash, key, keyLength)) {
+            old = atomic_exchange(&node->value, value);
+            break;
+        }
+    }
+    if (node == NULL) {
+        success = insertBin(map, table, index, hash, key, keyLength, value, &crowded);
+    }
+    unlockReentrantLock(stripeLock(map, index));
+
+    afterUpdate(map, table, crowded);
+    exitRead(map);
+
+    if (previous != NULL) {
+        *previous = old;
+    }
+    return success;
+}
+
+void *removeConcurrentHashMap(ConcurrentHashMap *map, const void *key, size_t keyLength) {
+    uint64_t hash = hashKey(key, keyLength);
+    void *old = NULL;
+
+    enterRead(map);
+    size_t index;
+    HashTable *table = lockBin(map, hash, &index);
+
+    HashNode *prev = NULL;
+    HashNode *node = atomic_load_explicit(&table->bins[index], memory_order_relaxed);
+    for (; node != NULL; prev = node, node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+        if (matchNode(node, hash, key, keyLength)) {
+            HashNode *next = atomic_load_explicit(&node->next, memory_order_relaxed);
+            // seq_cst, so that the unlink is ordered before the epoch observed by retire
+            if (prev == NULL) {
+                atomic_store(&table->bins[index], next);
+            } else {
+                atomic_store(&prev->next, next);
+            }
+            old = atomic_load_explicit(&node->value, memory_order_relaxed);
+            addStripedCounter(map->count, -1);
+            retire(map, node, free);
+            break;
+        }
+    }
+    unlockReentrantLock(stripeLock(map, index));
+
+    afterUpdate(map, table, false);
+    exitRead(map);
+    return old;
+}
+
+void *computeIfAbsentConcurrentHashMap(ConcurrentHashMap *map, const void *key, size_t keyLength,
+                                       void *(*builder)(const void *key, size_t keyLength, void *arg), void *arg) {
+    void *value = getConcurrentHashMap(map, key, keyLength);
+    if (value != NULL) {
+        return value;
+    }
+
+    uint64_t hash = hashKey(key, keyLength);
+    bool crowded = false;
+
+    enterRead(map);
+    size_t index;
+    HashTable *table = lockBin(map, hash, &index);
+
+    HashNode *node = atomic_load_explicit(&table->bins[index], memory_order_relaxed);
+    for (; node != NULL; node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+        if (matchNode(node, hash, key, keyLength)) {
+            value = atomic_load_explicit(&node->value, memory_order_relaxed);
+            break;
+        }
+    }
+    if (node == NULL) {
+        value = builder(key, keyLength, arg);
+        if (value != NULL && !insertBin(map, table, index, hash, key, keyLength, value, &crowded)) {
+            value = NULL;
+        }
+    }
+    unlockReentrantLock(stripeLock(map, index));
+
+    afterUpdate(map, table, crowded);
+    exitRead(map);
+    return value;
+}
+
+size_t sizeConcurrentHashMap(ConcurrentHashMap *map) {
+    long long size = sumStripedCounter(map->count);
+    return size < 0 ? 0 : (size_t) size;
+}
+
+/**
+ * Start a resize of the table if the load factor exceeds 0.75. The resize is done incrementally by helpTransfer.
+ *
+ * @param map   the concurrent hash map.
+ * @param table the table observed by the writer.
+ */
+static void tryResize(ConcurrentHashMap *map, HashTable *table) {
+    if (atomic_load(&map->nextTable) != NULL || atomic_load(&map->table) != table) {
+        return;
+    }
+    if (sumStripedCounter(map->count) < (long long) (table->length - (table->length >> 2))) {
+        return;
+    }
+
+    lockReentrantLock(map->resizeLock);
+    if (atomic_load(&map->nextTable) == NULL && atomic_load(&map->table) == table) {
+        HashTable *next = newHashTable(table->length << 1);
+        HashNode *forward = calloc(1, sizeof(HashNode));
+        if (next != NULL && forward != NULL) {
+            forward->keyLength = FORWARD_KEY_LENGTH;
+            forward->value = next;
+            next->source = table;
+            next->forward = forward;
+            atomic_init(&next->transferIndex, table->length);
+            atomic_init(&next->transferred, 0);
+            atomic_init(&next->failed, false);
+            atomic_store(&map->nextTable, next);
+        } else {
+            free(next);
+            free(forward);
+        }
+    }
+    unlockReentrantLock(map->resizeLock);
+}
+
+/**
+ * Move the bin of the source table into the next table. The nodes are cloned, so that the readers traversing
+ * the old bin are not redirected, and the old chain is retired. A bin which is moved already is skipped.
+ *
+ * @param moved incremented if the bin is moved by this call.
+ * @return      return false if failed.
+ */
+static bool transferBin(ConcurrentHashMap *map, HashTable *source, HashTable *next, size_t index, size_t *moved) {
+    ReentrantLock *lock = stripeLock(map, index);
+    lockReentrantLock(lock);
+
+    HashNode *lo = NULL;
+    HashNode *hi = NULL;
+    HashNode *bin = atomic_load_explicit(&source->bins[index], memory_order_relaxed);
+    if (isForward(bin)) {
+        unlockReentrantLock(lock);
+        return true;
+    }
+    for (HashNode *node = bin; node != NULL; node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+        bool high = (node->hash & source->length) != 0;
+        HashNode *clone = newHashNode(node->hash, node->key, node->keyLength,
+                                      atomic_load_explicit(&node->value, memory_order_relaxed), high ? hi : lo);
+        if (clone == NULL) {
+            freeHashChain(lo);
+            freeHashChain(hi);
+            unlockReentrantLock(lock);
+            return false;
+        }
+        *(high ? &hi : &lo) = clone;
+    }
+
+    atomic_store_explicit(&next->bins[index], lo, memory_order_release);
+    atomic_store_explicit(&next->bins[index + source->length], hi, memory_order_release);
+    atomic_store(&source->bins[index], next->forward);
+    unlockReentrantLock(lock);
+
+    if (bin != NULL) {
+        retire(map, bin, freeHashChain);
+    }
+    *moved += 1;
+    return true;
+}
+
+/**
+ * Transfer the bins in [begin, end). A bin which cannot be transferred is left with the rest of the range to a
+ * later helper instead of being retried, as the allocation may keep failing. The helper moving the last bin
+ * publishes the next table.
+ */
+static void transferBins(ConcurrentHashMap *map, HashTable *source, HashTable *next, size_t begin, size_t end) {
+    size_t moved = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (!transferBin(map, source, next, i, &moved)) {
+            atomic_store(&next->failed, true);
+            break;
+        }
+    }
+
+    if (moved > 0 && atomic_fetch_add(&next->transferred, moved) + moved == source->length) {
+        atomic_store(&map->table, next);
+        atomic_store(&map->nextTable, NULL);
+        retire(map, source, freeHashTable);
+    }
+}
+
+/**
+ * Claim a stride of bins of the resize in progress and transfer them. The writer finishing the last stride
+ * publishes the next table.
+ *
+ * @param map   the concurrent hash map.
+ */
+static void helpTransfer(ConcurrentHashMap *map) {
+    HashTable *next = atomic_load(&map->nextTable);
+    if (next == NULL) {
+        return;
+    }
+    HashTable *source = next->source;
+
+    size_t end = atomic_load(&next->transferIndex);
+    do {
+        if (end == 0) {
+            // every stride is claimed, one helper at a time sweeps the bins left by a failed transfer
+            bool failed = true;
+            if (atomic_load(&next->failed) && atomic_compare_exchange_strong(&next->failed, &failed, false)) {
+                transferBins(map, source, next, 0, source->length);
+            }
+            return;
+        }
+    } while (!atomic_compare_exchange_weak(&next->transferIndex, &end,
+                                           end > TRANSFER_STRIDE ? end - TRANSFER_STRIDE : 0));
+
+    transferBins(map, source, next, end > TRANSFER_STRIDE ? end - TRANSFER_STRIDE : 0, end);
+}
+
+void forEachConcurrentHashMap(ConcurrentHashMap *map,
+                              void (*fn)(const void *key, size_t keyLength, void *value, void *arg), void *arg) {
+    enterRead(map);
+    for (int i = 0; i < STRIPES; ++i) {
+        lockReentrantLock(map->locks[i]);
+    }
+
+    // no bin can be transferred while all the stripes are locked, so there is at most one level of forwarding
+    HashTable *table = atomic_load(&map->table);
+    for (size_t i = 0; i < table->length; ++i) {
+        HashNode *bin = atomic_load(&table->bins[i]);
+        HashNode *chains[2] = {bin, NULL};
+        if (isForward(bin)) {
+            HashTable *next = bin->value;
+            chains[0] = atomic_load(&next->bins[i]);
+            chains[1] = atomic_load(&next->bins[i + table->length]);
+        }
+        for (int c = 0; c < 2; ++c) {
+            for (HashNode *node = chains[c]; node != NULL; node = atomic_load(&node->next)) {
+                fn(node->key, node->keyLength, atomic_load(&node->value), arg);
+            }
+        }
+    }
+
+    for (int i = STRIPES - 1; i >= 0; --i) {
+        unlockReentrantLock(map->locks[i]);
+    }
+    exitRead(map);
+}
@@ -1,7 +1,11 @@
 #include "Condition.h"
 #include "ThreadLocal.h"
+#include "LockProfilerInternal.h"
 
 #include <stdatomic.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 enum ConditionNodeState {
     WAITING,
@@ -15,11 +19,31 @@ struct ConditionNode {
     int state;
 };
 
+struct ConditionWaiter {
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    bool notified;
+
+    /* written by the first notification after a reset, -1 if none */
+    int eventFd;
+};
+
 struct Condition {
     ThreadLocal conditionNode;
     ReentrantLock *lock;
-    struct ConditionNode *waitHead;
+
+    /* the sentinel of the wait queue, not the node of any thread */
+    struct ConditionNode waitHead;
     struct ConditionNode *waitTail;
+
+    /* the registered waiters, notified by every signal */
+    ConditionWaiter **waiters;
+    size_t waiterSize;
+    size_t waiterCapacity;
+
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    LockProfile *profile;
+#endif
 };
 
 /**
@@ -60,15 +84,20 @@ inline static struct ConditionNode *newConditionNode() {
 /**
  * Remove the condition node form queue.
  * 
- * @param node the condition node.
+ * @param condition the condition variable.
+ * @param node      the condition node.
  */
-inline static void removeFromQueueConditionNode(struct ConditionNode *head, struct ConditionNode *node) {
-    while (head) {
-        if (head->next == node) {
-            head->next = node->next;
+inline static void removeFromQueueConditionNode(Condition *condition, struct ConditionNode *node) {
+    struct ConditionNode *prev = &condition->waitHead;
+    while (prev->next) {
+        if (prev->next == node) {
+            prev->next = node->next;
+            if (condition->waitTail == node) {
+                condition->waitTail = prev;
+            }
             return;
         }
-        head = head->next;
+        prev = prev->next;
     }
 }
 
@@ -99,26 +128,30 @@ Condition *newCondition(ReentrantLock *lock) {
 
     initThreadLocal(&condition->conditionNode);
 
-    void *head = computeIfAbsentThreadLocal(&condition->conditionNode, newConditionNodeTL, 0, freeConditionNodeTL);
-    if (head == NULL) {
-        free(condition);
-        return NULL;
-    }
-
     condition->lock = lock;
-    condition->waitHead = head;
-    condition->waitTail = condition->waitHead;
+    condition->waitHead.next = NULL;
+    condition->waitTail = &condition->waitHead;
     return condition;
 }
 
-void signalAllCondition(Condition *condition) {
-    while (condition->waitHead->next) {
-        signalCondition(condition);
+/**
+ * Notify the registered waiters. They wait for any of several conditions, so every signal notifies all of them.
+ *
+ * @param condition the condition variable.
+ */
+inline static void notifyConditionWaiters(Condition *condition) {
+    for (size_t i = 0; i < condition->waiterSize; ++i) {
+        notifyConditionWaiter(condition->waiters[i]);
     }
 }
 
-void signalCondition(Condition *condition) {
-    struct ConditionNode *waitHead = condition->waitHead;
+/**
+ * Wake the first waiting thread of the queue.
+ *
+ * @param condition the condition variable.
+ */
+inline static void signalFirstConditionNode(Condition *condition) {
+    struct ConditionNode *waitHead = &condition->waitHead;
     struct ConditionNode *firstNode = waitHead->next;
 
     if (firstNode) {
@@ -135,6 +168,18 @@ void signalCondition(Condition *condition) {
     }
 }
 
+void signalAllCondition(Condition *condition) {
+    while (condition->waitHead.next) {
+        signalFirstConditionNode(condition);
+    }
+    notifyConditionWaiters(condition);
+}
+
+void signalCondition(Condition *condition) {
+    signalFirstConditionNode(condition);
+    notifyConditionWaiters(condition);
+}
+
 long awaitCondition(Condition *condition, long timeoutMs) {
     struct timespec ts[2];
     struct timespec *current = NULL;
@@ -168,6 +213,11 @@ long awaitCondition(Condition *condition, long timeoutMs) {
     pthread_cond_t *cond = &waitNode->condition;
     pthread_mutex_t *mutex = nativeHandleReentrantLock(condition->lock);
 
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    int holds = suspendProfileReentrantLock(condition->lock);
+    unsigned long long parkedAt = condition->profile != NULL ? profileNow() : 0;
+#endif
+
     while (waitNode->state == WAITING) {
         int state;
         if (timeout != NULL) {
@@ -177,7 +227,7 @@ long awaitCondition(Condition *condition, long timeoutMs) {
         }
         // condition await timeout
         if (state != 0) {
-            removeFromQueueConditionNode(condition->waitHead, waitNode);
+            removeFromQueueConditionNode(condition, waitNode);
             break;
         }
     }
@@ -185,6 +235,13 @@ long awaitCondition(Condition *condition, long timeoutMs) {
     waitNode->next = NULL;
     waitNode->state = INVALID;
 
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    if (condition->profile != NULL) {
+        recordConditionAwait(condition->profile, profileNow() - parkedAt);
+    }
+    resumeProfileReentrantLock(condition->lock, holds);
+#endif
+
     if (timeoutMs == -1) {
         return -1;
     }
@@ -199,9 +256,153 @@ long awaitCondition(Condition *condition, long timeoutMs) {
     return leave < 0 ? 0 : leave;
 }
 
+void profileCondition(Condition *condition, const char *name) {
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    lockReentrantLock(condition->lock);
+    condition->profile = registerLockProfile(condition->profile, name, LOCK_PROFILE_CONDITION);
+    unlockReentrantLock(condition->lock);
+#endif
+}
+
 void freeCondition(Condition *condition) {
     destroyThreadLocal(&condition->conditionNode);
+    free(condition->waiters);
     free(condition);
 }
 
+ConditionWaiter *newConditionWaiter() {
+    ConditionWaiter *waiter = calloc(1, sizeof(ConditionWaiter));
+    if (waiter == NULL) {
+        return NULL;
+    }
+
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr)) {
+        free(waiter);
+        return NULL;
+    }
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int error = pthread_cond_init(&waiter->condition, &attr);
+    pthread_condattr_destroy(&attr);
+    if (error) {
+        free(waiter);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&waiter->mutex, NULL)) {
+        pthread_cond_destroy(&waiter->condition);
+        free(waiter);
+        return NULL;
+    }
+    waiter->eventFd = -1;
+    return waiter;
+}
+
+ConditionWaiter *newEventFdConditionWaiter() {
+    ConditionWaiter *waiter = newConditionWaiter();
+    if (waiter == NULL) {
+        return NULL;
+    }
+
+    waiter->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (waiter->eventFd == -1) {
+        freeConditionWaiter(waiter);
+        return NULL;
+    }
+    return waiter;
+}
+
+int getConditionWaiterEventFd(ConditionWaiter *waiter) {
+    return waiter->eventFd;
+}
+
+void freeConditionWaiter(ConditionWaiter *waiter) {
+    if (waiter->eventFd != -1) {
+        close(waiter->eventFd);
+    }
+    pthread_mutex_destroy(&waiter->mutex);
+    pthread_cond_destroy(&waiter->condition);
+    free(waiter);
+}
+
+bool registerConditionWaiter(Condition *condition, ConditionWaiter *waiter) {
+    if (condition->waiterSize == condition->waiterCapacity) {
+        size_t capacity = condition->waiterCapacity == 0 ? 4 : condition->waiterCapacity * 2;
+        ConditionWaiter **waiters = realloc(condition->waiters, sizeof(ConditionWaiter *) * capacity);
+        if (waiters == NULL) {
+            return false;
+        }
+        condition->waiters = waiters;
+        condition->waiterCapacity = capacity;
+    }
+    condition->waiters[condition->waiterSize++] = waiter;
+    return true;
+}
+
+void unregisterConditionWaiter(Condition *condition, ConditionWaiter *waiter) {
+    for (size_t i = 0; i < condition->waiterSize; ++i) {
+        if (condition->waiters[i] == waiter) {
+            condition->waiters[i] = condition->waiters[--condition->waiterSize];
+            return;
+        }
+    }
+}
+
+void notifyConditionWaiter(ConditionWaiter *waiter) {
+    pthread_mutex_lock(&waiter->mutex);
+    // the eventfd is written once until the next reset, however many notifications come meanwhile
+    if (!waiter->notified && waiter->eventFd != -1) {
+        uint64_t one = 1;
+        ssize_t written = write(waiter->eventFd, &one, sizeof(one));
+        (void) written;
+    }
+    waiter->notified = true;
+    pthread_cond_signal(&waiter->condition);
+    pthread_mutex_unlock(&waiter->mutex);
+}
+
+void resetConditionWaiter(ConditionWaiter *waiter) {
+    pthread_mutex_lock(&waiter->mutex);
+    if (waiter->notified && waiter->eventFd != -1) {
+        uint64_t count;
+        ssize_t drained = read(waiter->eventFd, &count, sizeof(count));
+        (void) drained;
+    }
+    waiter->notified = false;
+    pthread_mutex_unlock(&waiter->mutex);
+}
+
+long awaitConditionWaiter(ConditionWaiter *waiter, long timeoutMs) {
+    struct timespec current;
+    struct timespec timeout;
+    if (timeoutMs != -1) {
+        clock_gettime(CLOCK_MONOTONIC, &current);
+        timeout = current;
+        timeAfter(&timeout, timeoutMs);
+    }
+
+    pthread_mutex_lock(&waiter->mutex);
+    while (!waiter->notified && timeoutMs != 0) {
+        if (timeoutMs == -1) {
+            pthread_cond_wait(&waiter->condition, &waiter->mutex);
+        } else if (pthread_cond_timedwait(&waiter->condition, &waiter->mutex, &timeout) != 0) {
+            break;
+        }
+    }
+    waiter->notified = false;
+    pthread_mutex_unlock(&waiter->mutex);
+
+    if (timeoutMs == -1 || timeoutMs == 0) {
+        return timeoutMs;
+    }
+
+    struct timespec latest;
+    clock_gettime(CLOCK_MONOTONIC, &latest);
+    long duration = (long) (latest.tv_sec - current.tv_sec) * 1000;
+    duration += (latest.tv_nsec - current.tv_nsec) / 1000000;
+
+    long leave = timeoutMs - duration;
+    return leave < 0 ? 0 : leave;
+}
+
 
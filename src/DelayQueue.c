@@ -0,0 +1,238 @@
+#include "DelayQueue.h"
+#include "ReentrantLock.h"
+#include "Condition.h"
+#include "LockProfiler.h"
+#include "HeapInternal.h"
+#include <malloc.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#define DEADLINE_SIZE sizeof(uint64_t)
+
+/**
+ * A delay BlockingQueue implementation. A heap entry is the deadline of the item followed by the item, so the heap
+ * compares deadlines without calling the deadline function.
+ */
+typedef struct DelayQueue {
+    BlockingQueue parent;
+
+    ReentrantLock *lock;
+    Condition *nonFull;
+    Condition *available;
+
+    /* the consumer waiting for the deadline of the head, the others wait until it leaves */
+    pthread_t leader;
+    bool hasLeader;
+
+    Heap heap;
+    size_t itemSize;
+    DelayQueueDeadline deadline;
+    char *entry;
+    bool closed;
+} DelayQueue;
+
+/* member functions */
+static void queueFree(DelayQueue *queue);
+
+static bool queuePoll(DelayQueue *queue, void *item, long timeoutMs);
+
+static bool queueOffer(DelayQueue *queue, void *item, long timeoutMs);
+
+static void queueProfile(DelayQueue *queue, const char *name);
+
+static void queueClose(DelayQueue *queue);
+
+static bool queueIsClosed(DelayQueue *queue);
+
+static int compareDeadline(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+inline static uint64_t monotonicNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+uint64_t deadlineDelayQueue(long delayMs) {
+    return monotonicNs() + (uint64_t) delayMs * 1000000;
+}
+
+BlockingQueue *newDelayQueue(size_t capacity, size_t itemSize, DelayQueueDeadline deadline) {
+    size_t stride = (DEADLINE_SIZE + itemSize + DEADLINE_SIZE - 1) & ~(DEADLINE_SIZE - 1);
+    if (itemSize == 0 || deadline == NULL || stride < itemSize) {
+        return NULL;
+    }
+
+    DelayQueue *queue = calloc(1, sizeof(DelayQueue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    // member function binding, the waiters are not notified when a deadline expires, so there is no registerWaiter
+    BlockingQueue parent = {
+            .offer = (bool (*)(struct BlockingQueue *, void *, long)) queueOffer,
+            .free = (void (*)(struct BlockingQueue *)) queueFree,
+            .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll,
+            .profile = (void (*)(struct BlockingQueue *, const char *)) queueProfile,
+            .close = (void (*)(struct BlockingQueue *)) queueClose,
+            .isClosed = (bool (*)(struct BlockingQueue *)) queueIsClosed
+    };
+    memcpy(&queue->parent, &parent, sizeof(BlockingQueue));
+
+    queue->itemSize = itemSize;
+    queue->deadline = deadline;
+    queue->entry = malloc(stride);
+    if (queue->entry == NULL || !initHeap(&queue->heap, capacity, stride, compareDeadline)) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    queue->lock = newReentrantLock();
+    if (queue->lock == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    queue->nonFull = newCondition(queue->lock);
+    queue->available = newCondition(queue->lock);
+    if (queue->nonFull == NULL || queue->available == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    return &queue->parent;
+}
+
+static void queueFree(DelayQueue *queue) {
+    if (queue->available) {
+        freeCondition(queue->available);
+    }
+    if (queue->nonFull) {
+        freeCondition(queue->nonFull);
+    }
+    if (queue->lock) {
+        freeReentrantLock(queue->lock);
+    }
+    destroyHeap(&queue->heap);
+    free(queue->entry);
+    free(queue);
+}
+
+static bool queuePoll(DelayQueue *queue, void *item, long timeoutMs) {
+    lockReentrantLock(queue->lock);
+
+    for (;;) {
+        if (queue->heap.size == 0) {
+            if (timeoutMs == 0 || queue->closed) {
+                unlockReentrantLock(queue->lock);
+                return false;
+            }
+            timeoutMs = awaitCondition(queue->available, timeoutMs);
+            continue;
+        }
+
+        uint64_t deadline = *(uint64_t *) queue->heap.entries;
+        uint64_t now = monotonicNs();
+        if (deadline <= now) {
+            break;
+        }
+        if (timeoutMs == 0) {
+            // a leader leaving without the head hands it to a follower
+            if (!queue->hasLeader) {
+                signalCondition(queue->available);
+            }
+            unlockReentrantLock(queue->lock);
+            return false;
+        }
+
+        long delayMs = (long) ((deadline - now + 999999) / 1000000);
+        if (queue->hasLeader || (timeoutMs != -1 && timeoutMs < delayMs)) {
+            // an offer of an earlier deadline, or the leader taking the head, wakes the followers
+            timeoutMs = awaitCondition(queue->available, timeoutMs);
+        } else {
+            pthread_t self = pthread_self();
+            queue->leader = self;
+            queue->hasLeader = true;
+            long left = awaitCondition(queue->available, delayMs);
+            if (timeoutMs != -1) {
+                timeoutMs = timeoutMs > delayMs - left ? timeoutMs - (delayMs - left) : 0;
+            }
+            if (queue->hasLeader && pthread_equal(queue->leader, self)) {
+                queue->hasLeader = false;
+            }
+        }
+    }
+
+    popHeap(&queue->heap, queue->entry);
+    memcpy(item, queue->entry + DEADLINE_SIZE, queue->itemSize);
+
+    // hand the next deadline to a follower, or let them all see the end of a closed queue
+    if (queue->closed && queue->heap.size == 0) {
+        signalAllCondition(queue->available);
+    } else if (!queue->hasLeader && queue->heap.size > 0) {
+        signalCondition(queue->available);
+    }
+    signalCondition(queue->nonFull);
+    unlockReentrantLock(queue->lock);
+    return true;
+}
+
+static bool queueOffer(DelayQueue *queue, void *item, long timeoutMs) {
+    uint64_t deadline = queue->deadline(item);
+
+    lockReentrantLock(queue->lock);
+
+    while (queue->heap.size == queue->heap.capacity && !queue->closed) {
+        timeoutMs = awaitCondition(queue->nonFull, timeoutMs);
+
+        if (timeoutMs == 0) {
+            unlockReentrantLock(queue->lock);
+            return false;
+        }
+    }
+
+    memcpy(queue->entry, &deadline, DEADLINE_SIZE);
+    memcpy(queue->entry + DEADLINE_SIZE, item, queue->itemSize);
+    size_t index;
+    if (queue->closed || !pushHeap(&queue->heap, queue->entry, &index)) {
+        unlockReentrantLock(queue->lock);
+        return false;
+    }
+
+    // only a new earliest deadline concerns the waiting consumers, the leader waits for a later one
+    if (index == 0) {
+        queue->hasLeader = false;
+        signalCondition(queue->available);
+    }
+    unlockReentrantLock(queue->lock);
+    return true;
+}
+
+static void queueProfile(DelayQueue *queue, const char *name) {
+    char buffer[LOCK_PROFILE_NAME_MAX];
+    snprintf(buffer, sizeof(buffer), "%s.lock", name);
+    profileReentrantLock(queue->lock, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.available", name);
+    profileCondition(queue->available, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonFull", name);
+    profileCondition(queue->nonFull, buffer);
+}
+
+static void queueClose(DelayQueue *queue) {
+    lockReentrantLock(queue->lock);
+    queue->closed = true;
+    signalAllCondition(queue->available);
+    signalAllCondition(queue->nonFull);
+    unlockReentrantLock(queue->lock);
+}
+
+static bool queueIsClosed(DelayQueue *queue) {
+    lockReentrantLock(queue->lock);
+    bool closed = queue->closed;
+    unlockReentrantLock(queue->lock);
+    return closed;
+}
@@ -0,0 +1,305 @@
+#include "Disruptor.h"
+#include "ReentrantLock.h"
+#include "Condition.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE_SIZE 64
+#define ENTRY_ALIGNMENT 8
+#define MAX_DISRUPTOR_CAPACITY ((size_t) 1 << 40)
+
+struct DisruptorConsumer {
+    /* the next sequence to read, all the sequences before are released */
+    _Alignas(CACHE_LINE_SIZE) uint64_t sequence;
+
+    /* owned by the consumer thread, the end of the published sequences seen by the last scan */
+    uint64_t scanned;
+
+    Disruptor *disruptor;
+    DisruptorConsumer **dependencies;
+    size_t dependencySize;
+    bool gating;
+};
+
+struct Disruptor {
+    size_t capacity;
+    size_t mask;
+    size_t stride;
+    char *entries;
+
+    /* published[sequence & mask] == sequence + 1 once the sequence is published */
+    uint64_t *published;
+
+    DisruptorConsumer **consumers;
+    size_t consumerSize;
+
+    /* the consumers no other consumer depends on, whose sequences bound the producers */
+    DisruptorConsumer **gating;
+    size_t gatingSize;
+
+    /* producers and consumers wait on the same condition, signaled whenever a sequence advances */
+    ReentrantLock *lock;
+    Condition *advanced;
+
+    /* claimed by the producers */
+    _Alignas(CACHE_LINE_SIZE) uint64_t claimed;
+    uint64_t gatingCache;
+
+    _Alignas(CACHE_LINE_SIZE) int waiters;
+};
+
+Disruptor *newDisruptor(size_t capacity, size_t entrySize) {
+    if (capacity == 0 || capacity > MAX_DISRUPTOR_CAPACITY || entrySize == 0) {
+        return NULL;
+    }
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    size_t stride = (entrySize + ENTRY_ALIGNMENT - 1) & ~(size_t) (ENTRY_ALIGNMENT - 1);
+    if (stride < entrySize || SIZE_MAX / stride < size) {
+        return NULL;
+    }
+
+    Disruptor *disruptor = aligned_alloc(CACHE_LINE_SIZE, sizeof(Disruptor));
+    if (disruptor == NULL) {
+        return NULL;
+    }
+    memset(disruptor, 0, sizeof(Disruptor));
+
+    disruptor->capacity = size;
+    disruptor->mask = size - 1;
+    disruptor->stride = stride;
+    atomic_init(&disruptor->claimed, 0);
+    atomic_init(&disruptor->gatingCache, 0);
+    atomic_init(&disruptor->waiters, 0);
+
+    disruptor->entries = calloc(size, stride);
+    disruptor->published = calloc(size, sizeof(uint64_t));
+    disruptor->lock = newReentrantLock();
+    if (disruptor->entries == NULL || disruptor->published == NULL || disruptor->lock == NULL) {
+        freeDisruptor(disruptor);
+        return NULL;
+    }
+
+    disruptor->advanced = newCondition(disruptor->lock);
+    if (disruptor->advanced == NULL) {
+        freeDisruptor(disruptor);
+        return NULL;
+    }
+    return disruptor;
+}
+
+void freeDisruptor(Disruptor *disruptor) {
+    for (size_t i = 0; i < disruptor->consumerSize; ++i) {
+        free(disruptor->consumers[i]->dependencies);
+        free(disruptor->consumers[i]);
+    }
+    free(disruptor->consumers);
+    free(disruptor->gating);
+    if (disruptor->advanced) {
+        freeCondition(disruptor->advanced);
+    }
+    if (disruptor->lock) {
+        freeReentrantLock(disruptor->lock);
+    }
+    free(disruptor->published);
+    free(disruptor->entries);
+    free(disruptor);
+}
+
+DisruptorConsumer *addConsumerDisruptor(Disruptor *disruptor, DisruptorConsumer *const *dependencies,
+                                        size_t dependencySize) {
+    for (size_t i = 0; i < dependencySize; ++i) {
+        if (dependencies[i]->disruptor != disruptor) {
+            return NULL;
+        }
+    }
+
+    DisruptorConsumer **consumers = realloc(disruptor->consumers,
+                                            sizeof(DisruptorConsumer *) * (disruptor->consumerSize + 1));
+    if (consumers == NULL) {
+        return NULL;
+    }
+    disruptor->consumers = consumers;
+
+    DisruptorConsumer **gating = realloc(disruptor->gating,
+                                         sizeof(DisruptorConsumer *) * (disruptor->gatingSize + 1));
+    if (gating == NULL) {
+        return NULL;
+    }
+    disruptor->gating = gating;
+
+    DisruptorConsumer *consumer = aligned_alloc(CACHE_LINE_SIZE, sizeof(DisruptorConsumer));
+    if (consumer == NULL) {
+        return NULL;
+    }
+    memset(consumer, 0, sizeof(DisruptorConsumer));
+    consumer->disruptor = disruptor;
+    consumer->gating = true;
+    atomic_init(&consumer->sequence, atomic_load(&disruptor->claimed));
+    consumer->scanned = consumer->sequence;
+
+    if (dependencySize > 0) {
+        consumer->dependencies = malloc(sizeof(DisruptorConsumer *) * dependencySize);
+        if (consumer->dependencies == NULL) {
+            free(consumer);
+            return NULL;
+        }
+        memcpy(consumer->dependencies, dependencies, sizeof(DisruptorConsumer *) * dependencySize);
+        consumer->dependencySize = dependencySize;
+    }
+
+    // a dependency never passes its dependents, so only the consumers at the end of the chains bound the producers
+    for (size_t i = 0; i < dependencySize; ++i) {
+        dependencies[i]->gating = false;
+    }
+    consumers[disruptor->consumerSize++] = consumer;
+    disruptor->gatingSize = 0;
+    for (size_t i = 0; i < disruptor->consumerSize; ++i) {
+        if (consumers[i]->gating) {
+            gating[disruptor->gatingSize++] = consumers[i];
+        }
+    }
+    return consumer;
+}
+
+/**
+ * @return the minimum sequence of the gating consumers, or the claimed sequence if there is no consumer.
+ */
+inline static uint64_t minimumGatingSequence(Disruptor *disruptor, uint64_t claimed) {
+    uint64_t minimum = claimed;
+    for (size_t i = 0; i < disruptor->gatingSize; ++i) {
+        uint64_t sequence = atomic_load(&disruptor->gating[i]->sequence);
+        minimum = sequence < minimum ? sequence : minimum;
+    }
+    return minimum;
+}
+
+/**
+ * Wait until the sequences before `end` are released by the gating consumers.
+ *
+ * @return return false if timeout.
+ */
+static bool awaitGating(Disruptor *disruptor, uint64_t end, long *timeoutMs) {
+    if (*timeoutMs == 0) {
+        return false;
+    }
+
+    lockReentrantLock(disruptor->lock);
+    atomic_fetch_add(&disruptor->waiters, 1);
+    // the consumers store their sequence before they check the waiters, see releaseDisruptorConsumer
+    while (end > minimumGatingSequence(disruptor, end) + disruptor->capacity && *timeoutMs != 0) {
+        *timeoutMs = awaitCondition(disruptor->advanced, *timeoutMs);
+    }
+    atomic_fetch_sub(&disruptor->waiters, 1);
+    unlockReentrantLock(disruptor->lock);
+    return *timeoutMs != 0 || end <= minimumGatingSequence(disruptor, end) + disruptor->capacity;
+}
+
+bool claimDisruptor(Disruptor *disruptor, size_t count, uint64_t *first, long timeoutMs) {
+    if (count == 0 || count > disruptor->capacity) {
+        return false;
+    }
+
+    uint64_t claimed = atomic_load(&disruptor->claimed);
+    for (;;) {
+        uint64_t end = claimed + count;
+        // a stale cached minimum is still a lower bound, it only makes the producer look again
+        if (end > atomic_load_explicit(&disruptor->gatingCache, memory_order_acquire) + disruptor->capacity) {
+            uint64_t gating = minimumGatingSequence(disruptor, claimed);
+            atomic_store_explicit(&disruptor->gatingCache, gating, memory_order_release);
+
+            if (end > gating + disruptor->capacity) {
+                if (!awaitGating(disruptor, end, &timeoutMs)) {
+                    return false;
+                }
+                claimed = atomic_load(&disruptor->claimed);
+                continue;
+            }
+        }
+
+        if (atomic_compare_exchange_weak(&disruptor->claimed, &claimed, end)) {
+            *first = claimed;
+            return true;
+        }
+    }
+}
+
+void *entryDisruptor(Disruptor *disruptor, uint64_t sequence) {
+    return disruptor->entries + (sequence & disruptor->mask) * disruptor->stride;
+}
+
+inline static void signalAdvanced(Disruptor *disruptor) {
+    if (atomic_load(&disruptor->waiters) > 0) {
+        lockReentrantLock(disruptor->lock);
+        signalAllCondition(disruptor->advanced);
+        unlockReentrantLock(disruptor->lock);
+    }
+}
+
+void publishDisruptor(Disruptor *disruptor, uint64_t first, size_t count) {
+    for (uint64_t sequence = first; sequence < first + count; ++sequence) {
+        atomic_store_explicit(&disruptor->published[sequence & disruptor->mask], sequence + 1,
+                              memory_order_release);
+    }
+
+    // waiters increase the count before they check the sequences, see waitForDisruptorConsumer
+    atomic_thread_fence(memory_order_seq_cst);
+    signalAdvanced(disruptor);
+}
+
+/**
+ * @return the end of the consecutive sequences available to the consumer.
+ */
+static uint64_t availableSequence(DisruptorConsumer *consumer) {
+    Disruptor *disruptor = consumer->disruptor;
+    if (consumer->dependencySize > 0) {
+        // the dependencies only release published sequences
+        uint64_t minimum = atomic_load(&consumer->dependencies[0]->sequence);
+        for (size_t i = 1; i < consumer->dependencySize; ++i) {
+            uint64_t sequence = atomic_load(&consumer->dependencies[i]->sequence);
+            minimum = sequence < minimum ? sequence : minimum;
+        }
+        return minimum;
+    }
+
+    // producers publish out of order, so scan the flags up to the first sequence which is not published
+    uint64_t sequence = consumer->sequence;
+    uint64_t end = consumer->scanned > sequence ? consumer->scanned : sequence;
+    while (end < sequence + disruptor->capacity
+           && atomic_load_explicit(&disruptor->published[end & disruptor->mask], memory_order_acquire) == end + 1) {
+        end += 1;
+    }
+    consumer->scanned = end;
+    return end;
+}
+
+size_t waitForDisruptorConsumer(DisruptorConsumer *consumer, uint64_t *first, long timeoutMs) {
+    Disruptor *disruptor = consumer->disruptor;
+    uint64_t sequence = consumer->sequence;
+    *first = sequence;
+
+    uint64_t end = availableSequence(consumer);
+    if (end > sequence || timeoutMs == 0) {
+        return end - sequence;
+    }
+
+    lockReentrantLock(disruptor->lock);
+    atomic_fetch_add(&disruptor->waiters, 1);
+    while ((end = availableSequence(consumer)) == sequence && timeoutMs != 0) {
+        timeoutMs = awaitCondition(disruptor->advanced, timeoutMs);
+    }
+    atomic_fetch_sub(&disruptor->waiters, 1);
+    unlockReentrantLock(disruptor->lock);
+    return end - sequence;
+}
+
+void releaseDisruptorConsumer(DisruptorConsumer *consumer, size_t count) {
+    atomic_store(&consumer->sequence, consumer->sequence + count);
+
+    // producers and dependents increase the waiters before they check the sequence, see awaitGating
+    signalAdvanced(consumer->disruptor);
+}
@@ -0,0 +1,253 @@
+#include "EpochDomain.h"
+#include "ThreadLocal.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/**
+ * A thread tries to reclaim every EPOCH_RECLAIM_THRESHOLD retired pointers.
+ */
+#define EPOCH_RECLAIM_THRESHOLD 64
+
+/**
+ * A thread holding retired pointers also tries to reclaim them every EPOCH_EXIT_RECLAIM_PERIOD exits.
+ */
+#define EPOCH_EXIT_RECLAIM_PERIOD 128
+
+#define EPOCH_ACTIVE ((size_t) 1)
+
+typedef struct RetiredPointer {
+    struct RetiredPointer *next;
+    void *ptr;
+
+    void (*deleter)(void *);
+} RetiredPointer;
+
+/**
+ * The pointers retired by a thread in one epoch.
+ */
+struct LimboList {
+    size_t epoch;
+    RetiredPointer *head;
+    size_t size;
+};
+
+/**
+ * The registration of a thread in the domain. A record is owned by the domain and by the thread using it (refs),
+ * and is reused by a new thread after its thread exits.
+ */
+typedef struct EpochRecord {
+    struct EpochRecord *next;
+
+    /* (epoch << 1) | EPOCH_ACTIVE if the thread is in a critical region, 0 otherwise */
+    size_t state;
+    bool inUse;
+    int refs;
+
+    /* accessed by the owner thread only */
+    int nesting;
+    size_t exits;
+    struct LimboList limbo[3];
+} EpochRecord;
+
+struct EpochDomain {
+    size_t epoch;
+    EpochRecord *records;
+    ThreadLocal record;
+};
+
+/* private member functions */
+static void *acquireEpochRecord(void *arg);
+static void releaseEpochRecord(void *arg);
+
+EpochDomain *newEpochDomain() {
+    EpochDomain *domain = calloc(1, sizeof(EpochDomain));
+    if (domain == NULL) {
+        return NULL;
+    }
+
+    atomic_init(&domain->epoch, 0);
+    atomic_init(&domain->records, NULL);
+    initThreadLocal(&domain->record);
+    return domain;
+}
+
+inline static void freeRetiredPointers(RetiredPointer *retired) {
+    while (retired != NULL) {
+        RetiredPointer *next = retired->next;
+        retired->deleter(retired->ptr);
+        free(retired);
+        retired = next;
+    }
+}
+
+inline static void freeLimboList(struct LimboList *limbo) {
+    freeRetiredPointers(limbo->head);
+    limbo->head = NULL;
+    limbo->size = 0;
+}
+
+void freeEpochDomain(EpochDomain *domain) {
+    destroyThreadLocal(&domain->record);
+
+    EpochRecord *record = atomic_load(&domain->records);
+    while (record != NULL) {
+        EpochRecord *next = record->next;
+        for (int i = 0; i < 3; ++i) {
+            freeLimboList(&record->limbo[i]);
+        }
+        if (atomic_fetch_sub(&record->refs, 1) == 1) {
+            free(record);
+        }
+        record = next;
+    }
+    free(domain);
+}
+
+/**
+ * Reuse the record of an exited thread, or register a new one.
+ *
+ * @param arg   the epoch domain.
+ * @return      the record of the current thread (may be NULL if failed).
+ */
+static void *acquireEpochRecord(void *arg) {
+    EpochDomain *domain = arg;
+
+    for (EpochRecord *record = atomic_load(&domain->records); record != NULL; record = record->next) {
+        bool inUse = false;
+        if (!atomic_load(&record->inUse) && atomic_compare_exchange_strong(&record->inUse, &inUse, true)) {
+            atomic_fetch_add(&record->refs, 1);
+            return record;
+        }
+    }
+
+    EpochRecord *record = calloc(1, sizeof(EpochRecord));
+    if (record == NULL) {
+        return NULL;
+    }
+    atomic_init(&record->state, 0);
+    atomic_init(&record->inUse, true);
+    atomic_init(&record->refs, 2);
+
+    record->next = atomic_load(&domain->records);
+    while (!atomic_compare_exchange_weak(&domain->records, &record->next, record));
+    return record;
+}
+
+/**
+ * Release the record at thread exit. The retired pointers stay in the record until it is reused or the domain is
+ * freed. The domain may be freed already, so only the record is touched.
+ *
+ * @param arg   the record.
+ */
+static void releaseEpochRecord(void *arg) {
+    EpochRecord *record = arg;
+    record->nesting = 0;
+    atomic_store(&record->state, 0);
+    atomic_store(&record->inUse, false);
+
+    if (atomic_fetch_sub(&record->refs, 1) == 1) {
+        for (int i = 0; i < 3; ++i) {
+            freeLimboList(&record->limbo[i]);
+        }
+        free(record);
+    }
+}
+
+inline static EpochRecord *getEpochRecord(EpochDomain *domain) {
+    EpochRecord *record = getThreadLocal(&domain->record);
+    if (record == NULL) {
+        record = computeIfAbsentThreadLocal(&domain->record, acquireEpochRecord, domain, releaseEpochRecord);
+    }
+    return record;
+}
+
+/**
+ * Advance the global epoch if every thread in a critical region has observed it.
+ *
+ * @param domain    the epoch domain.
+ * @return          the global epoch.
+ */
+static size_t tryAdvanceEpoch(EpochDomain *domain) {
+    size_t epoch = atomic_load(&domain->epoch);
+    for (EpochRecord *record = atomic_load(&domain->records); record != NULL; record = record->next) {
+        size_t state = atomic_load(&record->state);
+        if ((state & EPOCH_ACTIVE) && (state >> 1) != epoch) {
+            return epoch;
+        }
+    }
+
+    if (atomic_compare_exchange_strong(&domain->epoch, &epoch, epoch + 1)) {
+        return epoch + 1;
+    }
+    return epoch;
+}
+
+/**
+ * Free the limbo lists retired at least two epochs ago: every thread which could read them has left its
+ * critical region since then.
+ */
+inline static void freeExpiredLimboLists(EpochRecord *record, size_t epoch) {
+    for (int i = 0; i < 3; ++i) {
+        struct LimboList *limbo = &record->limbo[i];
+        if (limbo->head != NULL && epoch >= limbo->epoch + 2) {
+            freeLimboList(limbo);
+        }
+    }
+}
+
+void enterEpochDomain(EpochDomain *domain) {
+    EpochRecord *record = getEpochRecord(domain);
+    if (record->nesting++ == 0) {
+        size_t epoch = atomic_load(&domain->epoch);
+        atomic_store(&record->state, (epoch << 1) | EPOCH_ACTIVE);
+    }
+}
+
+void exitEpochDomain(EpochDomain *domain) {
+    EpochRecord *record = getEpochRecord(domain);
+    if (--record->nesting == 0) {
+        atomic_store_explicit(&record->state, 0, memory_order_release);
+
+        bool retired = record->limbo[0].head || record->limbo[1].head || record->limbo[2].head;
+        if (retired && ++record->exits % EPOCH_EXIT_RECLAIM_PERIOD == 0) {
+            reclaimEpochDomain(domain);
+        }
+    }
+}
+
+void retireEpochDomain(EpochDomain *domain, void *ptr, void (*deleter)(void *)) {
+    EpochRecord *record = getEpochRecord(domain);
+    RetiredPointer *retired = malloc(sizeof(RetiredPointer));
+    if (record == NULL || retired == NULL) {
+        // leak rather than free a pointer which may be read
+        free(retired);
+        return;
+    }
+
+    size_t epoch = atomic_load(&domain->epoch);
+    struct LimboList *limbo = &record->limbo[epoch % 3];
+    if (limbo->epoch != epoch) {
+        // the list was retired at most at epoch - 3
+        freeLimboList(limbo);
+        limbo->epoch = epoch;
+    }
+
+    retired->ptr = ptr;
+    retired->deleter = deleter;
+    retired->next = limbo->head;
+    limbo->head = retired;
+    limbo->size += 1;
+
+    if (limbo->size % EPOCH_RECLAIM_THRESHOLD == 0) {
+        reclaimEpochDomain(domain);
+    }
+}
+
+void reclaimEpochDomain(EpochDomain *domain) {
+    EpochRecord *record = getEpochRecord(domain);
+    if (record == NULL) {
+        return;
+    }
+    freeExpiredLimboLists(record, tryAdvanceEpoch(domain));
+}
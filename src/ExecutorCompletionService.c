@@ -0,0 +1,108 @@
+#include "ExecutorCompletionService.h"
+#include "SegmentedBlockingQueue.h"
+#include "ObjectPool.h"
+
+#include <malloc.h>
+#include <stdatomic.h>
+
+/**
+ * A submitted task, with the service to complete it on.
+ */
+typedef struct CompletionTask {
+    struct ExecutorCompletionService *service;
+    Runnable task;
+} CompletionTask;
+
+struct ExecutorCompletionService {
+    ExecutorService *executor;
+
+    /* the finished tasks, unbounded so that a worker never waits for the consumer */
+    BlockingQueue *completed;
+    ObjectPool *taskPool;
+
+    /* created at the first call of getExecutorCompletionServiceEventFd */
+    QueueEventFd *eventFd;
+};
+
+ExecutorCompletionService *newExecutorCompletionService(ExecutorService *executor) {
+    ExecutorCompletionService *service = calloc(1, sizeof(ExecutorCompletionService));
+    if (service == NULL) {
+        return NULL;
+    }
+
+    service->executor = executor;
+    atomic_init(&service->eventFd, NULL);
+    service->completed = newSegmentedBlockingQueue(BLOCKING_QUEUE_UNBOUNDED, sizeof(Runnable));
+    service->taskPool = newObjectPool(sizeof(CompletionTask));
+    if (service->completed == NULL || service->taskPool == NULL) {
+        freeExecutorCompletionService(service);
+        return NULL;
+    }
+    return service;
+}
+
+void freeExecutorCompletionService(ExecutorCompletionService *service) {
+    QueueEventFd *eventFd = atomic_load(&service->eventFd);
+    if (eventFd != NULL) {
+        freeQueueEventFd(eventFd);
+    }
+    if (service->completed) {
+        service->completed->free(service->completed);
+    }
+    if (service->taskPool) {
+        freeObjectPool(service->taskPool);
+    }
+    free(service);
+}
+
+/**
+ * Run the task on a worker, then queue it as finished.
+ */
+static void runCompletionTask(void *arg) {
+    CompletionTask *completionTask = arg;
+    ExecutorCompletionService *service = completionTask->service;
+    Runnable task = completionTask->task;
+    deallocateObjectPool(service->taskPool, completionTask);
+
+    task.fn(task.arg);
+    service->completed->offer(service->completed, &task, -1);
+}
+
+bool submitExecutorCompletionService(ExecutorCompletionService *service, void (*fn)(void *), void *arg) {
+    CompletionTask *completionTask = allocateObjectPool(service->taskPool);
+    if (completionTask == NULL) {
+        return false;
+    }
+    completionTask->service = service;
+    completionTask->task.fn = fn;
+    completionTask->task.arg = arg;
+
+    ExecutorService *executor = service->executor;
+    if (!executor->submit(executor, runCompletionTask, completionTask)) {
+        deallocateObjectPool(service->taskPool, completionTask);
+        return false;
+    }
+    return true;
+}
+
+bool pollExecutorCompletionService(ExecutorCompletionService *service, Runnable *task, long timeoutMs) {
+    return service->completed->poll(service->completed, task, timeoutMs);
+}
+
+QueueEventFd *getExecutorCompletionServiceEventFd(ExecutorCompletionService *service) {
+    QueueEventFd *eventFd = atomic_load(&service->eventFd);
+    if (eventFd != NULL) {
+        return eventFd;
+    }
+
+    // a concurrent first call may win, keep its eventfd
+    QueueEventFd *created = newQueueEventFd(service->completed);
+    if (created == NULL) {
+        return NULL;
+    }
+    if (!atomic_compare_exchange_strong(&service->eventFd, &eventFd, created)) {
+        freeQueueEventFd(created);
+        return eventFd;
+    }
+    return created;
+}
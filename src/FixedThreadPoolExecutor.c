@@ -1,4 +1,5 @@
 #include "FixedThreadPoolExecutor.h"
+#include "WorkerInternal.h"
 
 #include <stdatomic.h>
 #include <pthread.h>
@@ -12,11 +13,12 @@
 struct FixedThreadPoolExecutor;
 
 /**
- * The state of the task and the executor.
+ * The state of the executor. SHUTDOWN runs the queued tasks, STOP hands them back.
  */
-enum TaskState {
-    TASK_STATE_RUNNING,
-    TASK_STATE_SHUTDOWN
+enum ExecutorState {
+    EXECUTOR_STATE_RUNNING,
+    EXECUTOR_STATE_SHUTDOWN,
+    EXECUTOR_STATE_STOP
 };
 
 typedef struct ThreadContext {
@@ -24,17 +26,9 @@ typedef struct ThreadContext {
     char name[THREAD_NAME_MAX_LENGTH];
     pthread_t thread;
     size_t thread_id;
+    Worker worker;
 } ThreadContext;
 
-/**
- * Represents the runnable closure and its context.
- */
-typedef struct Task {
-    void (*fn)(void *);
-    void *arg;
-    enum TaskState state;
-} Task;
-
 /**
  * An implementation of FixedThreadPoolExecutor.
  */
@@ -42,7 +36,14 @@ typedef struct FixedThreadPoolExecutor {
     ExecutorService parent;
     BlockingQueue *queue;
     size_t threadSize;
-    enum TaskState s;
+    enum ExecutorState s;
+    WorkerHooks hooks;
+
+    /* the tasks which never started, collected by shutdownNow */
+    pthread_mutex_t pendingMutex;
+    Runnable *pending;
+    size_t pendingSize;
+    size_t pendingCapacity;
 
     ThreadContext contexts[];
 } FixedThreadPoolExecutor;
@@ -53,12 +54,22 @@ static void executorFree(FixedThreadPoolExecutor *executor);
 static void executorShutdown(FixedThreadPoolExecutor *executor);
 static bool executorGetShutdown(FixedThreadPoolExecutor *executor);
 static bool executorSubmit(FixedThreadPoolExecutor *executor, void (*fn)(void *), void *arg);
+static Runnable *executorShutdownNow(FixedThreadPoolExecutor *executor, size_t *size);
 
 ExecutorService
 *newFixedThreadPoolExecutor(size_t threadSize,
                             size_t taskQueueSize,
                             const char *format,
                             BlockingQueueBuilder builder) {
+    return newFixedThreadPoolExecutorWithHooks(threadSize, taskQueueSize, format, builder, NULL);
+}
+
+ExecutorService
+*newFixedThreadPoolExecutorWithHooks(size_t threadSize,
+                                     size_t taskQueueSize,
+                                     const char *format,
+                                     BlockingQueueBuilder builder,
+                                     const WorkerHooks *hooks) {
 
     FixedThreadPoolExecutor *executor = calloc(1, sizeof(FixedThreadPoolExecutor) + sizeof(ThreadContext) * threadSize);
     if (executor == NULL) {
@@ -70,20 +81,25 @@ ExecutorService
             .free = (void (*)(struct ExecutorService *)) executorFree,
             .shutdown = (void (*)(struct ExecutorService *)) executorShutdown,
             .submit = (bool (*)(struct ExecutorService *, void (*)(void *), void *)) executorSubmit,
-            .isShutdown = (bool (*)(struct ExecutorService *)) executorGetShutdown
+            .isShutdown = (bool (*)(struct ExecutorService *)) executorGetShutdown,
+            .shutdownNow = (Runnable *(*)(struct ExecutorService *, size_t *)) executorShutdownNow
     };
     memcpy(&executor->parent, &parent, sizeof(ExecutorService));
     
     executor->threadSize = 0;
-    executor->queue = builder(taskQueueSize, sizeof(Task));
-    atomic_init(&executor->s, TASK_STATE_SHUTDOWN);
+    if (hooks != NULL) {
+        executor->hooks = *hooks;
+    }
+    pthread_mutex_init(&executor->pendingMutex, NULL);
+    executor->queue = builder(taskQueueSize, sizeof(Runnable));
+    atomic_init(&executor->s, EXECUTOR_STATE_SHUTDOWN);
 
     if (executor->queue == NULL) {
         executorFree(executor);
         return NULL;
     }
 
-    atomic_store(&executor->s, TASK_STATE_RUNNING);
+    atomic_store(&executor->s, EXECUTOR_STATE_RUNNING);
 
     for (int i = 0; i < threadSize; ++i) {
         ThreadContext *context = &executor->contexts[i];
@@ -107,33 +123,61 @@ ExecutorService
     return &executor->parent;
 }
 
+/**
+ * Keep a task which never started for shutdownNow. A task is dropped if the memory runs out.
+ */
+static void addPendingTask(FixedThreadPoolExecutor *executor, Runnable *task) {
+    pthread_mutex_lock(&executor->pendingMutex);
+    if (executor->pendingSize == executor->pendingCapacity) {
+        size_t capacity = executor->pendingCapacity == 0 ? 16 : executor->pendingCapacity * 2;
+        Runnable *pending = realloc(executor->pending, sizeof(Runnable) * capacity);
+        if (pending != NULL) {
+            executor->pending = pending;
+            executor->pendingCapacity = capacity;
+        }
+    }
+    if (executor->pendingSize < executor->pendingCapacity) {
+        executor->pending[executor->pendingSize++] = *task;
+    }
+    pthread_mutex_unlock(&executor->pendingMutex);
+}
+
 static void *executorThread(void *arg) {
     ThreadContext *context = arg;
     FixedThreadPoolExecutor *executor = context->executor;
     BlockingQueue *queue = executor->queue;
-    Task r;
+    Runnable r;
     
 #ifdef _GNU_SOURCE
     pthread_setname_np(pthread_self(), context->name);
 #endif
+    startWorker(&context->worker, context->thread_id, &executor->hooks);
     
     for (;;) {
         if (!queue->poll(queue, &r, -1)) {
+            // only a closed and drained queue fails a poll without timeout
+            if (queue->isClosed(queue)) {
+                break;
+            }
             continue;
         }
 
-        if (r.state == TASK_STATE_SHUTDOWN) {
-            return NULL;
+        if (atomic_load(&executor->s) == EXECUTOR_STATE_STOP) {
+            addPendingTask(executor, &r);
+            break;
         }
-        r.fn(r.arg);
+        runWorkerTask(&context->worker, &r);
     }
+
+    stopWorker(&context->worker);
+    return NULL;
 }
 
 static bool executorSubmit(FixedThreadPoolExecutor *executor, void (*fn)(void *), void *arg) {
-    if (atomic_load(&executor->s) == TASK_STATE_SHUTDOWN) {
+    if (atomic_load(&executor->s) != EXECUTOR_STATE_RUNNING) {
         return false;
     }
-    Task r = {.fn = fn, .arg = arg, .state = TASK_STATE_RUNNING};
+    Runnable r = {.fn = fn, .arg = arg};
     return executor->queue->offer(executor->queue, &r, 0);
 }
 
@@ -142,18 +186,16 @@ static void executorFree(FixedThreadPoolExecutor *executor) {
     if (executor->queue) {
         executor->queue->free(executor->queue);
     }
+    pthread_mutex_destroy(&executor->pendingMutex);
+    free(executor->pending);
     free(executor);
 }
 
 static void executorShutdown(FixedThreadPoolExecutor *executor) {
-    enum TaskState state = TASK_STATE_RUNNING;
-    if (atomic_compare_exchange_strong(&executor->s, &state, TASK_STATE_SHUTDOWN)) {
-        BlockingQueue *queue = executor->queue;
-
-        Task stop = {.fn = NULL, .arg = NULL, .state = TASK_STATE_SHUTDOWN};
-        for (int i = 0; i < executor->threadSize; ++i) {
-            queue->offer(queue, &stop, -1);
-        }
+    enum ExecutorState state = EXECUTOR_STATE_RUNNING;
+    if (atomic_compare_exchange_strong(&executor->s, &state, EXECUTOR_STATE_SHUTDOWN)) {
+        // the workers drain the closed queue and exit
+        executor->queue->close(executor->queue);
 
         for (int i = 0; i < executor->threadSize; ++i) {
             pthread_join(executor->contexts[i].thread, NULL);
@@ -161,7 +203,34 @@ static void executorShutdown(FixedThreadPoolExecutor *executor) {
     }
 }
 
+static Runnable *executorShutdownNow(FixedThreadPoolExecutor *executor, size_t *size) {
+    *size = 0;
+    enum ExecutorState state = EXECUTOR_STATE_RUNNING;
+    if (!atomic_compare_exchange_strong(&executor->s, &state, EXECUTOR_STATE_STOP)) {
+        return NULL;
+    }
+
+    BlockingQueue *queue = executor->queue;
+    queue->close(queue);
+
+    // a worker which polls a task after the stop hands it back too
+    Runnable r;
+    while (queue->poll(queue, &r, 0)) {
+        addPendingTask(executor, &r);
+    }
+    for (int i = 0; i < executor->threadSize; ++i) {
+        pthread_join(executor->contexts[i].thread, NULL);
+    }
+
+    Runnable *pending = executor->pending;
+    *size = executor->pendingSize;
+    executor->pending = NULL;
+    executor->pendingSize = 0;
+    executor->pendingCapacity = 0;
+    return pending;
+}
+
 static bool executorGetShutdown(FixedThreadPoolExecutor *executor) {
-    return atomic_load(&executor->s) == TASK_STATE_SHUTDOWN;
+    return atomic_load(&executor->s) != EXECUTOR_STATE_RUNNING;
 }
 
@@ -0,0 +1,249 @@
+#include "HazardPointerDomain.h"
+#include "ThreadLocal.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/**
+ * The minimum number of retired pointers of a thread which triggers a scan.
+ */
+#define HAZARD_RECLAIM_THRESHOLD 64
+
+typedef struct RetiredPointer {
+    struct RetiredPointer *next;
+    void *ptr;
+
+    void (*deleter)(void *);
+} RetiredPointer;
+
+/**
+ * The registration of a thread in the domain. A record is owned by the domain and by the thread using it (refs),
+ * and is reused by a new thread after its thread exits.
+ */
+typedef struct HazardRecord {
+    struct HazardRecord *next;
+    bool inUse;
+    int refs;
+
+    /* accessed by the owner thread only */
+    RetiredPointer *retired;
+    size_t retiredSize;
+
+    size_t hazardSize;
+    void *hazards[];
+} HazardRecord;
+
+struct HazardPointerDomain {
+    size_t hazards;
+    size_t recordSize;
+    HazardRecord *records;
+    ThreadLocal record;
+};
+
+/* private member functions */
+static void *acquireHazardRecord(void *arg);
+static void releaseHazardRecord(void *arg);
+
+HazardPointerDomain *newHazardPointerDomain(size_t hazards) {
+    HazardPointerDomain *domain = calloc(1, sizeof(HazardPointerDomain));
+    if (domain == NULL) {
+        return NULL;
+    }
+
+    domain->hazards = hazards;
+    atomic_init(&domain->recordSize, 0);
+    atomic_init(&domain->records, NULL);
+    initThreadLocal(&domain->record);
+    return domain;
+}
+
+inline static void freeRetiredPointers(RetiredPointer *retired) {
+    while (retired != NULL) {
+        RetiredPointer *next = retired->next;
+        retired->deleter(retired->ptr);
+        free(retired);
+        retired = next;
+    }
+}
+
+void freeHazardPointerDomain(HazardPointerDomain *domain) {
+    destroyThreadLocal(&domain->record);
+
+    HazardRecord *record = atomic_load(&domain->records);
+    while (record != NULL) {
+        HazardRecord *next = record->next;
+        freeRetiredPointers(record->retired);
+        record->retired = NULL;
+        record->retiredSize = 0;
+        if (atomic_fetch_sub(&record->refs, 1) == 1) {
+            free(record);
+        }
+        record = next;
+    }
+    free(domain);
+}
+
+/**
+ * Reuse the record of an exited thread, or register a new one.
+ *
+ * @param arg   the hazard pointer domain.
+ * @return      the record of the current thread (may be NULL if failed).
+ */
+static void *acquireHazardRecord(void *arg) {
+    HazardPointerDomain *domain = arg;
+
+    for (HazardRecord *record = atomic_load(&domain->records); record != NULL; record = record->next) {
+        bool inUse = false;
+        if (!atomic_load(&record->inUse) && atomic_compare_exchange_strong(&record->inUse, &inUse, true)) {
+            atomic_fetch_add(&record->refs, 1);
+            return record;
+        }
+    }
+
+    HazardRecord *record = calloc(1, sizeof(HazardRecord) + sizeof(void *) * domain->hazards);
+    if (record == NULL) {
+        return NULL;
+    }
+    atomic_init(&record->inUse, true);
+    atomic_init(&record->refs, 2);
+    record->hazardSize = domain->hazards;
+    for (size_t i = 0; i < domain->hazards; ++i) {
+        atomic_init(&record->hazards[i], NULL);
+    }
+
+    record->next = atomic_load(&domain->records);
+    while (!atomic_compare_exchange_weak(&domain->records, &record->next, record));
+    atomic_fetch_add(&domain->recordSize, 1);
+    return record;
+}
+
+/**
+ * Release the record at thread exit. The retired pointers stay in the record until it is reused or the domain is
+ * freed. The domain may be freed already, so only the record is touched.
+ *
+ * @param arg   the record.
+ */
+static void releaseHazardRecord(void *arg) {
+    HazardRecord *record = arg;
+    for (size_t i = 0; i < record->hazardSize; ++i) {
+        atomic_store(&record->hazards[i], NULL);
+    }
+    atomic_store(&record->inUse, false);
+
+    if (atomic_fetch_sub(&record->refs, 1) == 1) {
+        freeRetiredPointers(record->retired);
+        free(record);
+    }
+}
+
+inline static HazardRecord *getHazardRecord(HazardPointerDomain *domain) {
+    HazardRecord *record = getThreadLocal(&domain->record);
+    if (record == NULL) {
+        record = computeIfAbsentThreadLocal(&domain->record, acquireHazardRecord, domain, releaseHazardRecord);
+    }
+    return record;
+}
+
+void *protectHazardPointerDomain(HazardPointerDomain *domain, size_t index, void *const *source) {
+    HazardRecord *record = getHazardRecord(domain);
+    if (record == NULL) {
+        // the pointer cannot be protected, so it is not returned
+        return NULL;
+    }
+
+    void *ptr = atomic_load(source);
+    for (;;) {
+        atomic_store(&record->hazards[index], ptr);
+
+        // the pointer is protected only if it is still reachable after the hazard pointer is published
+        void *latest = atomic_load(source);
+        if (latest == ptr) {
+            return ptr;
+        }
+        ptr = latest;
+    }
+}
+
+void clearHazardPointerDomain(HazardPointerDomain *domain, size_t index) {
+    HazardRecord *record = getHazardRecord(domain);
+    if (record == NULL) {
+        return;
+    }
+    atomic_store_explicit(&record->hazards[index], NULL, memory_order_release);
+}
+
+void retireHazardPointerDomain(HazardPointerDomain *domain, void *ptr, void (*deleter)(void *)) {
+    HazardRecord *record = getHazardRecord(domain);
+    RetiredPointer *retired = malloc(sizeof(RetiredPointer));
+    if (record == NULL || retired == NULL) {
+        // leak rather than free a pointer which may be read
+        free(retired);
+        return;
+    }
+
+    retired->ptr = ptr;
+    retired->deleter = deleter;
+    retired->next = record->retired;
+    record->retired = retired;
+    record->retiredSize += 1;
+
+    // scanning costs O(R log H), so scan when R exceeds 2 * H to keep retire amortized O(log H)
+    size_t threshold = 2 * domain->hazards * atomic_load(&domain->recordSize);
+    if (record->retiredSize >= (threshold > HAZARD_RECLAIM_THRESHOLD ? threshold : HAZARD_RECLAIM_THRESHOLD)) {
+        reclaimHazardPointerDomain(domain);
+    }
+}
+
+static int comparePointer(const void *a, const void *b) {
+    const void *x = *(void *const *) a;
+    const void *y = *(void *const *) b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+void reclaimHazardPointerDomain(HazardPointerDomain *domain) {
+    HazardRecord *record = getHazardRecord(domain);
+    if (record == NULL || record->retired == NULL) {
+        return;
+    }
+
+    // snapshot the hazard pointers, records are never removed from the list. A record registered after the
+    // snapshot of the head cannot protect a pointer which was unlinked before the scan.
+    HazardRecord *head = atomic_load(&domain->records);
+    size_t capacity = 0;
+    for (HazardRecord *r = head; r != NULL; r = r->next) {
+        capacity += domain->hazards;
+    }
+
+    void **hazards = malloc(sizeof(void *) * (capacity == 0 ? 1 : capacity));
+    if (hazards == NULL) {
+        return;
+    }
+
+    size_t size = 0;
+    for (HazardRecord *r = head; r != NULL; r = r->next) {
+        for (size_t i = 0; i < domain->hazards; ++i) {
+            void *ptr = atomic_load(&r->hazards[i]);
+            if (ptr != NULL) {
+                hazards[size++] = ptr;
+            }
+        }
+    }
+    qsort(hazards, size, sizeof(void *), comparePointer);
+
+    RetiredPointer *retired = record->retired;
+    record->retired = NULL;
+    record->retiredSize = 0;
+    while (retired != NULL) {
+        RetiredPointer *next = retired->next;
+        if (bsearch(&retired->ptr, hazards, size, sizeof(void *), comparePointer) == NULL) {
+            retired->deleter(retired->ptr);
+            free(retired);
+        } else {
+            retired->next = record->retired;
+            record->retired = retired;
+            record->retiredSize += 1;
+        }
+        retired = next;
+    }
+    free(hazards);
+}
@@ -0,0 +1,135 @@
+#ifndef ZUTIL_CONCURRENT_HEAPINTERNAL_H
+#define ZUTIL_CONCURRENT_HEAPINTERNAL_H
+
+#include "BlockingQueue.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A 4-ary min heap of fixed size entries, stored inline in one contiguous array, shared by PriorityBlockingQueue.c
+ * and DelayQueue.c. The four children of an entry are adjacent, so a sift down compares them within one or two
+ * cache lines, and the heap is half as deep as a binary heap. Not synchronized.
+ */
+
+#define HEAP_ARITY 4
+#define HEAP_INITIAL_SIZE 16
+
+typedef struct Heap {
+    /* one more entry than allocated, the scratch entry of a push */
+    char *entries;
+    size_t stride;
+    size_t size;
+    size_t allocated;
+    size_t capacity;
+
+    int (*compare)(const void *, const void *);
+} Heap;
+
+inline static char *entryHeap(Heap *heap, size_t index) {
+    return heap->entries + index * heap->stride;
+}
+
+/**
+ * @param capacity  the maximum number of entries, or BLOCKING_QUEUE_UNBOUNDED. The array grows up to it.
+ * @return          return false if failed.
+ */
+inline static bool initHeap(Heap *heap, size_t capacity, size_t stride, int (*compare)(const void *, const void *)) {
+    heap->stride = stride;
+    heap->size = 0;
+    heap->capacity = capacity;
+    heap->compare = compare;
+    heap->allocated = capacity < HEAP_INITIAL_SIZE ? capacity : HEAP_INITIAL_SIZE;
+    heap->entries = malloc((heap->allocated + 1) * stride);
+    return heap->entries != NULL;
+}
+
+inline static void destroyHeap(Heap *heap) {
+    free(heap->entries);
+}
+
+/**
+ * Double the array, up to the capacity.
+ *
+ * @return return false if full or failed.
+ */
+inline static bool growHeap(Heap *heap) {
+    if (heap->allocated == heap->capacity) {
+        return false;
+    }
+    size_t allocated = heap->allocated > heap->capacity / 2 ? heap->capacity : heap->allocated * 2;
+    if (allocated >= SIZE_MAX / heap->stride) {
+        return false;
+    }
+    char *entries = realloc(heap->entries, (allocated + 1) * heap->stride);
+    if (entries == NULL) {
+        return false;
+    }
+    heap->entries = entries;
+    heap->allocated = allocated;
+    return true;
+}
+
+/**
+ * Push an entry, moving its parents down into the hole until its place is found.
+ *
+ * @param index the index of the pushed entry, 0 if it is the new minimum.
+ * @return      return false if full or failed.
+ */
+inline static bool pushHeap(Heap *heap, const void *entry, size_t *index) {
+    if (heap->size == heap->allocated && !growHeap(heap)) {
+        return false;
+    }
+
+    char *scratch = entryHeap(heap, heap->allocated);
+    memcpy(scratch, entry, heap->stride);
+    size_t hole = heap->size++;
+    while (hole > 0) {
+        size_t parent = (hole - 1) / HEAP_ARITY;
+        if (heap->compare(scratch, entryHeap(heap, parent)) >= 0) {
+            break;
+        }
+        memcpy(entryHeap(heap, hole), entryHeap(heap, parent), heap->stride);
+        hole = parent;
+    }
+    memcpy(entryHeap(heap, hole), scratch, heap->stride);
+    *index = hole;
+    return true;
+}
+
+/**
+ * Pop the minimum, then sift the last entry down from the root. The heap must not be empty.
+ */
+inline static void popHeap(Heap *heap, void *entry) {
+    memcpy(entry, heap->entries, heap->stride);
+    size_t size = --heap->size;
+    if (size == 0) {
+        return;
+    }
+
+    // the last entry stays in place until the sift ends, no hole reaches it
+    char *last = entryHeap(heap, size);
+    size_t hole = 0;
+    for (;;) {
+        size_t first = hole * HEAP_ARITY + 1;
+        if (first >= size) {
+            break;
+        }
+        size_t end = first + HEAP_ARITY < size ? first + HEAP_ARITY : size;
+        size_t least = first;
+        for (size_t child = first + 1; child < end; ++child) {
+            if (heap->compare(entryHeap(heap, child), entryHeap(heap, least)) < 0) {
+                least = child;
+            }
+        }
+        if (heap->compare(entryHeap(heap, least), last) >= 0) {
+            break;
+        }
+        memcpy(entryHeap(heap, hole), entryHeap(heap, least), heap->stride);
+        hole = least;
+    }
+    memcpy(entryHeap(heap, hole), last, heap->stride);
+}
+
+#endif //ZUTIL_CONCURRENT_HEAPINTERNAL_H
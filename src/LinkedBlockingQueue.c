@@ -5,6 +5,8 @@
 
 #include "ReentrantLock.h"
 #include "Condition.h"
+#include "LockProfiler.h"
+#include "ObjectPool.h"
 
 /**
  * The linked node in Linked BlockingQueue.
@@ -29,6 +31,11 @@ typedef struct LinkedBlockingQueue {
     size_t count;
     size_t itemSize;
 
+    /* written under both locks, so either lock is enough to read it */
+    bool closed;
+
+    /* the nodes are recycled through the pool instead of malloc/free */
+    ObjectPool *nodePool;
     LinkedNode *head;
     LinkedNode *tail;
 } LinkedBlockingQueue;
@@ -37,10 +44,22 @@ typedef struct LinkedBlockingQueue {
 static void queueFree(LinkedBlockingQueue *queue);
 static bool queuePoll(LinkedBlockingQueue *queue, void *item, long timeoutMs);
 static bool queueOffer(LinkedBlockingQueue *queue, void *item, long timeoutMs);
+static void queueProfile(LinkedBlockingQueue *queue, const char *name);
+
+static bool queueRegisterWaiter(LinkedBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueUnregisterWaiter(LinkedBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueClose(LinkedBlockingQueue *queue);
+
+static bool queueIsClosed(LinkedBlockingQueue *queue);
+
+static size_t queueDrain(LinkedBlockingQueue *queue, void *items, size_t maxItems, long timeoutMs);
 
 /* private member functions */
-inline static LinkedNode *newNode(void *item, size_t itemSize);
-inline static int enqueue(LinkedBlockingQueue *queue, void *item);
+inline static LinkedNode *newNode(LinkedBlockingQueue *queue, void *item);
+inline static int enqueue(LinkedBlockingQueue *queue, LinkedNode *node);
+inline static void takeNode(LinkedBlockingQueue *queue, void *item);
 inline static int dequeue(LinkedBlockingQueue *queue, void *item);
 
 
@@ -54,7 +73,13 @@ BlockingQueue *newLinkedBlockingQueue(size_t capacity, size_t itemSize) {
     BlockingQueue parent = {
             .offer = (bool (*)(struct BlockingQueue *, void *, long)) queueOffer,
             .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll,
-            .free = (void (*)(struct BlockingQueue *)) queueFree
+            .free = (void (*)(struct BlockingQueue *)) queueFree,
+            .profile = (void (*)(struct BlockingQueue *, const char *)) queueProfile,
+            .registerWaiter = (bool (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueRegisterWaiter,
+            .unregisterWaiter = (void (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueUnregisterWaiter,
+            .close = (void (*)(struct BlockingQueue *)) queueClose,
+            .isClosed = (bool (*)(struct BlockingQueue *)) queueIsClosed,
+            .drain = (size_t (*)(struct BlockingQueue *, void *, size_t, long)) queueDrain
     };
     memcpy(&queue->parent, &parent, sizeof(BlockingQueue));
 
@@ -76,7 +101,13 @@ BlockingQueue *newLinkedBlockingQueue(size_t capacity, size_t itemSize) {
         return NULL;
     }
 
-    queue->head = newNode(NULL, itemSize);
+    queue->nodePool = newObjectPool(sizeof(LinkedNode) + itemSize);
+    if (queue->nodePool == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    queue->head = newNode(queue, NULL);
     queue->tail = queue->head;
     if (queue->head == NULL) {
         queueFree(queue);
@@ -88,18 +119,20 @@ BlockingQueue *newLinkedBlockingQueue(size_t capacity, size_t itemSize) {
 /**
  * Create a linked node.
  * 
+ * @param queue     the blocking queue.
  * @param item      the item in the linked node.
- * @param itemSize  the size of item.
  * @return 
  */
-inline static LinkedNode *newNode(void *item, size_t itemSize) {
-    if (item == NULL) {
-        return calloc(1, sizeof(LinkedNode));
+inline static LinkedNode *newNode(LinkedBlockingQueue *queue, void *item) {
+    LinkedNode *node = allocateObjectPool(queue->nodePool);
+    if (node == NULL) {
+        return NULL;
     }
 
-    LinkedNode *node = malloc(sizeof(LinkedNode) + itemSize);
     node->next = NULL;
-    memcpy(node->data, item, itemSize);
+    if (item != NULL) {
+        memcpy(node->data, item, queue->itemSize);
+    }
     return node;
 }
 
@@ -108,12 +141,15 @@ static void queueFree(LinkedBlockingQueue *queue) {
         lockReentrantLock(queue->takeLock);
     }
 
+    // the nodes go back to the pool before it is freed
     LinkedNode *node = queue->head;
     while (node != NULL) {
         LinkedNode *next = node->next;
-        free(node);
+        deallocateObjectPool(queue->nodePool, node);
         node = next;
     }
+    queue->head = NULL;
+    queue->tail = NULL;
 
     if (queue->takeLock) {
         unlockReentrantLock(queue->takeLock);
@@ -130,19 +166,21 @@ static void queueFree(LinkedBlockingQueue *queue) {
     if (queue->putLock) {
         freeReentrantLock(queue->putLock);
     }
+    if (queue->nodePool) {
+        freeObjectPool(queue->nodePool);
+    }
     free(queue);
 
 }
 
 /**
- * Put an item from the queue.
+ * Put a node with an item to the queue.
  * 
  * @param queue     the blocking queue.
- * @param item      the item to be put.
+ * @param node      the node to be put, from newNode.
  * @return          the number of item before enqueue.
  */
-inline static int enqueue(LinkedBlockingQueue *queue, void *item) {
-    LinkedNode *node = newNode(item, queue->itemSize);
+inline static int enqueue(LinkedBlockingQueue *queue, LinkedNode *node) {
     queue->tail->next = node;
     queue->tail = node;
 
@@ -150,20 +188,29 @@ inline static int enqueue(LinkedBlockingQueue *queue, void *item) {
 }
 
 /**
- * Take an item from the queue.
- * 
+ * Unlink the first node, without counting it.
+ *
  * @param queue     the blocking queue.
  * @param item      the return item.
- * @return          the number of item before dequeue.
  */
-inline static int dequeue(LinkedBlockingQueue *queue, void *item) {
+inline static void takeNode(LinkedBlockingQueue *queue, void *item) {
     LinkedNode *h = queue->head;
     LinkedNode *first = h->next;
-    
+
     queue->head = first;
     memcpy(item, first->data, queue->itemSize);
-    free(h);
- 
+    deallocateObjectPool(queue->nodePool, h);
+}
+
+/**
+ * Take an item from the queue.
+ * 
+ * @param queue     the blocking queue.
+ * @param item      the return item.
+ * @return          the number of item before dequeue.
+ */
+inline static int dequeue(LinkedBlockingQueue *queue, void *item) {
+    takeNode(queue, item);
     return atomic_fetch_add(&queue->count, -1);
 }
 
@@ -175,7 +222,7 @@ static bool queuePoll(LinkedBlockingQueue *queue, void *item, long timeoutMs) {
     lockReentrantLock(takeLock);
 
     while (atomic_load(&queue->count) == 0) {
-        timeoutMs = awaitCondition(nonEmpty, timeoutMs);
+        timeoutMs = queue->closed ? 0 : awaitCondition(nonEmpty, timeoutMs);
         
         if (timeoutMs == 0) {
             unlockReentrantLock(takeLock);
@@ -198,6 +245,45 @@ static bool queuePoll(LinkedBlockingQueue *queue, void *item, long timeoutMs) {
     return true;
 }
 
+static size_t queueDrain(LinkedBlockingQueue *queue, void *items, size_t maxItems, long timeoutMs) {
+    ReentrantLock *takeLock = queue->takeLock;
+    Condition *nonEmpty = queue->nonEmpty;
+    size_t capacity = queue->capacity;
+    if (maxItems == 0) {
+        return 0;
+    }
+    lockReentrantLock(takeLock);
+
+    size_t count;
+    while ((count = atomic_load(&queue->count)) == 0) {
+        timeoutMs = queue->closed ? 0 : awaitCondition(nonEmpty, timeoutMs);
+
+        if (timeoutMs == 0) {
+            unlockReentrantLock(takeLock);
+            return 0;
+        }
+    }
+
+    // the count only grows meanwhile, one update for the whole batch
+    size_t size = count < maxItems ? count : maxItems;
+    for (size_t i = 0; i < size; ++i) {
+        takeNode(queue, (char *) items + i * queue->itemSize);
+    }
+    size_t before = atomic_fetch_sub(&queue->count, size);
+    if (before > size) {
+        signalCondition(nonEmpty);
+    }
+
+    unlockReentrantLock(takeLock);
+
+    if (before == capacity) {
+        lockReentrantLock(queue->putLock);
+        signalCondition(queue->nonFull);
+        unlockReentrantLock(queue->putLock);
+    }
+    return size;
+}
+
 static bool queueOffer(LinkedBlockingQueue *queue, void *item, long timeoutMs) {
     ReentrantLock* putLock = queue->putLock;
     Condition* nonFull = queue->nonFull;
@@ -205,15 +291,26 @@ static bool queueOffer(LinkedBlockingQueue *queue, void *item, long timeoutMs) {
     lockReentrantLock(putLock);
 
     while (atomic_load(&queue->count) == capacity) {
-        timeoutMs = awaitCondition(nonFull, timeoutMs);
+        timeoutMs = queue->closed ? 0 : awaitCondition(nonFull, timeoutMs);
         
         if (timeoutMs == 0) {
             unlockReentrantLock(putLock);
             return false;
         }
     }
-    
-    int before = enqueue(queue, item);
+
+    if (queue->closed) {
+        unlockReentrantLock(putLock);
+        return false;
+    }
+
+    // the pool may fail to allocate, the offer fails then
+    LinkedNode *node = newNode(queue, item);
+    if (node == NULL) {
+        unlockReentrantLock(putLock);
+        return false;
+    }
+    int before = enqueue(queue, node);
     if (before + 1 < capacity) {
         signalCondition(nonFull);
     }
@@ -228,3 +325,44 @@ static bool queueOffer(LinkedBlockingQueue *queue, void *item, long timeoutMs) {
     return true;
 }
 
+static void queueProfile(LinkedBlockingQueue *queue, const char *name) {
+    char buffer[LOCK_PROFILE_NAME_MAX];
+    snprintf(buffer, sizeof(buffer), "%s.putLock", name);
+    profileReentrantLock(queue->putLock, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.takeLock", name);
+    profileReentrantLock(queue->takeLock, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonEmpty", name);
+    profileCondition(queue->nonEmpty, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonFull", name);
+    profileCondition(queue->nonFull, buffer);
+}
+
+static bool queueRegisterWaiter(LinkedBlockingQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->takeLock);
+    bool registered = registerConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->takeLock);
+    return registered;
+}
+
+static void queueUnregisterWaiter(LinkedBlockingQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->takeLock);
+    unregisterConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->takeLock);
+}
+
+static void queueClose(LinkedBlockingQueue *queue) {
+    lockReentrantLock(queue->putLock);
+    lockReentrantLock(queue->takeLock);
+    queue->closed = true;
+    signalAllCondition(queue->nonEmpty);
+    unlockReentrantLock(queue->takeLock);
+    signalAllCondition(queue->nonFull);
+    unlockReentrantLock(queue->putLock);
+}
+
+static bool queueIsClosed(LinkedBlockingQueue *queue) {
+    lockReentrantLock(queue->takeLock);
+    bool closed = queue->closed;
+    unlockReentrantLock(queue->takeLock);
+    return closed;
+}
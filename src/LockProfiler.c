@@ -0,0 +1,180 @@
+#include "LockProfilerInternal.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ZUTIL_CONCURRENT_PROFILING
+
+/**
+ * A registered profile. Records are never freed, so a profile outlives the object it describes.
+ */
+struct LockProfileRecord {
+    LockProfile profile;
+    struct LockProfileRecord *next;
+};
+
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct LockProfileRecord *registryHead = NULL;
+static size_t registrySize = 0;
+
+LockProfile *registerLockProfile(LockProfile *profile, const char *name, enum LockProfileKind kind) {
+    pthread_mutex_lock(&registryMutex);
+    if (profile == NULL) {
+        struct LockProfileRecord *record = calloc(1, sizeof(struct LockProfileRecord));
+        if (record == NULL) {
+            pthread_mutex_unlock(&registryMutex);
+            return NULL;
+        }
+        record->next = registryHead;
+        registryHead = record;
+        registrySize += 1;
+        profile = &record->profile;
+    }
+    strncpy(profile->name, name, LOCK_PROFILE_NAME_MAX - 1);
+    profile->name[LOCK_PROFILE_NAME_MAX - 1] = '\0';
+    profile->kind = kind;
+    pthread_mutex_unlock(&registryMutex);
+    return profile;
+}
+
+inline static unsigned long long profileKey(const LockProfile *profile, enum LockProfileOrder order) {
+    switch (order) {
+        case LOCK_PROFILE_ORDER_CONTENTIONS:
+            return profile->contentions;
+        case LOCK_PROFILE_ORDER_HOLD_TIME:
+            return profile->holdTimeNs;
+        case LOCK_PROFILE_ORDER_PARKED_TIME:
+            return profile->parkedTimeNs;
+        case LOCK_PROFILE_ORDER_WAIT_TIME:
+        default:
+            return profile->waitTimeNs;
+    }
+}
+
+static enum LockProfileOrder sortOrder;
+
+static int compareProfile(const void *a, const void *b) {
+    unsigned long long x = profileKey(a, sortOrder);
+    unsigned long long y = profileKey(b, sortOrder);
+    return x < y ? 1 : (x > y ? -1 : strcmp(((const LockProfile *) a)->name, ((const LockProfile *) b)->name));
+}
+
+/**
+ * The counters which are updated by the lock holders, see LockProfilerInternal.h.
+ */
+#define LOCK_PROFILE_COUNTERS(profile) \
+    &(profile)->acquisitions, &(profile)->contentions, &(profile)->waitTimeNs, &(profile)->maxWaitTimeNs, \
+    &(profile)->holdTimeNs, &(profile)->maxHoldTimeNs, &(profile)->awaits, &(profile)->parkedTimeNs, \
+    &(profile)->maxParkedTimeNs
+
+/**
+ * Copy a profile which may be updated meanwhile, each counter is consistent but not the profile as a whole.
+ */
+inline static void copyLockProfile(LockProfile *to, LockProfile *from) {
+    memcpy(to->name, from->name, LOCK_PROFILE_NAME_MAX);
+    to->kind = from->kind;
+
+    unsigned long long *source[] = {LOCK_PROFILE_COUNTERS(from)};
+    unsigned long long *target[] = {LOCK_PROFILE_COUNTERS(to)};
+    for (size_t i = 0; i < sizeof(source) / sizeof(source[0]); ++i) {
+        *target[i] = atomic_load_explicit(source[i], memory_order_relaxed);
+    }
+}
+
+/**
+ * Copy all the profiles into a sorted array.
+ *
+ * @param size  the number of profiles.
+ * @return      the array (may be NULL if there is no profile or failed).
+ */
+static LockProfile *sortedProfiles(size_t *size, enum LockProfileOrder order) {
+    pthread_mutex_lock(&registryMutex);
+    *size = registrySize;
+    LockProfile *profiles = *size == 0 ? NULL : malloc(sizeof(LockProfile) * *size);
+    if (profiles == NULL) {
+        pthread_mutex_unlock(&registryMutex);
+        return NULL;
+    }
+
+    size_t i = 0;
+    for (struct LockProfileRecord *record = registryHead; record != NULL; record = record->next) {
+        copyLockProfile(&profiles[i++], &record->profile);
+    }
+    sortOrder = order;
+    qsort(profiles, *size, sizeof(LockProfile), compareProfile);
+    pthread_mutex_unlock(&registryMutex);
+    return profiles;
+}
+
+bool isLockProfilingEnabled() {
+    return true;
+}
+
+size_t snapshotLockProfiles(LockProfile *profiles, size_t maxProfiles, enum LockProfileOrder order) {
+    size_t size;
+    LockProfile *sorted = sortedProfiles(&size, order);
+    if (sorted == NULL) {
+        return 0;
+    }
+    memcpy(profiles, sorted, sizeof(LockProfile) * (size < maxProfiles ? size : maxProfiles));
+    free(sorted);
+    return size;
+}
+
+void dumpLockProfiles(FILE *out, enum LockProfileOrder order) {
+    size_t size;
+    LockProfile *profiles = sortedProfiles(&size, order);
+
+    fprintf(out, "%-32s %12s %12s %12s %12s %12s %12s %12s %12s\n",
+            "name", "acquire", "contend", "wait(us)", "maxWait(us)", "hold(us)", "maxHold(us)",
+            "await", "parked(us)");
+    for (size_t i = 0; i < size; ++i) {
+        LockProfile *p = &profiles[i];
+        if (p->kind == LOCK_PROFILE_LOCK) {
+            fprintf(out, "%-32s %12llu %12llu %12.1f %12.1f %12.1f %12.1f %12s %12s\n",
+                    p->name, p->acquisitions, p->contentions,
+                    (double) p->waitTimeNs / 1000.0, (double) p->maxWaitTimeNs / 1000.0,
+                    (double) p->holdTimeNs / 1000.0, (double) p->maxHoldTimeNs / 1000.0, "-", "-");
+        } else {
+            fprintf(out, "%-32s %12s %12s %12s %12s %12s %12s %12llu %12.1f\n",
+                    p->name, "-", "-", "-", "-", "-", "-", p->awaits, (double) p->parkedTimeNs / 1000.0);
+        }
+    }
+    free(profiles);
+}
+
+void resetLockProfiles() {
+    pthread_mutex_lock(&registryMutex);
+    for (struct LockProfileRecord *record = registryHead; record != NULL; record = record->next) {
+        unsigned long long *counters[] = {LOCK_PROFILE_COUNTERS(&record->profile)};
+        for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); ++i) {
+            atomic_store_explicit(counters[i], 0, memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&registryMutex);
+}
+
+#else
+
+bool isLockProfilingEnabled() {
+    return false;
+}
+
+size_t snapshotLockProfiles(LockProfile *profiles, size_t maxProfiles, enum LockProfileOrder order) {
+    return 0;
+}
+
+void dumpLockProfiles(FILE *out, enum LockProfileOrder order) {
+    fprintf(out, "lock profiling is disabled (build with ZUTIL_CONCURRENT_PROFILING)\n");
+}
+
+void resetLockProfiles() {
+}
+
+#endif
+
+void profileBlockingQueue(BlockingQueue *queue, const char *name) {
+    queue->profile(queue, name);
+}
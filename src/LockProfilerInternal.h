@@ -0,0 +1,87 @@
+#ifndef ZUTIL_CONCURRENT_LOCKPROFILERINTERNAL_H
+#define ZUTIL_CONCURRENT_LOCKPROFILERINTERNAL_H
+
+#include "LockProfiler.h"
+
+#ifdef ZUTIL_CONCURRENT_PROFILING
+
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * Hooks shared by ReentrantLock.c and Condition.c. The statistics of a profile are only updated by the thread
+ * holding the profiled lock, but they are read by snapshots and cleared by resets from any thread, so every
+ * counter is a relaxed atomic.
+ */
+
+/**
+ * Get the monotonic time in nanoseconds.
+ */
+inline static unsigned long long profileNow() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long) t.tv_sec * 1000000000ull + (unsigned long long) t.tv_nsec;
+}
+
+/**
+ * Register a profile or rename an existing one.
+ *
+ * @param profile   the existing profile (may be NULL).
+ * @param name      the name of the profiled object.
+ * @param kind      the kind of the profiled object.
+ * @return          the profile (may be NULL if failed).
+ */
+LockProfile *registerLockProfile(LockProfile *profile, const char *name, enum LockProfileKind kind);
+
+/**
+ * Suspend the hold time accounting before the lock is released by awaitCondition.
+ *
+ * @param lock  the reentrant lock.
+ * @return      the hold count to pass to resumeProfileReentrantLock.
+ */
+int suspendProfileReentrantLock(ReentrantLock *lock);
+
+/**
+ * Resume the hold time accounting after the lock is acquired again by awaitCondition.
+ *
+ * @param lock  the reentrant lock.
+ * @param holds the value returned by suspendProfileReentrantLock.
+ */
+void resumeProfileReentrantLock(ReentrantLock *lock, int holds);
+
+inline static void addProfileCounter(unsigned long long *counter, unsigned long long value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+/**
+ * Raise the maximum, only the lock holder raises it, so a load and a store are enough.
+ */
+inline static void maxProfileCounter(unsigned long long *counter, unsigned long long value) {
+    if (value > atomic_load_explicit(counter, memory_order_relaxed)) {
+        atomic_store_explicit(counter, value, memory_order_relaxed);
+    }
+}
+
+inline static void recordLockAcquire(LockProfile *profile, bool contended, unsigned long long waitNs) {
+    addProfileCounter(&profile->acquisitions, 1);
+    if (contended) {
+        addProfileCounter(&profile->contentions, 1);
+        addProfileCounter(&profile->waitTimeNs, waitNs);
+        maxProfileCounter(&profile->maxWaitTimeNs, waitNs);
+    }
+}
+
+inline static void recordLockRelease(LockProfile *profile, unsigned long long holdNs) {
+    addProfileCounter(&profile->holdTimeNs, holdNs);
+    maxProfileCounter(&profile->maxHoldTimeNs, holdNs);
+}
+
+inline static void recordConditionAwait(LockProfile *profile, unsigned long long parkedNs) {
+    addProfileCounter(&profile->awaits, 1);
+    addProfileCounter(&profile->parkedTimeNs, parkedNs);
+    maxProfileCounter(&profile->maxParkedTimeNs, parkedNs);
+}
+
+#endif
+
+#endif //ZUTIL_CONCURRENT_LOCKPROFILERINTERNAL_H
@@ -0,0 +1,377 @@
+#include "ObjectPool.h"
+#include "ThreadLocal.h"
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * The number of blocks in a magazine.
+ */
+#define MAGAZINE_SIZE 64
+
+/**
+ * Magazines are allocated in chunks and addressed by index, so the depot can tag its head against ABA in 64 bits.
+ * Chunk i holds FIRST_MAGAZINE_CHUNK_SIZE << i magazines, so a small pool stays small and the indexes still fit in
+ * 32 bits.
+ */
+#define FIRST_MAGAZINE_CHUNK_SIZE 8
+#define MAX_MAGAZINE_CHUNKS 28
+
+/**
+ * The full magazines kept by the depot, the blocks of any more are given back to the system.
+ */
+#define MAX_FULL_MAGAZINES 16
+
+#define CACHE_FLUSHING (-1)
+
+typedef struct Magazine {
+    /* index + 1 of the next magazine in the depot stack */
+    uint32_t next;
+    uint32_t index;
+    size_t size;
+    void *blocks[MAGAZINE_SIZE];
+} Magazine;
+
+/**
+ * The magazines cached by a thread. A cache is owned by the pool and by its thread (refs), CACHE_FLUSHING while
+ * the exiting thread moves its magazines to the depot, during which the pool cannot be freed.
+ */
+typedef struct ThreadCache {
+    struct ThreadCache *next;
+    ObjectPool *pool;
+    int refs;
+
+    Magazine *loaded;
+    Magazine *previous;
+} ThreadCache;
+
+/**
+ * A lock-free stack of magazines. The head is (tag << 32) | (index + 1).
+ */
+typedef struct MagazineStack {
+    _Alignas(64) uint64_t head;
+} MagazineStack;
+
+struct ObjectPool {
+    size_t blockSize;
+    ThreadLocal cache;
+
+    MagazineStack full;
+    MagazineStack empty;
+    /* the magazines in full, may be off by the pushes and pops in flight */
+    size_t fullSize;
+
+    /* slow path state, protected by mutex */
+    pthread_mutex_t mutex;
+    ThreadCache *caches;
+    size_t magazineSize;
+    Magazine *chunks[MAX_MAGAZINE_CHUNKS];
+};
+
+/* private member functions */
+static void *newThreadCache(void *arg);
+static void releaseThreadCache(void *arg);
+inline static Magazine *getMagazine(ObjectPool *pool, uint32_t index);
+inline static void releaseMagazine(Magazine *magazine);
+
+ObjectPool *newObjectPool(size_t blockSize) {
+    ObjectPool *pool = calloc(1, sizeof(ObjectPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    // keep the blocks pointer aligned
+    size_t align = sizeof(void *) * 2;
+    pool->blockSize = blockSize < align ? align : (blockSize + align - 1) / align * align;
+    atomic_init(&pool->full.head, 0);
+    atomic_init(&pool->empty.head, 0);
+    atomic_init(&pool->fullSize, 0);
+    initThreadLocal(&pool->cache);
+
+    if (pthread_mutex_init(&pool->mutex, NULL)) {
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void freeObjectPool(ObjectPool *pool) {
+    destroyThreadLocal(&pool->cache);
+
+    ThreadCache *cache = pool->caches;
+    while (cache != NULL) {
+        ThreadCache *next = cache->next;
+        // wait for an exiting thread which is flushing into the depot
+        int refs = atomic_load(&cache->refs);
+        while (refs == CACHE_FLUSHING || !atomic_compare_exchange_weak(&cache->refs, &refs, refs - 1)) {
+            if (refs == CACHE_FLUSHING) {
+                sched_yield();
+                refs = atomic_load(&cache->refs);
+            }
+        }
+        if (refs == 1) {
+            free(cache);
+        }
+        cache = next;
+    }
+
+    for (size_t i = 0; i < pool->magazineSize; ++i) {
+        releaseMagazine(getMagazine(pool, (uint32_t) i));
+    }
+    for (size_t i = 0; i < MAX_MAGAZINE_CHUNKS && pool->chunks[i] != NULL; ++i) {
+        free(pool->chunks[i]);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+/**
+ * @return the chunk of the magazine index.
+ */
+inline static size_t getMagazineChunk(size_t index) {
+    return 63 - __builtin_clzll(index / FIRST_MAGAZINE_CHUNK_SIZE + 1);
+}
+
+inline static Magazine *getMagazine(ObjectPool *pool, uint32_t index) {
+    size_t chunk = getMagazineChunk(index);
+    return &pool->chunks[chunk][index - FIRST_MAGAZINE_CHUNK_SIZE * ((1 << chunk) - 1)];
+}
+
+/**
+ * Give the blocks of the magazine back to the system.
+ */
+inline static void releaseMagazine(Magazine *magazine) {
+    for (size_t i = 0; i < magazine->size; ++i) {
+        free(magazine->blocks[i]);
+    }
+    magazine->size = 0;
+}
+
+inline static void pushMagazine(MagazineStack *stack, Magazine *magazine) {
+    uint64_t head = atomic_load(&stack->head);
+    uint64_t next;
+    do {
+        atomic_store_explicit(&magazine->next, (uint32_t) head, memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | (magazine->index + 1);
+    } while (!atomic_compare_exchange_weak(&stack->head, &head, next));
+}
+
+inline static Magazine *popMagazine(ObjectPool *pool, MagazineStack *stack) {
+    uint64_t head = atomic_load(&stack->head);
+    uint64_t next;
+    Magazine *magazine;
+    do {
+        uint32_t index = (uint32_t) head;
+        if (index == 0) {
+            return NULL;
+        }
+        // the magazine may be popped and pushed again meanwhile, which is detected by the tag
+        magazine = getMagazine(pool, index - 1);
+        next = ((head >> 32) + 1) << 32 | atomic_load_explicit(&magazine->next, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak(&stack->head, &head, next));
+    return magazine;
+}
+
+/**
+ * Get an empty magazine from the depot, or allocate one.
+ *
+ * @return the magazine (may be NULL if failed).
+ */
+static Magazine *newMagazine(ObjectPool *pool) {
+    Magazine *magazine = popMagazine(pool, &pool->empty);
+    if (magazine != NULL) {
+        return magazine;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    size_t index = pool->magazineSize;
+    size_t chunk = getMagazineChunk(index);
+    if (chunk >= MAX_MAGAZINE_CHUNKS) {
+        pthread_mutex_unlock(&pool->mutex);
+        return NULL;
+    }
+    if (pool->chunks[chunk] == NULL) {
+        pool->chunks[chunk] = calloc(FIRST_MAGAZINE_CHUNK_SIZE << chunk, sizeof(Magazine));
+        if (pool->chunks[chunk] == NULL) {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+    }
+    pool->magazineSize += 1;
+    pthread_mutex_unlock(&pool->mutex);
+
+    magazine = getMagazine(pool, index);
+    magazine->index = (uint32_t) index;
+    magazine->size = 0;
+    return magazine;
+}
+
+/**
+ * Fill an empty magazine with new blocks from the system, as many as can be allocated.
+ *
+ * @return return false if failed.
+ */
+static bool fillMagazine(ObjectPool *pool, Magazine *magazine) {
+    while (magazine->size < MAGAZINE_SIZE) {
+        void *block = malloc(pool->blockSize);
+        if (block == NULL) {
+            break;
+        }
+        magazine->blocks[magazine->size++] = block;
+    }
+    return magazine->size > 0;
+}
+
+/**
+ * Push a full magazine to the depot, or give its blocks back to the system and push it as empty if the depot has
+ * enough, so a pool does not keep the blocks of its peak usage.
+ */
+inline static void pushFullMagazine(ObjectPool *pool, Magazine *magazine) {
+    if (atomic_load_explicit(&pool->fullSize, memory_order_relaxed) >= MAX_FULL_MAGAZINES) {
+        releaseMagazine(magazine);
+        pushMagazine(&pool->empty, magazine);
+        return;
+    }
+    atomic_fetch_add_explicit(&pool->fullSize, 1, memory_order_relaxed);
+    pushMagazine(&pool->full, magazine);
+}
+
+inline static Magazine *popFullMagazine(ObjectPool *pool) {
+    Magazine *magazine = popMagazine(pool, &pool->full);
+    if (magazine != NULL) {
+        atomic_fetch_sub_explicit(&pool->fullSize, 1, memory_order_relaxed);
+    }
+    return magazine;
+}
+
+static void *newThreadCache(void *arg) {
+    ObjectPool *pool = arg;
+    ThreadCache *cache = calloc(1, sizeof(ThreadCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    cache->pool = pool;
+    cache->loaded = newMagazine(pool);
+    cache->previous = newMagazine(pool);
+    if (cache->loaded == NULL || cache->previous == NULL) {
+        if (cache->loaded) {
+            pushMagazine(&pool->empty, cache->loaded);
+        }
+        if (cache->previous) {
+            pushMagazine(&pool->empty, cache->previous);
+        }
+        free(cache);
+        return NULL;
+    }
+    atomic_init(&cache->refs, 2);
+
+    pthread_mutex_lock(&pool->mutex);
+    cache->next = pool->caches;
+    pool->caches = cache;
+    pthread_mutex_unlock(&pool->mutex);
+    return cache;
+}
+
+/**
+ * Flush the magazines of an exiting thread into the depot. If the pool is freed already, the magazines are freed
+ * with the pool, so only the cache is released. Taking the cache from 2 refs to CACHE_FLUSHING is what allows the
+ * flush, the pool waits for it to end before it is freed.
+ *
+ * @param arg the thread cache.
+ */
+static void releaseThreadCache(void *arg) {
+    ThreadCache *cache = arg;
+    int refs = 2;
+    if (atomic_compare_exchange_strong(&cache->refs, &refs, CACHE_FLUSHING)) {
+        ObjectPool *pool = cache->pool;
+        Magazine *magazines[2] = {cache->loaded, cache->previous};
+        for (int i = 0; i < 2; ++i) {
+            if (magazines[i]->size > 0) {
+                pushFullMagazine(pool, magazines[i]);
+            } else {
+                pushMagazine(&pool->empty, magazines[i]);
+            }
+        }
+        // the cache stays in the list of the pool, which frees it
+        atomic_store(&cache->refs, 1);
+        return;
+    }
+    if (atomic_fetch_sub(&cache->refs, 1) == 1) {
+        free(cache);
+    }
+}
+
+inline static ThreadCache *getThreadCache(ObjectPool *pool) {
+    ThreadCache *cache = getThreadLocal(&pool->cache);
+    if (cache == NULL) {
+        cache = computeIfAbsentThreadLocal(&pool->cache, newThreadCache, pool, releaseThreadCache);
+    }
+    return cache;
+}
+
+inline static void swapMagazines(ThreadCache *cache) {
+    Magazine *magazine = cache->loaded;
+    cache->loaded = cache->previous;
+    cache->previous = magazine;
+}
+
+void *allocateObjectPool(ObjectPool *pool) {
+    ThreadCache *cache = getThreadCache(pool);
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    Magazine *loaded = cache->loaded;
+    if (loaded->size > 0) {
+        return loaded->blocks[--loaded->size];
+    }
+
+    if (cache->previous->size > 0) {
+        swapMagazines(cache);
+    } else {
+        Magazine *full = popFullMagazine(pool);
+        if (full != NULL) {
+            pushMagazine(&pool->empty, cache->previous);
+            cache->previous = cache->loaded;
+            cache->loaded = full;
+        } else if (!fillMagazine(pool, cache->loaded)) {
+            return NULL;
+        }
+    }
+
+    loaded = cache->loaded;
+    return loaded->blocks[--loaded->size];
+}
+
+void deallocateObjectPool(ObjectPool *pool, void *block) {
+    ThreadCache *cache = getThreadCache(pool);
+    if (cache == NULL) {
+        free(block);
+        return;
+    }
+
+    Magazine *loaded = cache->loaded;
+    if (loaded->size < MAGAZINE_SIZE) {
+        loaded->blocks[loaded->size++] = block;
+        return;
+    }
+
+    if (cache->previous->size == 0) {
+        swapMagazines(cache);
+    } else {
+        Magazine *empty = newMagazine(pool);
+        if (empty == NULL) {
+            free(block);
+            return;
+        }
+        pushFullMagazine(pool, cache->previous);
+        cache->previous = cache->loaded;
+        cache->loaded = empty;
+    }
+
+    loaded = cache->loaded;
+    loaded->blocks[loaded->size++] = block;
+}
@@ -0,0 +1,402 @@
+#include "Pipeline.h"
+#include "ArrayBlockingQueue.h"
+#include "StripedCounter.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define THREAD_NAME_MAX_LENGTH 64
+
+/**
+ * The time an idle thread waits for items before it checks whether it was moved to another stage (milliseconds).
+ */
+#define PIPELINE_IDLE_MS 100
+
+// forward declaration
+struct Pipeline;
+
+typedef struct PipelineStage {
+    struct Pipeline *pipeline;
+    struct PipelineStage *next;
+    char name[THREAD_NAME_MAX_LENGTH];
+    PipelineProcess process;
+    void *arg;
+    size_t batchSize;
+    BlockingQueue *queue;
+
+    /* the items offered to the queue and taken from it, their difference is the depth */
+    StripedCounter *offered;
+    StripedCounter *taken;
+    StripedCounter *processed;
+
+    /* the live threads, written under the mutex. More than the target makes a thread leave */
+    size_t threads;
+    size_t targetThreads;
+    size_t threadCount;
+
+    /* the processed items at the previous getPipelineStats, under the mutex */
+    long long lastProcessed;
+
+    /* the depth averaged over the rebalancings, so that a queue drained a moment ago does not lose its threads */
+    long long averageDepth;
+} PipelineStage;
+
+struct Pipeline {
+    pthread_mutex_t mutex;
+    /* signaled when a thread exits, and to stop the rebalancer */
+    pthread_cond_t changed;
+    size_t liveThreads;
+    bool shutdown;
+
+    pthread_t rebalancer;
+    bool rebalancerStarted;
+    long rebalanceMs;
+
+    struct timespec lastStats;
+
+    size_t stageSize;
+    PipelineStage stages[];
+};
+
+static void *stageThread(void *arg);
+
+/**
+ * The items in the queue of the stage, or a few more while items move: taken is read before offered.
+ */
+inline static long long depthStage(PipelineStage *stage) {
+    long long taken = sumStripedCounter(stage->taken);
+    long long depth = sumStripedCounter(stage->offered) - taken;
+    return depth < 0 ? 0 : depth;
+}
+
+/**
+ * Start a thread in the stage. The mutex must be held.
+ *
+ * @return return false if failed.
+ */
+static bool startStageThread(PipelineStage *stage) {
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr) != 0) {
+        return false;
+    }
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    // counted before it runs, so that it never sees more threads than the target but itself
+    atomic_store(&stage->threads, stage->threads + 1);
+    stage->pipeline->liveThreads += 1;
+    pthread_t thread;
+    bool started = pthread_create(&thread, &attr, stageThread, stage) == 0;
+    pthread_attr_destroy(&attr);
+
+    if (!started) {
+        atomic_store(&stage->threads, stage->threads - 1);
+        stage->pipeline->liveThreads -= 1;
+    }
+    return started;
+}
+
+/**
+ * Uncount a thread of the stage. The mutex must be held. The rebalancing never takes the last thread of a stage, so
+ * the last one exits at shutdown, and closes the next queue once its items are all offered to it.
+ */
+static void exitStageThread(PipelineStage *stage) {
+    Pipeline *pipeline = stage->pipeline;
+    atomic_store(&stage->threads, stage->threads - 1);
+    if (stage->threads == 0 && stage->next != NULL) {
+        stage->next->queue->close(stage->next->queue);
+    }
+    pipeline->liveThreads -= 1;
+    pthread_cond_broadcast(&pipeline->changed);
+}
+
+/**
+ * Leave the stage if the rebalancing moved a thread away from it.
+ *
+ * @return return true if the thread left.
+ */
+static bool leaveStage(PipelineStage *stage) {
+    if (atomic_load(&stage->threads) <= atomic_load(&stage->targetThreads)) {
+        return false;
+    }
+
+    Pipeline *pipeline = stage->pipeline;
+    pthread_mutex_lock(&pipeline->mutex);
+    bool leave = stage->threads > stage->targetThreads;
+    if (leave) {
+        exitStageThread(stage);
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+    return leave;
+}
+
+static void *stageThread(void *arg) {
+    PipelineStage *stage = arg;
+    BlockingQueue *queue = stage->queue;
+    PipelineStage *next = stage->next;
+
+#ifdef _GNU_SOURCE
+    char name[THREAD_NAME_MAX_LENGTH];
+    pthread_mutex_lock(&stage->pipeline->mutex);
+    snprintf(name, sizeof(name), "%s-%zu", stage->name, stage->threadCount++);
+    pthread_mutex_unlock(&stage->pipeline->mutex);
+    // the kernel keeps 15 characters of a thread name
+    name[15] = '\0';
+    pthread_setname_np(pthread_self(), name);
+#endif
+
+    void **items = malloc(sizeof(void *) * stage->batchSize);
+    bool left = false;
+    while (items != NULL && !(left = leaveStage(stage))) {
+        // checked before the drain, so that no item is offered after
+        bool closed = queue->isClosed(queue);
+        size_t size = drainBlockingQueue(queue, items, sizeof(void *), stage->batchSize, PIPELINE_IDLE_MS);
+        if (size == 0) {
+            if (closed) {
+                break;
+            }
+            continue;
+        }
+        addStripedCounter(stage->taken, (long long) size);
+
+        for (size_t i = 0; i < size; ++i) {
+            void *result = stage->process(items[i], stage->arg);
+            // the next queue is closed only after the last thread of this stage exits
+            if (next != NULL && result != NULL && next->queue->offer(next->queue, &result, -1)) {
+                addStripedCounter(next->offered, 1);
+            }
+        }
+        addStripedCounter(stage->processed, (long long) size);
+    }
+
+    if (!left) {
+        pthread_mutex_lock(&stage->pipeline->mutex);
+        exitStageThread(stage);
+        pthread_mutex_unlock(&stage->pipeline->mutex);
+    }
+    free(items);
+    return NULL;
+}
+
+/**
+ * Rebalance every rebalanceMs until shutdown.
+ */
+static void *rebalancerThread(void *arg) {
+    Pipeline *pipeline = arg;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    pthread_mutex_lock(&pipeline->mutex);
+    while (!pipeline->shutdown) {
+        deadline.tv_sec += pipeline->rebalanceMs / 1000;
+        deadline.tv_nsec += pipeline->rebalanceMs % 1000 * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while (!pipeline->shutdown && pthread_cond_timedwait(&pipeline->changed, &pipeline->mutex, &deadline) == 0);
+        if (!pipeline->shutdown) {
+            pthread_mutex_unlock(&pipeline->mutex);
+            rebalancePipeline(pipeline);
+            pthread_mutex_lock(&pipeline->mutex);
+        }
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+    return NULL;
+}
+
+Pipeline *newPipeline(const PipelineStageConfig *stages, size_t stageSize, long rebalanceMs) {
+    if (stageSize == 0) {
+        return NULL;
+    }
+    for (size_t i = 0; i < stageSize; ++i) {
+        if (stages[i].parallelism == 0 || stages[i].batchSize == 0 || stages[i].process == NULL) {
+            return NULL;
+        }
+    }
+
+    Pipeline *pipeline = calloc(1, sizeof(Pipeline) + sizeof(PipelineStage) * stageSize);
+    if (pipeline == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&pipeline->mutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pipeline->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    clock_gettime(CLOCK_MONOTONIC, &pipeline->lastStats);
+    pipeline->rebalanceMs = rebalanceMs;
+
+    // the queues first, so that a thread never sees the next stage half built
+    for (size_t i = 0; i < stageSize; ++i) {
+        PipelineStage *stage = &pipeline->stages[i];
+        const PipelineStageConfig *config = &stages[i];
+        BlockingQueue *(*builder)(size_t, size_t) = config->builder != NULL ? config->builder : newArrayBlockingQueue;
+
+        stage->pipeline = pipeline;
+        stage->next = i + 1 < stageSize ? &pipeline->stages[i + 1] : NULL;
+        snprintf(stage->name, sizeof(stage->name), "%s", config->name != NULL ? config->name : "stage");
+        stage->process = config->process;
+        stage->arg = config->arg;
+        stage->batchSize = config->batchSize;
+        atomic_init(&stage->targetThreads, config->parallelism);
+        atomic_init(&stage->threads, 0);
+        stage->queue = builder(config->capacity, sizeof(void *));
+        stage->offered = newStripedCounter();
+        stage->taken = newStripedCounter();
+        stage->processed = newStripedCounter();
+        pipeline->stageSize += 1;
+        if (stage->queue == NULL || stage->offered == NULL || stage->taken == NULL || stage->processed == NULL) {
+            freePipeline(pipeline);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_lock(&pipeline->mutex);
+    bool started = true;
+    for (size_t i = 0; i < stageSize && started; ++i) {
+        for (size_t j = 0; j < stages[i].parallelism && started; ++j) {
+            started = startStageThread(&pipeline->stages[i]);
+        }
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    if (started && rebalanceMs > 0) {
+        started = pthread_create(&pipeline->rebalancer, NULL, rebalancerThread, pipeline) == 0;
+        pipeline->rebalancerStarted = started;
+    }
+    if (!started) {
+        freePipeline(pipeline);
+        return NULL;
+    }
+    return pipeline;
+}
+
+void freePipeline(Pipeline *pipeline) {
+    shutdownPipeline(pipeline);
+    for (size_t i = 0; i < pipeline->stageSize; ++i) {
+        PipelineStage *stage = &pipeline->stages[i];
+        if (stage->queue) {
+            stage->queue->free(stage->queue);
+        }
+        if (stage->offered) {
+            freeStripedCounter(stage->offered);
+        }
+        if (stage->taken) {
+            freeStripedCounter(stage->taken);
+        }
+        if (stage->processed) {
+            freeStripedCounter(stage->processed);
+        }
+    }
+    pthread_cond_destroy(&pipeline->changed);
+    pthread_mutex_destroy(&pipeline->mutex);
+    free(pipeline);
+}
+
+bool submitPipeline(Pipeline *pipeline, void *item, long timeoutMs) {
+    PipelineStage *first = &pipeline->stages[0];
+    if (!first->queue->offer(first->queue, &item, timeoutMs)) {
+        return false;
+    }
+    addStripedCounter(first->offered, 1);
+    return true;
+}
+
+void shutdownPipeline(Pipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->mutex);
+    if (pipeline->shutdown) {
+        pthread_mutex_unlock(&pipeline->mutex);
+        return;
+    }
+    pipeline->shutdown = true;
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    // no thread moves from now on, every stage keeps a thread until its queue is closed and drained
+    if (pipeline->rebalancerStarted) {
+        pthread_join(pipeline->rebalancer, NULL);
+    }
+
+    // the stages close one another in order, as they drain
+    PipelineStage *first = &pipeline->stages[0];
+    if (first->queue != NULL) {
+        first->queue->close(first->queue);
+    }
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->liveThreads > 0) {
+        pthread_cond_wait(&pipeline->changed, &pipeline->mutex);
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+void getPipelineStats(Pipeline *pipeline, PipelineStageStats *stats) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&pipeline->mutex);
+    double elapsed = (double) (now.tv_sec - pipeline->lastStats.tv_sec)
+                     + (double) (now.tv_nsec - pipeline->lastStats.tv_nsec) / 1e9;
+    pipeline->lastStats = now;
+    for (size_t i = 0; i < pipeline->stageSize; ++i) {
+        PipelineStage *stage = &pipeline->stages[i];
+        long long processed = sumStripedCounter(stage->processed);
+        stats[i].name = stage->name;
+        stats[i].threads = stage->threads;
+        stats[i].depth = depthStage(stage);
+        stats[i].processed = processed;
+        stats[i].throughput = elapsed > 0 ? (double) (processed - stage->lastProcessed) / elapsed : 0;
+        stage->lastProcessed = processed;
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+bool rebalancePipeline(Pipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->mutex);
+    if (pipeline->shutdown || pipeline->stageSize < 2) {
+        pthread_mutex_unlock(&pipeline->mutex);
+        return false;
+    }
+
+    for (size_t i = 0; i < pipeline->stageSize; ++i) {
+        PipelineStage *stage = &pipeline->stages[i];
+        stage->averageDepth = (stage->averageDepth * 3 + depthStage(stage)) / 4;
+    }
+
+    PipelineStage *bottleneck = NULL;
+    long long bottleneckDepth = 0;
+    // a full queue blocks the stages before it, so their queues fill up too: the later stage wins a tie, i.e. a
+    // difference of less than a batch
+    for (size_t i = 0; i < pipeline->stageSize; ++i) {
+        PipelineStage *stage = &pipeline->stages[i];
+        long long depth = stage->averageDepth;
+        if (bottleneck == NULL || depth + (long long) stage->batchSize > bottleneckDepth) {
+            bottleneck = stage;
+            bottleneckDepth = depth;
+        }
+    }
+
+    PipelineStage *donor = NULL;
+    long long donorDepth = 0;
+    for (size_t i = 0; i < pipeline->stageSize; ++i) {
+        PipelineStage *stage = &pipeline->stages[i];
+        long long depth = stage->averageDepth;
+        if (stage != bottleneck && stage->targetThreads > 1 && (donor == NULL || depth < donorDepth)) {
+            donor = stage;
+            donorDepth = depth;
+        }
+    }
+
+    bool moved = donor != NULL && bottleneckDepth > (long long) bottleneck->batchSize
+                 && bottleneckDepth > donorDepth * 2 && startStageThread(bottleneck);
+    if (moved) {
+        atomic_store(&donor->targetThreads, donor->targetThreads - 1);
+        atomic_store(&bottleneck->targetThreads, bottleneck->targetThreads + 1);
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+    return moved;
+}
@@ -0,0 +1,176 @@
+#include "PriorityBlockingQueue.h"
+#include "ReentrantLock.h"
+#include "Condition.h"
+#include "LockProfiler.h"
+#include "HeapInternal.h"
+#include <malloc.h>
+#include <string.h>
+
+/**
+ * A priority BlockingQueue implementation.
+ */
+typedef struct PriorityBlockingQueue {
+    BlockingQueue parent;
+
+    ReentrantLock *lock;
+    Condition *nonFull;
+    Condition *nonEmpty;
+
+    Heap heap;
+    bool closed;
+} PriorityBlockingQueue;
+
+/* member functions */
+static void queueFree(PriorityBlockingQueue *queue);
+
+static bool queuePoll(PriorityBlockingQueue *queue, void *item, long timeoutMs);
+
+static bool queueOffer(PriorityBlockingQueue *queue, void *item, long timeoutMs);
+
+static void queueProfile(PriorityBlockingQueue *queue, const char *name);
+
+static bool queueRegisterWaiter(PriorityBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueUnregisterWaiter(PriorityBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueClose(PriorityBlockingQueue *queue);
+
+static bool queueIsClosed(PriorityBlockingQueue *queue);
+
+BlockingQueue *newPriorityBlockingQueue(size_t capacity, size_t itemSize, BlockingQueueComparator comparator) {
+    if (itemSize == 0 || comparator == NULL) {
+        return NULL;
+    }
+
+    PriorityBlockingQueue *queue = calloc(1, sizeof(PriorityBlockingQueue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    // member function binding
+    BlockingQueue parent = {
+            .offer = (bool (*)(struct BlockingQueue *, void *, long)) queueOffer,
+            .free = (void (*)(struct BlockingQueue *)) queueFree,
+            .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll,
+            .profile = (void (*)(struct BlockingQueue *, const char *)) queueProfile,
+            .registerWaiter = (bool (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueRegisterWaiter,
+            .unregisterWaiter = (void (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueUnregisterWaiter,
+            .close = (void (*)(struct BlockingQueue *)) queueClose,
+            .isClosed = (bool (*)(struct BlockingQueue *)) queueIsClosed
+    };
+    memcpy(&queue->parent, &parent, sizeof(BlockingQueue));
+
+    if (!initHeap(&queue->heap, capacity, itemSize, comparator)) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    queue->lock = newReentrantLock();
+    if (queue->lock == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    queue->nonFull = newCondition(queue->lock);
+    queue->nonEmpty = newCondition(queue->lock);
+    if (queue->nonFull == NULL || queue->nonEmpty == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    return &queue->parent;
+}
+
+static void queueFree(PriorityBlockingQueue *queue) {
+    if (queue->nonEmpty) {
+        freeCondition(queue->nonEmpty);
+    }
+    if (queue->nonFull) {
+        freeCondition(queue->nonFull);
+    }
+    if (queue->lock) {
+        freeReentrantLock(queue->lock);
+    }
+    destroyHeap(&queue->heap);
+    free(queue);
+}
+
+static bool queuePoll(PriorityBlockingQueue *queue, void *item, long timeoutMs) {
+    lockReentrantLock(queue->lock);
+
+    while (queue->heap.size == 0) {
+        timeoutMs = queue->closed ? 0 : awaitCondition(queue->nonEmpty, timeoutMs);
+
+        if (timeoutMs == 0) {
+            unlockReentrantLock(queue->lock);
+            return false;
+        }
+    }
+
+    popHeap(&queue->heap, item);
+    signalCondition(queue->nonFull);
+    unlockReentrantLock(queue->lock);
+    return true;
+}
+
+static bool queueOffer(PriorityBlockingQueue *queue, void *item, long timeoutMs) {
+    lockReentrantLock(queue->lock);
+
+    while (queue->heap.size == queue->heap.capacity && !queue->closed) {
+        timeoutMs = awaitCondition(queue->nonFull, timeoutMs);
+
+        if (timeoutMs == 0) {
+            unlockReentrantLock(queue->lock);
+            return false;
+        }
+    }
+
+    // the heap refuses the item if it is full, or the array cannot grow
+    size_t index;
+    if (queue->closed || !pushHeap(&queue->heap, item, &index)) {
+        unlockReentrantLock(queue->lock);
+        return false;
+    }
+
+    signalCondition(queue->nonEmpty);
+    unlockReentrantLock(queue->lock);
+    return true;
+}
+
+static void queueProfile(PriorityBlockingQueue *queue, const char *name) {
+    char buffer[LOCK_PROFILE_NAME_MAX];
+    snprintf(buffer, sizeof(buffer), "%s.lock", name);
+    profileReentrantLock(queue->lock, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonEmpty", name);
+    profileCondition(queue->nonEmpty, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonFull", name);
+    profileCondition(queue->nonFull, buffer);
+}
+
+static bool queueRegisterWaiter(PriorityBlockingQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->lock);
+    bool registered = registerConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->lock);
+    return registered;
+}
+
+static void queueUnregisterWaiter(PriorityBlockingQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->lock);
+    unregisterConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->lock);
+}
+
+static void queueClose(PriorityBlockingQueue *queue) {
+    lockReentrantLock(queue->lock);
+    queue->closed = true;
+    signalAllCondition(queue->nonEmpty);
+    signalAllCondition(queue->nonFull);
+    unlockReentrantLock(queue->lock);
+}
+
+static bool queueIsClosed(PriorityBlockingQueue *queue) {
+    lockReentrantLock(queue->lock);
+    bool closed = queue->closed;
+    unlockReentrantLock(queue->lock);
+    return closed;
+}
@@ -1,4 +1,5 @@
 #include "ReentrantLock.h"
+#include "LockProfilerInternal.h"
 
 #include <malloc.h>
 #include <pthread.h>
@@ -8,6 +9,12 @@
 struct ReentrantLock {
     pthread_mutexattr_t attr;
     pthread_mutex_t mutex;
+
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    LockProfile *profile;
+    unsigned long long acquiredAt;
+    int holds;
+#endif
 };
 
 /**
@@ -54,11 +61,89 @@ void freeReentrantLock(ReentrantLock *lock) {
     free(lock);
 }
 
+#ifdef ZUTIL_CONCURRENT_PROFILING
+
+/**
+ * Record an acquisition of the profiled lock. Must be called by the owner after the lock is acquired.
+ *
+ * @param lock      the reentrant lock.
+ * @param contended whether the thread had to wait for the lock.
+ * @param waitNs    the waiting time (nanoseconds).
+ */
+inline static void acquiredProfileReentrantLock(ReentrantLock *lock, bool contended, unsigned long long waitNs) {
+    recordLockAcquire(lock->profile, contended, waitNs);
+    if (lock->holds++ == 0) {
+        lock->acquiredAt = profileNow();
+    }
+}
+
+static void lockProfileReentrantLock(ReentrantLock *lock) {
+    if (pthread_mutex_trylock(&lock->mutex) == 0) {
+        acquiredProfileReentrantLock(lock, false, 0);
+        return;
+    }
+
+    unsigned long long begin = profileNow();
+    pthread_mutex_lock(&lock->mutex);
+    acquiredProfileReentrantLock(lock, true, profileNow() - begin);
+}
+
+static void unlockProfileReentrantLock(ReentrantLock *lock) {
+    if (--lock->holds == 0) {
+        recordLockRelease(lock->profile, profileNow() - lock->acquiredAt);
+    }
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+int suspendProfileReentrantLock(ReentrantLock *lock) {
+    int holds = lock->holds;
+    if (lock->profile != NULL && holds > 0) {
+        recordLockRelease(lock->profile, profileNow() - lock->acquiredAt);
+    }
+    lock->holds = 0;
+    return holds;
+}
+
+void resumeProfileReentrantLock(ReentrantLock *lock, int holds) {
+    lock->holds = holds;
+    if (lock->profile != NULL && holds > 0) {
+        lock->acquiredAt = profileNow();
+    }
+}
+
+#endif
+
+void profileReentrantLock(ReentrantLock *lock, const char *name) {
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    lockReentrantLock(lock);
+    LockProfile *profile = registerLockProfile(lock->profile, name, LOCK_PROFILE_LOCK);
+    if (lock->profile == NULL && profile != NULL) {
+        // account the current hold, so that the unlock below is balanced
+        lock->profile = profile;
+        lock->holds = 1;
+        lock->acquiredAt = profileNow();
+    }
+    unlockReentrantLock(lock);
+#endif
+}
+
 void unlockReentrantLock(ReentrantLock *lock) {
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    if (lock->profile != NULL) {
+        unlockProfileReentrantLock(lock);
+        return;
+    }
+#endif
     pthread_mutex_unlock(&lock->mutex);
 }
 
 void lockReentrantLock(ReentrantLock *lock) {
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    if (lock->profile != NULL) {
+        lockProfileReentrantLock(lock);
+        return;
+    }
+#endif
     pthread_mutex_lock(&lock->mutex);
 }
 
@@ -67,5 +152,13 @@ pthread_mutex_t *nativeHandleReentrantLock(ReentrantLock *lock) {
 }
 
 bool tryLockReentrantLock(ReentrantLock *lock) {
-    return pthread_mutex_trylock(&lock->mutex) == 0;
+    if (pthread_mutex_trylock(&lock->mutex) != 0) {
+        return false;
+    }
+#ifdef ZUTIL_CONCURRENT_PROFILING
+    if (lock->profile != NULL) {
+        acquiredProfileReentrantLock(lock, false, 0);
+    }
+#endif
+    return true;
 }
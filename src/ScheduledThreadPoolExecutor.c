@@ -0,0 +1,627 @@
+#include "ScheduledThreadPoolExecutor.h"
+#include "ReentrantLock.h"
+#include "Condition.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 5
+
+/* a timer further than the span of the wheel waits in the last level, and cascades again */
+#define WHEEL_SPAN ((uint64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+#define TIMER_CHUNK_BITS 12
+#define TIMER_CHUNK_SIZE (1 << TIMER_CHUNK_BITS)
+#define MAX_TIMERS ((uint64_t) 1 << 32)
+
+enum ExecutorState {
+    EXECUTOR_STATE_RUNNING,
+    EXECUTOR_STATE_SHUTDOWN,
+    EXECUTOR_STATE_STOP
+};
+
+enum TimerState {
+    TIMER_STATE_FREE,
+    /* in the wheel */
+    TIMER_STATE_PENDING,
+    /* a periodic timer dispatched to the pool, back to the wheel after the run */
+    TIMER_STATE_RUNNING,
+    /* a periodic timer cancelled during its run */
+    TIMER_STATE_CANCELLED
+};
+
+typedef struct TimerNode {
+    struct TimerNode *prev;
+    struct TimerNode *next;
+} TimerNode;
+
+struct ScheduledThreadPoolExecutor;
+
+/**
+ * A scheduled task. Timers live in chunks which never move, and are reused through a free list. The id of a timer
+ * is its generation and its index, the generation changes whenever the timer is freed, so a stale id matches no
+ * timer.
+ */
+typedef struct Timer {
+    TimerNode node;
+    struct ScheduledThreadPoolExecutor *executor;
+    void (*fn)(void *);
+    void *arg;
+
+    /* the tick of the next run, and the period in ticks (0 for a single run) */
+    uint64_t expires;
+    uint64_t period;
+
+    uint32_t index;
+    uint32_t generation;
+    enum TimerState state;
+    int level;
+} Timer;
+
+/**
+ * An implementation of ScheduledExecutorService.
+ */
+typedef struct ScheduledThreadPoolExecutor {
+    ScheduledExecutorService parent;
+    ExecutorService *pool;
+    enum ExecutorState s;
+
+    ReentrantLock *lock;
+    Condition *tick;
+    pthread_t ticker;
+    bool tickerStarted;
+
+    /* the wheel, a list of timers per slot and level, and the next tick to expire */
+    TimerNode wheel[WHEEL_LEVELS][WHEEL_SIZE];
+    uint64_t current;
+    size_t pendingSize;
+    size_t levelSizes[WHEEL_LEVELS];
+
+    /* ticks are counted on the monotonic clock from the creation */
+    uint64_t tickNs;
+    uint64_t startNs;
+
+    Timer **chunks;
+    size_t chunkSize;
+    Timer *freeTimers;
+
+    /* the expired tasks not yet accepted by the pool, in order, owned by the ticker */
+    Runnable *batch;
+    size_t batchSize;
+    size_t batchCapacity;
+} ScheduledThreadPoolExecutor;
+
+/* member functions */
+static void *tickerThread(void *arg);
+static void executorFree(ScheduledThreadPoolExecutor *executor);
+static void executorShutdown(ScheduledThreadPoolExecutor *executor);
+static bool executorGetShutdown(ScheduledThreadPoolExecutor *executor);
+static bool executorSubmit(ScheduledThreadPoolExecutor *executor, void (*fn)(void *), void *arg);
+static Runnable *executorShutdownNow(ScheduledThreadPoolExecutor *executor, size_t *size);
+static uint64_t executorSchedule(ScheduledThreadPoolExecutor *executor, void (*fn)(void *), void *arg, long delayMs);
+static uint64_t executorScheduleAtFixedRate(ScheduledThreadPoolExecutor *executor, void (*fn)(void *), void *arg,
+                                            long initialDelayMs, long periodMs);
+static bool executorCancel(ScheduledThreadPoolExecutor *executor, uint64_t task);
+
+inline static uint64_t monotonicNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+ScheduledExecutorService *newScheduledThreadPoolExecutor(size_t threadSize, size_t taskQueueSize, const char *format,
+                                                         BlockingQueueBuilder builder, long tickMs) {
+    if (tickMs < 1) {
+        return NULL;
+    }
+
+    ScheduledThreadPoolExecutor *executor = calloc(1, sizeof(ScheduledThreadPoolExecutor));
+    if (executor == NULL) {
+        return NULL;
+    }
+
+    // member function binding
+    ScheduledExecutorService parent = {
+            .parent = {
+                    .free = (void (*)(struct ExecutorService *)) executorFree,
+                    .shutdown = (void (*)(struct ExecutorService *)) executorShutdown,
+                    .submit = (bool (*)(struct ExecutorService *, void (*)(void *), void *)) executorSubmit,
+                    .isShutdown = (bool (*)(struct ExecutorService *)) executorGetShutdown,
+                    .shutdownNow = (Runnable *(*)(struct ExecutorService *, size_t *)) executorShutdownNow
+            },
+            .schedule = (uint64_t (*)(struct ScheduledExecutorService *, void (*)(void *), void *, long))
+                    executorSchedule,
+            .scheduleAtFixedRate = (uint64_t (*)(struct ScheduledExecutorService *, void (*)(void *), void *, long,
+                                                 long)) executorScheduleAtFixedRate,
+            .cancel = (bool (*)(struct ScheduledExecutorService *, uint64_t)) executorCancel
+    };
+    memcpy(&executor->parent, &parent, sizeof(ScheduledExecutorService));
+
+    for (int level = 0; level < WHEEL_LEVELS; ++level) {
+        for (int slot = 0; slot < WHEEL_SIZE; ++slot) {
+            TimerNode *head = &executor->wheel[level][slot];
+            head->prev = head;
+            head->next = head;
+        }
+    }
+    executor->tickNs = (uint64_t) tickMs * 1000000;
+    executor->startNs = monotonicNs();
+    atomic_init(&executor->s, EXECUTOR_STATE_RUNNING);
+
+    executor->pool = newFixedThreadPoolExecutor(threadSize, taskQueueSize, format, builder);
+    executor->lock = newReentrantLock();
+    if (executor->pool == NULL || executor->lock == NULL) {
+        executorFree(executor);
+        return NULL;
+    }
+    executor->tick = newCondition(executor->lock);
+    if (executor->tick == NULL || pthread_create(&executor->ticker, NULL, tickerThread, executor) != 0) {
+        executorFree(executor);
+        return NULL;
+    }
+    executor->tickerStarted = true;
+    return &executor->parent;
+}
+
+inline static uint64_t nowTick(ScheduledThreadPoolExecutor *executor) {
+    return (monotonicNs() - executor->startNs) / executor->tickNs;
+}
+
+/**
+ * @return the first tick which starts at least `delayMs` from now.
+ */
+inline static uint64_t tickAfter(ScheduledThreadPoolExecutor *executor, long delayMs) {
+    uint64_t deadline = monotonicNs() - executor->startNs + (uint64_t) delayMs * 1000000;
+    return (deadline + executor->tickNs - 1) / executor->tickNs;
+}
+
+inline static Timer *timerAt(ScheduledThreadPoolExecutor *executor, uint64_t index) {
+    return &executor->chunks[index >> TIMER_CHUNK_BITS][index & (TIMER_CHUNK_SIZE - 1)];
+}
+
+/**
+ * Take a free timer, allocating a chunk if there is none. The lock must be held.
+ */
+static Timer *allocateTimer(ScheduledThreadPoolExecutor *executor) {
+    if (executor->freeTimers == NULL) {
+        if ((executor->chunkSize + 1) * TIMER_CHUNK_SIZE > MAX_TIMERS) {
+            return NULL;
+        }
+        Timer **chunks = realloc(executor->chunks, sizeof(Timer *) * (executor->chunkSize + 1));
+        if (chunks == NULL) {
+            return NULL;
+        }
+        executor->chunks = chunks;
+        Timer *chunk = calloc(TIMER_CHUNK_SIZE, sizeof(Timer));
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunks[executor->chunkSize] = chunk;
+
+        // push in reverse, so the timers are taken in the index order
+        for (size_t i = TIMER_CHUNK_SIZE; i > 0; --i) {
+            Timer *timer = &chunk[i - 1];
+            timer->executor = executor;
+            timer->index = (uint32_t) (executor->chunkSize * TIMER_CHUNK_SIZE + i - 1);
+            timer->generation = 1;
+            timer->node.next = (TimerNode *) executor->freeTimers;
+            executor->freeTimers = timer;
+        }
+        executor->chunkSize += 1;
+    }
+
+    Timer *timer = executor->freeTimers;
+    executor->freeTimers = (Timer *) timer->node.next;
+    return timer;
+}
+
+/**
+ * Give the timer back to the free list, its id no longer matches. The lock must be held.
+ */
+static void releaseTimer(ScheduledThreadPoolExecutor *executor, Timer *timer) {
+    timer->state = TIMER_STATE_FREE;
+    timer->generation = timer->generation + 1 == 0 ? 1 : timer->generation + 1;
+    timer->fn = NULL;
+    timer->arg = NULL;
+    timer->node.next = (TimerNode *) executor->freeTimers;
+    executor->freeTimers = timer;
+}
+
+inline static uint64_t timerId(Timer *timer) {
+    return (uint64_t) timer->generation << 32 | timer->index;
+}
+
+/**
+ * Put the timer in the slot of the level which covers its distance from the current tick. The lock must be held.
+ */
+static void insertTimer(ScheduledThreadPoolExecutor *executor, Timer *timer) {
+    uint64_t current = executor->current;
+    uint64_t expires = timer->expires < current ? current : timer->expires;
+    if (expires - current >= WHEEL_SPAN) {
+        expires = current + WHEEL_SPAN - 1;
+    }
+    uint64_t delta = expires - current;
+
+    int level = 0;
+    while (level + 1 < WHEEL_LEVELS && delta >= (uint64_t) 1 << (WHEEL_BITS * (level + 1))) {
+        level += 1;
+    }
+    TimerNode *head = &executor->wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    timer->level = level;
+    executor->levelSizes[level] += 1;
+    timer->node.prev = head->prev;
+    timer->node.next = head;
+    head->prev->next = &timer->node;
+    head->prev = &timer->node;
+}
+
+inline static void unlinkTimer(ScheduledThreadPoolExecutor *executor, Timer *timer) {
+    executor->levelSizes[timer->level] -= 1;
+    timer->node.prev->next = timer->node.next;
+    timer->node.next->prev = timer->node.prev;
+    timer->node.prev = NULL;
+    timer->node.next = NULL;
+}
+
+/**
+ * Add a timer to the wheel, and wake the ticker if it sleeps past the timer. The lock must be held.
+ */
+static void addTimer(ScheduledThreadPoolExecutor *executor, Timer *timer) {
+    bool idle = executor->pendingSize == 0;
+    if (idle) {
+        // the idle ticker does not advance, catch up before the distance is measured
+        uint64_t now = nowTick(executor);
+        executor->current = now > executor->current ? now : executor->current;
+    }
+    timer->state = TIMER_STATE_PENDING;
+    insertTimer(executor, timer);
+    executor->pendingSize += 1;
+
+    // with an empty first level, the ticker sleeps until the next cascade, see nextEventTick
+    if (idle || (timer->level == 0 && executor->levelSizes[0] == 1)) {
+        signalCondition(executor->tick);
+    }
+}
+
+static uint64_t scheduleTimer(ScheduledThreadPoolExecutor *executor, void (*fn)(void *), void *arg, long delayMs,
+                              uint64_t period) {
+    if (atomic_load(&executor->s) != EXECUTOR_STATE_RUNNING || delayMs < 0) {
+        return 0;
+    }
+
+    lockReentrantLock(executor->lock);
+    Timer *timer = allocateTimer(executor);
+    if (timer == NULL) {
+        unlockReentrantLock(executor->lock);
+        return 0;
+    }
+    timer->fn = fn;
+    timer->arg = arg;
+    timer->period = period;
+    timer->expires = tickAfter(executor, delayMs);
+    addTimer(executor, timer);
+    uint64_t id = timerId(timer);
+    unlockReentrantLock(executor->lock);
+    return id;
+}
+
+static uint64_t executorSchedule(ScheduledThreadPoolExecutor *executor, void (*fn)(void *), void *arg, long delayMs) {
+    return scheduleTimer(executor, fn, arg, delayMs, 0);
+}
+
+static uint64_t executorScheduleAtFixedRate(ScheduledThreadPoolExecutor *executor, void (*fn)(void *), void *arg,
+                                            long initialDelayMs, long periodMs) {
+    if (periodMs < 1) {
+        return 0;
+    }
+    uint64_t period = ((uint64_t) periodMs * 1000000 + executor->tickNs - 1) / executor->tickNs;
+    return scheduleTimer(executor, fn, arg, initialDelayMs, period);
+}
+
+static bool executorCancel(ScheduledThreadPoolExecutor *executor, uint64_t task) {
+    uint64_t index = task & UINT32_MAX;
+    bool cancelled = false;
+
+    lockReentrantLock(executor->lock);
+    if (index < executor->chunkSize * TIMER_CHUNK_SIZE) {
+        Timer *timer = timerAt(executor, index);
+        if (timer->generation == task >> 32) {
+            if (timer->state == TIMER_STATE_PENDING) {
+                unlinkTimer(executor, timer);
+                executor->pendingSize -= 1;
+                releaseTimer(executor, timer);
+                cancelled = true;
+            } else if (timer->state == TIMER_STATE_RUNNING) {
+                // the run in progress releases the timer
+                timer->state = TIMER_STATE_CANCELLED;
+                cancelled = true;
+            }
+        }
+    }
+    unlockReentrantLock(executor->lock);
+    return cancelled;
+}
+
+/**
+ * Run a periodic task in the pool, then put its timer back to the wheel for the next period.
+ */
+static void runPeriodicTimer(void *arg) {
+    Timer *timer = arg;
+    timer->fn(timer->arg);
+
+    ScheduledThreadPoolExecutor *executor = timer->executor;
+    lockReentrantLock(executor->lock);
+    if (timer->state == TIMER_STATE_RUNNING && atomic_load(&executor->s) == EXECUTOR_STATE_RUNNING) {
+        // a late run does not move the next ones, the missed periods run in the next ticks
+        timer->expires += timer->period;
+        addTimer(executor, timer);
+    } else {
+        releaseTimer(executor, timer);
+    }
+    unlockReentrantLock(executor->lock);
+}
+
+/**
+ * Move the timers of a slot to the lower levels, when the current tick enters the range of the slot.
+ */
+static void cascadeTimers(ScheduledThreadPoolExecutor *executor, int level, uint64_t slot) {
+    TimerNode *head = &executor->wheel[level][slot];
+    TimerNode *node = head->next;
+    head->prev = head;
+    head->next = head;
+    while (node != head) {
+        TimerNode *next = node->next;
+        executor->levelSizes[level] -= 1;
+        insertTimer(executor, (Timer *) node);
+        node = next;
+    }
+}
+
+/**
+ * Append an expired timer to the batch, a single run is released at once. The lock must be held.
+ */
+static void expireTimer(ScheduledThreadPoolExecutor *executor, Timer *timer) {
+    if (executor->batchSize == executor->batchCapacity) {
+        size_t capacity = executor->batchCapacity == 0 ? 64 : executor->batchCapacity * 2;
+        Runnable *batch = realloc(executor->batch, sizeof(Runnable) * capacity);
+        if (batch == NULL) {
+            // run it later rather than lose it
+            timer->expires = executor->current + 1;
+            insertTimer(executor, timer);
+            return;
+        }
+        executor->batch = batch;
+        executor->batchCapacity = capacity;
+    }
+
+    executor->pendingSize -= 1;
+    if (timer->period == 0) {
+        executor->batch[executor->batchSize++] = (Runnable) {.fn = timer->fn, .arg = timer->arg};
+        releaseTimer(executor, timer);
+    } else {
+        timer->state = TIMER_STATE_RUNNING;
+        executor->batch[executor->batchSize++] = (Runnable) {.fn = runPeriodicTimer, .arg = timer};
+    }
+}
+
+/**
+ * Expire the current tick: cascade the upper levels at the start of their slots, then take the timers of the slot
+ * of the first level. The lock must be held.
+ */
+static void advanceTick(ScheduledThreadPoolExecutor *executor) {
+    uint64_t current = executor->current;
+    if ((current & WHEEL_MASK) == 0) {
+        for (int level = 1; level < WHEEL_LEVELS; ++level) {
+            uint64_t slot = (current >> (WHEEL_BITS * level)) & WHEEL_MASK;
+            cascadeTimers(executor, level, slot);
+            if (slot != 0) {
+                break;
+            }
+        }
+    }
+
+    TimerNode *head = &executor->wheel[0][current & WHEEL_MASK];
+    TimerNode *node = head->next;
+    head->prev = head;
+    head->next = head;
+    executor->current = current + 1;
+    while (node != head) {
+        TimerNode *next = node->next;
+        executor->levelSizes[0] -= 1;
+        node->prev = NULL;
+        node->next = NULL;
+        expireTimer(executor, (Timer *) node);
+        node = next;
+    }
+}
+
+/**
+ * @return the next tick which expires or cascades timers. Ticks with an empty first level do nothing until the
+ *         next cascade, so the ticker skips them. The lock must be held.
+ */
+inline static uint64_t nextEventTick(ScheduledThreadPoolExecutor *executor) {
+    uint64_t current = executor->current;
+    return executor->levelSizes[0] > 0 || (current & WHEEL_MASK) == 0 ? current : (current | WHEEL_MASK) + 1;
+}
+
+/**
+ * Submit the batch to the pool in order, until the pool refuses a task because its queue is full, and keep the
+ * rest for the next tick. The lock must be held, it is released during the submits.
+ *
+ * @return return true if the whole batch is dispatched.
+ */
+static bool dispatchBatch(ScheduledThreadPoolExecutor *executor) {
+    // only the ticker appends to the batch, so the first size tasks are stable without the lock
+    size_t size = executor->batchSize;
+    unlockReentrantLock(executor->lock);
+    size_t dispatched = 0;
+    while (dispatched < size) {
+        Runnable *task = &executor->batch[dispatched];
+        if (!executor->pool->submit(executor->pool, task->fn, task->arg)) {
+            break;
+        }
+        dispatched += 1;
+    }
+    lockReentrantLock(executor->lock);
+
+    executor->batchSize -= dispatched;
+    memmove(executor->batch, executor->batch + dispatched, sizeof(Runnable) * executor->batchSize);
+    return dispatched == size;
+}
+
+inline static long tickDurationMs(ScheduledThreadPoolExecutor *executor) {
+    return (long) (executor->tickNs / 1000000);
+}
+
+static void *tickerThread(void *arg) {
+    ScheduledThreadPoolExecutor *executor = arg;
+
+#ifdef _GNU_SOURCE
+    pthread_setname_np(pthread_self(), "ticker");
+#endif
+
+    lockReentrantLock(executor->lock);
+    while (atomic_load(&executor->s) == EXECUTOR_STATE_RUNNING) {
+        if (executor->pendingSize == 0 && executor->batchSize == 0) {
+            awaitCondition(executor->tick, -1);
+            continue;
+        }
+
+        uint64_t now = nowTick(executor);
+        while (executor->pendingSize > 0 && nextEventTick(executor) <= now) {
+            executor->current = nextEventTick(executor);
+            advanceTick(executor);
+        }
+        if (executor->batchSize == 0) {
+            if (executor->pendingSize > 0) {
+                int64_t untilNs = (int64_t) (executor->startNs + nextEventTick(executor) * executor->tickNs
+                                             - monotonicNs());
+                if (untilNs > 0) {
+                    awaitCondition(executor->tick, (long) ((untilNs + 999999) / 1000000));
+                }
+            }
+            continue;
+        }
+
+        // the pool only refuses a task when its queue is full, the ticker retries at the next tick
+        if (!dispatchBatch(executor)) {
+            awaitCondition(executor->tick, tickDurationMs(executor));
+        }
+    }
+
+    // the tasks which expired before shutdown still run, the pool is shut down after the ticker is joined
+    while (atomic_load(&executor->s) == EXECUTOR_STATE_SHUTDOWN && !dispatchBatch(executor)) {
+        awaitCondition(executor->tick, tickDurationMs(executor));
+    }
+    unlockReentrantLock(executor->lock);
+    return NULL;
+}
+
+/**
+ * Stop the ticker, the timers stay in the wheel. On shutdown the ticker hands the expired tasks to the pool before
+ * it exits.
+ *
+ * @return return false if the executor was already shut down.
+ */
+static bool stopTicker(ScheduledThreadPoolExecutor *executor, enum ExecutorState to) {
+    enum ExecutorState state = EXECUTOR_STATE_RUNNING;
+    if (!atomic_compare_exchange_strong(&executor->s, &state, to)) {
+        return false;
+    }
+    if (executor->tickerStarted) {
+        lockReentrantLock(executor->lock);
+        signalAllCondition(executor->tick);
+        unlockReentrantLock(executor->lock);
+        pthread_join(executor->ticker, NULL);
+    }
+    return true;
+}
+
+static bool executorSubmit(ScheduledThreadPoolExecutor *executor, void (*fn)(void *), void *arg) {
+    if (atomic_load(&executor->s) != EXECUTOR_STATE_RUNNING) {
+        return false;
+    }
+    return executor->pool->submit(executor->pool, fn, arg);
+}
+
+static void executorShutdown(ScheduledThreadPoolExecutor *executor) {
+    if (stopTicker(executor, EXECUTOR_STATE_SHUTDOWN)) {
+        // the running periodic tasks see the state and release their timers
+        executor->pool->shutdown(executor->pool);
+    }
+}
+
+static Runnable *executorShutdownNow(ScheduledThreadPoolExecutor *executor, size_t *size) {
+    *size = 0;
+    if (!stopTicker(executor, EXECUTOR_STATE_STOP)) {
+        return NULL;
+    }
+
+    size_t queuedSize;
+    Runnable *queued = executor->pool->shutdownNow(executor->pool, &queuedSize);
+
+    lockReentrantLock(executor->lock);
+    Runnable *pending = malloc(sizeof(Runnable) * (queuedSize + executor->batchSize + executor->pendingSize + 1));
+    if (pending != NULL) {
+        // the tasks queued in the pool, then the expired tasks the pool had no room for
+        Runnable *tasks[] = {queued, executor->batch};
+        size_t sizes[] = {queuedSize, executor->batchSize};
+        for (int t = 0; t < 2; ++t) {
+            for (size_t i = 0; i < sizes[t]; ++i) {
+                // a periodic task never started is handed back as its own function
+                if (tasks[t][i].fn == runPeriodicTimer) {
+                    Timer *timer = tasks[t][i].arg;
+                    pending[(*size)++] = (Runnable) {.fn = timer->fn, .arg = timer->arg};
+                    releaseTimer(executor, timer);
+                } else {
+                    pending[(*size)++] = tasks[t][i];
+                }
+            }
+        }
+        executor->batchSize = 0;
+        for (int level = 0; level < WHEEL_LEVELS; ++level) {
+            for (int slot = 0; slot < WHEEL_SIZE; ++slot) {
+                TimerNode *head = &executor->wheel[level][slot];
+                while (head->next != head) {
+                    Timer *timer = (Timer *) head->next;
+                    unlinkTimer(executor, timer);
+                    pending[(*size)++] = (Runnable) {.fn = timer->fn, .arg = timer->arg};
+                    releaseTimer(executor, timer);
+                }
+            }
+        }
+        executor->pendingSize = 0;
+    }
+    unlockReentrantLock(executor->lock);
+    free(queued);
+    return pending;
+}
+
+static void executorFree(ScheduledThreadPoolExecutor *executor) {
+    if (executor->pool) {
+        executorShutdown(executor);
+        executor->pool->free(executor->pool);
+    }
+    if (executor->tick) {
+        freeCondition(executor->tick);
+    }
+    if (executor->lock) {
+        freeReentrantLock(executor->lock);
+    }
+    for (size_t i = 0; i < executor->chunkSize; ++i) {
+        free(executor->chunks[i]);
+    }
+    free(executor->chunks);
+    free(executor->batch);
+    free(executor);
+}
+
+static bool executorGetShutdown(ScheduledThreadPoolExecutor *executor) {
+    return atomic_load(&executor->s) != EXECUTOR_STATE_RUNNING;
+}
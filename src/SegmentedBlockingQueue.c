@@ -0,0 +1,395 @@
+#include "SegmentedBlockingQueue.h"
+
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ReentrantLock.h"
+#include "Condition.h"
+#include "LockProfiler.h"
+
+/**
+ * The number of items of a segment.
+ */
+#define SEGMENT_SIZE 1024
+
+/**
+ * A segment of SEGMENT_SIZE items.
+ */
+typedef struct Segment {
+    struct Segment *next;
+    char items[];
+} Segment;
+
+/**
+ * A Segmented BlockingQueue implementation using the two lock queue algorithm of LinkedBlockingQueue: the producers
+ * own the tail under putLock, the consumers own the head under takeLock, and the atomic count publishes the items
+ * and the links between them.
+ */
+typedef struct SegmentedBlockingQueue {
+    BlockingQueue parent;
+
+    ReentrantLock *putLock;
+    ReentrantLock *takeLock;
+    Condition *nonFull;
+    Condition *nonEmpty;
+
+    size_t capacity;
+    size_t count;
+    size_t itemSize;
+
+    /* written under both locks, so either lock is enough to read it */
+    bool closed;
+
+    /* the segment of the next poll, and the index of the item in it, under takeLock */
+    Segment *head;
+    size_t headIndex;
+
+    /* the segment of the next offer, and the index of the item in it, under putLock */
+    Segment *tail;
+    size_t tailIndex;
+
+    /* a drained segment, exchanged between the consumers and the producers */
+    Segment *spare;
+} SegmentedBlockingQueue;
+
+/* member functions */
+static void queueFree(SegmentedBlockingQueue *queue);
+
+static bool queuePoll(SegmentedBlockingQueue *queue, void *item, long timeoutMs);
+
+static bool queueOffer(SegmentedBlockingQueue *queue, void *item, long timeoutMs);
+
+static void queueProfile(SegmentedBlockingQueue *queue, const char *name);
+
+static bool queueRegisterWaiter(SegmentedBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueUnregisterWaiter(SegmentedBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueClose(SegmentedBlockingQueue *queue);
+
+static bool queueIsClosed(SegmentedBlockingQueue *queue);
+
+static size_t queueDrain(SegmentedBlockingQueue *queue, void *items, size_t maxItems, long timeoutMs);
+
+/* private member functions */
+inline static Segment *newSegment(SegmentedBlockingQueue *queue);
+
+inline static bool enqueue(SegmentedBlockingQueue *queue, void *item, size_t *before);
+
+inline static void takeItem(SegmentedBlockingQueue *queue, void *item);
+
+inline static size_t dequeue(SegmentedBlockingQueue *queue, void *item);
+
+
+BlockingQueue *newSegmentedBlockingQueue(size_t capacity, size_t itemSize) {
+    if (capacity == 0 || itemSize == 0 || itemSize > (SIZE_MAX - sizeof(Segment)) / SEGMENT_SIZE) {
+        return NULL;
+    }
+
+    SegmentedBlockingQueue *queue = calloc(1, sizeof(SegmentedBlockingQueue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    // member function binding
+    BlockingQueue parent = {
+            .offer = (bool (*)(struct BlockingQueue *, void *, long)) queueOffer,
+            .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll,
+            .free = (void (*)(struct BlockingQueue *)) queueFree,
+            .profile = (void (*)(struct BlockingQueue *, const char *)) queueProfile,
+            .registerWaiter = (bool (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueRegisterWaiter,
+            .unregisterWaiter = (void (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueUnregisterWaiter,
+            .close = (void (*)(struct BlockingQueue *)) queueClose,
+            .isClosed = (bool (*)(struct BlockingQueue *)) queueIsClosed,
+            .drain = (size_t (*)(struct BlockingQueue *, void *, size_t, long)) queueDrain
+    };
+    memcpy(&queue->parent, &parent, sizeof(BlockingQueue));
+
+    queue->itemSize = itemSize;
+    queue->capacity = capacity;
+    atomic_init(&queue->count, 0);
+    atomic_init(&queue->spare, NULL);
+
+    queue->putLock = newReentrantLock();
+    queue->takeLock = newReentrantLock();
+    if (queue->putLock == NULL || queue->takeLock == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    queue->nonEmpty = newCondition(queue->takeLock);
+    queue->nonFull = newCondition(queue->putLock);
+    if (queue->nonFull == NULL || queue->nonEmpty == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    queue->head = newSegment(queue);
+    queue->tail = queue->head;
+    if (queue->head == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+    return &queue->parent;
+}
+
+/**
+ * Take the spare segment, or allocate one.
+ *
+ * @param queue     the blocking queue.
+ * @return          return NULL if failed.
+ */
+inline static Segment *newSegment(SegmentedBlockingQueue *queue) {
+    Segment *segment = atomic_exchange(&queue->spare, NULL);
+    if (segment == NULL) {
+        segment = malloc(sizeof(Segment) + SEGMENT_SIZE * queue->itemSize);
+        if (segment == NULL) {
+            return NULL;
+        }
+    }
+    segment->next = NULL;
+    return segment;
+}
+
+/**
+ * Keep a drained segment as the spare, only one is kept.
+ */
+inline static void recycleSegment(SegmentedBlockingQueue *queue, Segment *segment) {
+    free(atomic_exchange(&queue->spare, segment));
+}
+
+static void queueFree(SegmentedBlockingQueue *queue) {
+    if (queue->takeLock) {
+        lockReentrantLock(queue->takeLock);
+    }
+
+    Segment *segment = queue->head;
+    while (segment != NULL) {
+        Segment *next = segment->next;
+        free(segment);
+        segment = next;
+    }
+    queue->head = NULL;
+    queue->tail = NULL;
+    free(atomic_load(&queue->spare));
+
+    if (queue->takeLock) {
+        unlockReentrantLock(queue->takeLock);
+    }
+    if (queue->nonEmpty) {
+        freeCondition(queue->nonEmpty);
+    }
+    if (queue->nonFull) {
+        freeCondition(queue->nonFull);
+    }
+    if (queue->takeLock) {
+        freeReentrantLock(queue->takeLock);
+    }
+    if (queue->putLock) {
+        freeReentrantLock(queue->putLock);
+    }
+    free(queue);
+}
+
+/**
+ * Put an item to the queue, moving to a new segment when the tail is full.
+ *
+ * @param queue     the blocking queue.
+ * @param item      the item to be put.
+ * @param before    the number of item before enqueue.
+ * @return          return false if no segment can be allocated.
+ */
+inline static bool enqueue(SegmentedBlockingQueue *queue, void *item, size_t *before) {
+    if (queue->tailIndex == SEGMENT_SIZE) {
+        Segment *segment = newSegment(queue);
+        if (segment == NULL) {
+            return false;
+        }
+        // published to the consumers by the count below
+        queue->tail->next = segment;
+        queue->tail = segment;
+        queue->tailIndex = 0;
+    }
+    memcpy(queue->tail->items + queue->tailIndex++ * queue->itemSize, item, queue->itemSize);
+
+    *before = atomic_fetch_add(&queue->count, 1);
+    return true;
+}
+
+/**
+ * Take an item without counting it, moving to the next segment when the head is drained. The queue must not be
+ * empty.
+ *
+ * @param queue     the blocking queue.
+ * @param item      the return item.
+ */
+inline static void takeItem(SegmentedBlockingQueue *queue, void *item) {
+    if (queue->headIndex == SEGMENT_SIZE) {
+        // the item counted means the producer already linked its segment
+        Segment *drained = queue->head;
+        queue->head = drained->next;
+        queue->headIndex = 0;
+        recycleSegment(queue, drained);
+    }
+    memcpy(item, queue->head->items + queue->headIndex++ * queue->itemSize, queue->itemSize);
+}
+
+/**
+ * Take an item from the queue.
+ *
+ * @param queue     the blocking queue.
+ * @param item      the return item.
+ * @return          the number of item before dequeue.
+ */
+inline static size_t dequeue(SegmentedBlockingQueue *queue, void *item) {
+    takeItem(queue, item);
+    return atomic_fetch_add(&queue->count, -1);
+}
+
+static bool queuePoll(SegmentedBlockingQueue *queue, void *item, long timeoutMs) {
+    ReentrantLock *takeLock = queue->takeLock;
+    Condition *nonEmpty = queue->nonEmpty;
+    size_t capacity = queue->capacity;
+    lockReentrantLock(takeLock);
+
+    while (atomic_load(&queue->count) == 0) {
+        timeoutMs = queue->closed ? 0 : awaitCondition(nonEmpty, timeoutMs);
+
+        if (timeoutMs == 0) {
+            unlockReentrantLock(takeLock);
+            return false;
+        }
+    }
+
+    size_t before = dequeue(queue, item);
+    if (before > 1) {
+        signalCondition(nonEmpty);
+    }
+
+    unlockReentrantLock(takeLock);
+
+    if (before == capacity) {
+        lockReentrantLock(queue->putLock);
+        signalCondition(queue->nonFull);
+        unlockReentrantLock(queue->putLock);
+    }
+    return true;
+}
+
+static size_t queueDrain(SegmentedBlockingQueue *queue, void *items, size_t maxItems, long timeoutMs) {
+    ReentrantLock *takeLock = queue->takeLock;
+    Condition *nonEmpty = queue->nonEmpty;
+    size_t capacity = queue->capacity;
+    if (maxItems == 0) {
+        return 0;
+    }
+    lockReentrantLock(takeLock);
+
+    size_t count;
+    while ((count = atomic_load(&queue->count)) == 0) {
+        timeoutMs = queue->closed ? 0 : awaitCondition(nonEmpty, timeoutMs);
+
+        if (timeoutMs == 0) {
+            unlockReentrantLock(takeLock);
+            return 0;
+        }
+    }
+
+    // the count only grows meanwhile, one update for the whole batch
+    size_t size = count < maxItems ? count : maxItems;
+    for (size_t i = 0; i < size; ++i) {
+        takeItem(queue, (char *) items + i * queue->itemSize);
+    }
+    size_t before = atomic_fetch_sub(&queue->count, size);
+    if (before > size) {
+        signalCondition(nonEmpty);
+    }
+
+    unlockReentrantLock(takeLock);
+
+    if (before == capacity) {
+        lockReentrantLock(queue->putLock);
+        signalCondition(queue->nonFull);
+        unlockReentrantLock(queue->putLock);
+    }
+    return size;
+}
+
+static bool queueOffer(SegmentedBlockingQueue *queue, void *item, long timeoutMs) {
+    ReentrantLock *putLock = queue->putLock;
+    Condition *nonFull = queue->nonFull;
+    size_t capacity = queue->capacity;
+    lockReentrantLock(putLock);
+
+    while (atomic_load(&queue->count) == capacity) {
+        timeoutMs = queue->closed ? 0 : awaitCondition(nonFull, timeoutMs);
+
+        if (timeoutMs == 0) {
+            unlockReentrantLock(putLock);
+            return false;
+        }
+    }
+
+    size_t before;
+    if (queue->closed || !enqueue(queue, item, &before)) {
+        unlockReentrantLock(putLock);
+        return false;
+    }
+
+    if (before + 1 < capacity) {
+        signalCondition(nonFull);
+    }
+
+    unlockReentrantLock(putLock);
+
+    if (before == 0) {
+        lockReentrantLock(queue->takeLock);
+        signalCondition(queue->nonEmpty);
+        unlockReentrantLock(queue->takeLock);
+    }
+    return true;
+}
+
+static void queueProfile(SegmentedBlockingQueue *queue, const char *name) {
+    char buffer[LOCK_PROFILE_NAME_MAX];
+    snprintf(buffer, sizeof(buffer), "%s.putLock", name);
+    profileReentrantLock(queue->putLock, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.takeLock", name);
+    profileReentrantLock(queue->takeLock, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonEmpty", name);
+    profileCondition(queue->nonEmpty, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonFull", name);
+    profileCondition(queue->nonFull, buffer);
+}
+
+static bool queueRegisterWaiter(SegmentedBlockingQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->takeLock);
+    bool registered = registerConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->takeLock);
+    return registered;
+}
+
+static void queueUnregisterWaiter(SegmentedBlockingQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->takeLock);
+    unregisterConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->takeLock);
+}
+
+static void queueClose(SegmentedBlockingQueue *queue) {
+    lockReentrantLock(queue->putLock);
+    lockReentrantLock(queue->takeLock);
+    queue->closed = true;
+    signalAllCondition(queue->nonEmpty);
+    unlockReentrantLock(queue->takeLock);
+    signalAllCondition(queue->nonFull);
+    unlockReentrantLock(queue->putLock);
+}
+
+static bool queueIsClosed(SegmentedBlockingQueue *queue) {
+    lockReentrantLock(queue->takeLock);
+    bool closed = queue->closed;
+    unlockReentrantLock(queue->takeLock);
+    return closed;
+}
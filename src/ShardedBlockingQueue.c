@@ -0,0 +1,178 @@
+#include "ShardedBlockingQueue.h"
+#include "ArrayBlockingQueue.h"
+#include "SegmentedBlockingQueue.h"
+#include "LockProfiler.h"
+#include "ThreadLocal.h"
+
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SHARDED_QUEUE_MAX_LANES 64
+
+/**
+ * A Sharded BlockingQueue implementation over lanes of any BlockingQueue. The lanes are only ever closed together,
+ * from the first to the last.
+ */
+typedef struct ShardedBlockingQueue {
+    BlockingQueue parent;
+
+    size_t laneSize;
+    BlockingQueue *lanes[];
+} ShardedBlockingQueue;
+
+/* member functions */
+static void queueFree(ShardedBlockingQueue *queue);
+
+static bool queuePoll(ShardedBlockingQueue *queue, void *item, long timeoutMs);
+
+static bool queueOffer(ShardedBlockingQueue *queue, void *item, long timeoutMs);
+
+static void queueProfile(ShardedBlockingQueue *queue, const char *name);
+
+static bool queueRegisterWaiter(ShardedBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueUnregisterWaiter(ShardedBlockingQueue *queue, ConditionWaiter *waiter);
+
+static void queueClose(ShardedBlockingQueue *queue);
+
+static bool queueIsClosed(ShardedBlockingQueue *queue);
+
+/* the probe of a thread, shared by all the sharded queues */
+static ThreadLocal threadProbe = THREAD_LOCAL_INITIALIZER;
+static size_t nextProbe = 0;
+
+static void *newThreadProbe(void *arg) {
+    // store probe + 1, so that the probe 0 is not NULL
+    return (void *) (uintptr_t) (atomic_fetch_add(&nextProbe, 1) + 1);
+}
+
+/**
+ * Get the home lane of the current thread. Probes are assigned round-robin, so threads spread evenly over the lanes.
+ */
+inline static size_t homeLane(ShardedBlockingQueue *queue) {
+    void *probe = getThreadLocal(&threadProbe);
+    if (probe == NULL) {
+        probe = computeIfAbsentThreadLocal(&threadProbe, newThreadProbe, NULL, NULL);
+    }
+    return ((size_t) (uintptr_t) probe - 1) % queue->laneSize;
+}
+
+BlockingQueue *newShardedBlockingQueue(size_t capacity, size_t itemSize) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t lanes = processors < 1 ? 1 : (size_t) processors;
+    if (lanes > SHARDED_QUEUE_MAX_LANES) {
+        lanes = SHARDED_QUEUE_MAX_LANES;
+    }
+    // every lane holds one item at least
+    if (lanes > capacity) {
+        lanes = capacity;
+    }
+    return newShardedBlockingQueueWithLanes(lanes, capacity, itemSize, capacity == BLOCKING_QUEUE_UNBOUNDED
+                                                                       ? newSegmentedBlockingQueue
+                                                                       : newArrayBlockingQueue);
+}
+
+BlockingQueue *newShardedBlockingQueueWithLanes(size_t laneSize, size_t capacity, size_t itemSize,
+                                                BlockingQueue *(*builder)(size_t, size_t)) {
+    if (laneSize == 0 || laneSize > capacity) {
+        return NULL;
+    }
+
+    ShardedBlockingQueue *queue = calloc(1, sizeof(ShardedBlockingQueue) + sizeof(BlockingQueue *) * laneSize);
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    // member function binding
+    BlockingQueue parent = {
+            .offer = (bool (*)(struct BlockingQueue *, void *, long)) queueOffer,
+            .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll,
+            .free = (void (*)(struct BlockingQueue *)) queueFree,
+            .profile = (void (*)(struct BlockingQueue *, const char *)) queueProfile,
+            .registerWaiter = (bool (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueRegisterWaiter,
+            .unregisterWaiter = (void (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueUnregisterWaiter,
+            .close = (void (*)(struct BlockingQueue *)) queueClose,
+            .isClosed = (bool (*)(struct BlockingQueue *)) queueIsClosed
+    };
+    memcpy(&queue->parent, &parent, sizeof(BlockingQueue));
+
+    size_t laneCapacity = capacity == BLOCKING_QUEUE_UNBOUNDED ? capacity : (capacity + laneSize - 1) / laneSize;
+    for (size_t i = 0; i < laneSize; ++i) {
+        queue->lanes[i] = builder(laneCapacity, itemSize);
+        if (queue->lanes[i] == NULL) {
+            queueFree(queue);
+            return NULL;
+        }
+        queue->laneSize += 1;
+    }
+    return &queue->parent;
+}
+
+static void queueFree(ShardedBlockingQueue *queue) {
+    for (size_t i = 0; i < queue->laneSize; ++i) {
+        queue->lanes[i]->free(queue->lanes[i]);
+    }
+    free(queue);
+}
+
+static bool queuePoll(ShardedBlockingQueue *queue, void *item, long timeoutMs) {
+    // pollAny starts after *index, i.e. from the home lane, then steals from the next lanes
+    size_t home = homeLane(queue);
+    size_t index = home == 0 ? queue->laneSize - 1 : home - 1;
+    return pollAnyBlockingQueue(queue->lanes, queue->laneSize, &index, item, timeoutMs, POLL_ANY_FAIR);
+}
+
+static bool queueOffer(ShardedBlockingQueue *queue, void *item, long timeoutMs) {
+    size_t home = homeLane(queue);
+    for (size_t i = 0; i < queue->laneSize; ++i) {
+        size_t lane = home + i < queue->laneSize ? home + i : home + i - queue->laneSize;
+        if (queue->lanes[lane]->offer(queue->lanes[lane], item, 0)) {
+            return true;
+        }
+    }
+    // all the lanes are full, wait for the home lane
+    return timeoutMs != 0 && queue->lanes[home]->offer(queue->lanes[home], item, timeoutMs);
+}
+
+static void queueProfile(ShardedBlockingQueue *queue, const char *name) {
+    char buffer[LOCK_PROFILE_NAME_MAX];
+    for (size_t i = 0; i < queue->laneSize; ++i) {
+        snprintf(buffer, sizeof(buffer), "%s.lane%zu", name, i);
+        profileBlockingQueue(queue->lanes[i], buffer);
+    }
+}
+
+static bool queueRegisterWaiter(ShardedBlockingQueue *queue, ConditionWaiter *waiter) {
+    for (size_t i = 0; i < queue->laneSize; ++i) {
+        BlockingQueue *lane = queue->lanes[i];
+        if (lane->registerWaiter == NULL || !lane->registerWaiter(lane, waiter)) {
+            while (i-- > 0) {
+                queue->lanes[i]->unregisterWaiter(queue->lanes[i], waiter);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+static void queueUnregisterWaiter(ShardedBlockingQueue *queue, ConditionWaiter *waiter) {
+    for (size_t i = 0; i < queue->laneSize; ++i) {
+        queue->lanes[i]->unregisterWaiter(queue->lanes[i], waiter);
+    }
+}
+
+static void queueClose(ShardedBlockingQueue *queue) {
+    for (size_t i = 0; i < queue->laneSize; ++i) {
+        queue->lanes[i]->close(queue->lanes[i]);
+    }
+}
+
+static bool queueIsClosed(ShardedBlockingQueue *queue) {
+    // the last lane is closed last
+    BlockingQueue *last = queue->lanes[queue->laneSize - 1];
+    return last->isClosed(last);
+}
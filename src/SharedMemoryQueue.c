@@ -0,0 +1,327 @@
+#include "SharedMemoryQueue.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHARED_MEMORY_QUEUE_MAGIC 0x7a7574696c53514dULL
+#define SHARED_MEMORY_QUEUE_ALIGN 64
+
+/**
+ * The part of the queue in the shared memory. It holds no pointer, the items start at `dataOffset` from the
+ * start of the state. `magic` is stored last by the creator, so an attached process sees an initialized state.
+ */
+typedef struct SharedQueueState {
+    uint64_t magic;
+    uint64_t mapSize;
+    uint64_t dataOffset;
+    uint64_t capacity;
+    uint64_t itemSize;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t nonFull;
+    pthread_cond_t nonEmpty;
+
+    uint64_t size;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t closed;
+} SharedQueueState;
+
+/**
+ * The process local view of a shared queue.
+ */
+typedef struct SharedMemoryQueue {
+    BlockingQueue parent;
+
+    SharedQueueState *state;
+    char *data;
+    size_t mapSize;
+} SharedMemoryQueue;
+
+/* member functions */
+static void queueFree(SharedMemoryQueue *queue);
+
+static bool queuePoll(SharedMemoryQueue *queue, void *item, long timeoutMs);
+
+static bool queueOffer(SharedMemoryQueue *queue, void *item, long timeoutMs);
+
+static void queueProfile(SharedMemoryQueue *queue, const char *name);
+
+static void queueClose(SharedMemoryQueue *queue);
+
+static bool queueIsClosed(SharedMemoryQueue *queue);
+
+inline static size_t dataOffset() {
+    return (sizeof(SharedQueueState) + SHARED_MEMORY_QUEUE_ALIGN - 1) & ~(size_t) (SHARED_MEMORY_QUEUE_ALIGN - 1);
+}
+
+/**
+ * Map the shared memory and bind the member functions.
+ */
+static SharedMemoryQueue *mapSharedMemoryQueue(int fd, size_t mapSize) {
+    SharedMemoryQueue *queue = calloc(1, sizeof(SharedMemoryQueue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    void *address = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        free(queue);
+        return NULL;
+    }
+
+    // member function binding
+    BlockingQueue parent = {
+            .offer = (bool (*)(struct BlockingQueue *, void *, long)) queueOffer,
+            .free = (void (*)(struct BlockingQueue *)) queueFree,
+            .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll,
+            .profile = (void (*)(struct BlockingQueue *, const char *)) queueProfile,
+            .close = (void (*)(struct BlockingQueue *)) queueClose,
+            .isClosed = (bool (*)(struct BlockingQueue *)) queueIsClosed
+    };
+    memcpy(&queue->parent, &parent, sizeof(BlockingQueue));
+
+    queue->state = address;
+    queue->data = (char *) address + dataOffset();
+    queue->mapSize = mapSize;
+    return queue;
+}
+
+/**
+ * Initialize the process-shared robust mutex and the conditions, which wait on the monotonic clock.
+ */
+static bool initSharedQueueState(SharedQueueState *state) {
+    pthread_mutexattr_t mutexAttr;
+    if (pthread_mutexattr_init(&mutexAttr)) {
+        return false;
+    }
+    pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+    int error = pthread_mutex_init(&state->mutex, &mutexAttr);
+    pthread_mutexattr_destroy(&mutexAttr);
+    if (error) {
+        return false;
+    }
+
+    pthread_condattr_t condAttr;
+    if (pthread_condattr_init(&condAttr)) {
+        pthread_mutex_destroy(&state->mutex);
+        return false;
+    }
+    pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    if (pthread_cond_init(&state->nonFull, &condAttr)) {
+        pthread_condattr_destroy(&condAttr);
+        pthread_mutex_destroy(&state->mutex);
+        return false;
+    }
+    if (pthread_cond_init(&state->nonEmpty, &condAttr)) {
+        pthread_cond_destroy(&state->nonFull);
+        pthread_condattr_destroy(&condAttr);
+        pthread_mutex_destroy(&state->mutex);
+        return false;
+    }
+    pthread_condattr_destroy(&condAttr);
+    return true;
+}
+
+BlockingQueue *createSharedMemoryQueue(const char *name, size_t capacity, size_t itemSize) {
+    if (capacity == 0 || itemSize == 0 || BLOCKING_QUEUE_UNBOUNDED - capacity == 0
+        || (BLOCKING_QUEUE_UNBOUNDED - dataOffset()) / itemSize < capacity) {
+        return NULL;
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    size_t mapSize = dataOffset() + capacity * itemSize;
+    SharedMemoryQueue *queue = ftruncate(fd, (off_t) mapSize) == 0 ? mapSharedMemoryQueue(fd, mapSize) : NULL;
+    close(fd);
+    if (queue == NULL) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    SharedQueueState *state = queue->state;
+    if (!initSharedQueueState(state)) {
+        queueFree(queue);
+        shm_unlink(name);
+        return NULL;
+    }
+    state->mapSize = mapSize;
+    state->dataOffset = dataOffset();
+    state->capacity = capacity;
+    state->itemSize = itemSize;
+    state->size = 0;
+    state->head = 0;
+    state->tail = 0;
+    state->closed = false;
+    atomic_store_explicit(&state->magic, SHARED_MEMORY_QUEUE_MAGIC, memory_order_release);
+    return &queue->parent;
+}
+
+BlockingQueue *attachSharedMemoryQueue(const char *name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    struct stat stat;
+    if (fstat(fd, &stat) || stat.st_size < (off_t) sizeof(SharedQueueState)) {
+        close(fd);
+        return NULL;
+    }
+
+    SharedMemoryQueue *queue = mapSharedMemoryQueue(fd, (size_t) stat.st_size);
+    close(fd);
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    SharedQueueState *state = queue->state;
+    if (atomic_load_explicit(&state->magic, memory_order_acquire) != SHARED_MEMORY_QUEUE_MAGIC
+        || state->mapSize != queue->mapSize || state->dataOffset != dataOffset()) {
+        queueFree(queue);
+        return NULL;
+    }
+    return &queue->parent;
+}
+
+bool unlinkSharedMemoryQueue(const char *name) {
+    return shm_unlink(name) == 0;
+}
+
+size_t capacitySharedMemoryQueue(BlockingQueue *queue) {
+    return ((SharedMemoryQueue *) queue)->state->capacity;
+}
+
+size_t itemSizeSharedMemoryQueue(BlockingQueue *queue) {
+    return ((SharedMemoryQueue *) queue)->state->itemSize;
+}
+
+/**
+ * Lock the shared mutex, recovering it if its owner died.
+ */
+inline static void lockSharedQueueState(SharedQueueState *state) {
+    if (pthread_mutex_lock(&state->mutex) == EOWNERDEAD) {
+        pthread_mutex_consistent(&state->mutex);
+    }
+}
+
+/**
+ * Wait on a shared condition until the deadline, NULL means forever.
+ *
+ * @return return false if timeout.
+ */
+inline static bool awaitSharedQueueState(SharedQueueState *state, pthread_cond_t *condition,
+                                         const struct timespec *deadline) {
+    int error = deadline == NULL ? pthread_cond_wait(condition, &state->mutex)
+                                 : pthread_cond_timedwait(condition, &state->mutex, deadline);
+    if (error == EOWNERDEAD) {
+        pthread_mutex_consistent(&state->mutex);
+    }
+    return error != ETIMEDOUT;
+}
+
+/**
+ * Get the deadline after `timeoutMs` ms on the monotonic clock, or NULL for -1.
+ */
+inline static struct timespec *deadlineAfter(struct timespec *deadline, long timeoutMs) {
+    if (timeoutMs == -1) {
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += timeoutMs % 1000 * 1000000;
+    deadline->tv_sec += deadline->tv_nsec / 1000000000;
+    deadline->tv_nsec = deadline->tv_nsec % 1000000000;
+    return deadline;
+}
+
+static void queueFree(SharedMemoryQueue *queue) {
+    munmap(queue->state, queue->mapSize);
+    free(queue);
+}
+
+static bool queuePoll(SharedMemoryQueue *queue, void *item, long timeoutMs) {
+    SharedQueueState *state = queue->state;
+    struct timespec buffer;
+    struct timespec *deadline = deadlineAfter(&buffer, timeoutMs);
+
+    lockSharedQueueState(state);
+    while (state->size == 0) {
+        if (timeoutMs == 0 || state->closed || !awaitSharedQueueState(state, &state->nonEmpty, deadline)) {
+            if (state->size > 0) {
+                break;
+            }
+            pthread_mutex_unlock(&state->mutex);
+            return false;
+        }
+    }
+
+    memcpy(item, queue->data + state->head * state->itemSize, state->itemSize);
+    state->head = state->head + 1 >= state->capacity ? 0 : state->head + 1;
+    state->size -= 1;
+
+    // one item frees one slot, so one waiting producer is enough
+    pthread_cond_signal(&state->nonFull);
+    pthread_mutex_unlock(&state->mutex);
+    return true;
+}
+
+static bool queueOffer(SharedMemoryQueue *queue, void *item, long timeoutMs) {
+    SharedQueueState *state = queue->state;
+    struct timespec buffer;
+    struct timespec *deadline = deadlineAfter(&buffer, timeoutMs);
+
+    lockSharedQueueState(state);
+    while (state->size == state->capacity || state->closed) {
+        if (timeoutMs == 0 || state->closed || !awaitSharedQueueState(state, &state->nonFull, deadline)) {
+            if (state->size < state->capacity && !state->closed) {
+                break;
+            }
+            pthread_mutex_unlock(&state->mutex);
+            return false;
+        }
+    }
+
+    memcpy(queue->data + state->tail * state->itemSize, item, state->itemSize);
+    state->tail = state->tail + 1 >= state->capacity ? 0 : state->tail + 1;
+    state->size += 1;
+
+    pthread_cond_signal(&state->nonEmpty);
+    pthread_mutex_unlock(&state->mutex);
+    return true;
+}
+
+static void queueProfile(SharedMemoryQueue *queue, const char *name) {
+    // the lock profiler is process local
+}
+
+static void queueClose(SharedMemoryQueue *queue) {
+    SharedQueueState *state = queue->state;
+    lockSharedQueueState(state);
+    state->closed = true;
+    pthread_cond_broadcast(&state->nonEmpty);
+    pthread_cond_broadcast(&state->nonFull);
+    pthread_mutex_unlock(&state->mutex);
+}
+
+static bool queueIsClosed(SharedMemoryQueue *queue) {
+    SharedQueueState *state = queue->state;
+    lockSharedQueueState(state);
+    bool closed = state->closed;
+    pthread_mutex_unlock(&state->mutex);
+    return closed;
+}
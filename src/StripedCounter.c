@@ -0,0 +1,89 @@
+#include "StripedCounter.h"
+#include "ThreadLocal.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CACHE_LINE_SIZE 64
+#define STRIPED_COUNTER_MAX_CELLS 64
+
+/**
+ * A counter cell, padded to a cache line to avoid false sharing.
+ */
+struct CounterCell {
+    _Alignas(CACHE_LINE_SIZE) long long value;
+};
+
+struct StripedCounter {
+    size_t mask;
+    struct CounterCell cells[];
+};
+
+/* the probe of a thread, shared by all the striped counters */
+static ThreadLocal threadProbe = THREAD_LOCAL_INITIALIZER;
+static size_t nextProbe = 0;
+
+static void *newThreadProbe(void *arg) {
+    // store probe + 1, so that the probe 0 is not NULL
+    return (void *) (uintptr_t) (atomic_fetch_add(&nextProbe, 1) + 1);
+}
+
+/**
+ * Get the probe of the current thread. Probes are assigned round-robin, so threads spread evenly over the cells.
+ *
+ * @return the probe.
+ */
+inline static size_t getThreadProbe() {
+    void *probe = getThreadLocal(&threadProbe);
+    if (probe == NULL) {
+        probe = computeIfAbsentThreadLocal(&threadProbe, newThreadProbe, NULL, NULL);
+    }
+    return (size_t) (uintptr_t) probe - 1;
+}
+
+StripedCounter *newStripedCounter() {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t cells = 1;
+    while (cells < (size_t) processors && cells < STRIPED_COUNTER_MAX_CELLS) {
+        cells <<= 1;
+    }
+
+    StripedCounter *counter = aligned_alloc(CACHE_LINE_SIZE,
+                                            sizeof(StripedCounter) + sizeof(struct CounterCell) * cells);
+    if (counter == NULL) {
+        return NULL;
+    }
+
+    counter->mask = cells - 1;
+    for (size_t i = 0; i < cells; ++i) {
+        atomic_init(&counter->cells[i].value, 0);
+    }
+    return counter;
+}
+
+void freeStripedCounter(StripedCounter *counter) {
+    free(counter);
+}
+
+void addStripedCounter(StripedCounter *counter, long long x) {
+    struct CounterCell *cell = &counter->cells[getThreadProbe() & counter->mask];
+    atomic_fetch_add_explicit(&cell->value, x, memory_order_relaxed);
+}
+
+long long sumStripedCounter(StripedCounter *counter) {
+    long long sum = 0;
+    for (size_t i = 0; i <= counter->mask; ++i) {
+        sum += atomic_load_explicit(&counter->cells[i].value, memory_order_relaxed);
+    }
+    return sum;
+}
+
+long long sumThenResetStripedCounter(StripedCounter *counter) {
+    long long sum = 0;
+    for (size_t i = 0; i <= counter->mask; ++i) {
+        sum += atomic_exchange_explicit(&counter->cells[i].value, 0, memory_order_relaxed);
+    }
+    return sum;
+}
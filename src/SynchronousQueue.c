@@ -0,0 +1,324 @@
+#include "SynchronousQueue.h"
+#include "ReentrantLock.h"
+#include "Condition.h"
+#include "LockProfiler.h"
+#include "ThreadLocal.h"
+
+#include <malloc.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The number of checks of a waiter before it parks, on a machine of several processors.
+ */
+#define SPIN_COUNT 2048
+
+enum HandoffState {
+    HANDOFF_WAITING,
+    HANDOFF_MATCHED,
+    HANDOFF_CANCELLED,
+    HANDOFF_CLOSED
+};
+
+/**
+ * A waiting offer or poll, on the stack of the waiting thread. The peer copies the item from / to `item`, then
+ * sets the state.
+ */
+typedef struct HandoffNode {
+    struct HandoffNode *next;
+    void *item;
+    bool isData;
+    int state;
+    bool parked;
+    ConditionWaiter *waiter;
+} HandoffNode;
+
+/**
+ * A Synchronous BlockingQueue implementation, a dual queue: the waiting nodes are all offers or all polls, and an
+ * operation of the other kind matches the first of them.
+ */
+typedef struct SynchronousQueue {
+    BlockingQueue parent;
+
+    ReentrantLock *lock;
+
+    /* no thread waits on it, it notifies the registered waiters when an offer starts waiting */
+    Condition *nonEmpty;
+
+    HandoffNode *head;
+    HandoffNode *tail;
+    size_t itemSize;
+    int spins;
+    bool closed;
+} SynchronousQueue;
+
+/* member functions */
+static void queueFree(SynchronousQueue *queue);
+
+static bool queuePoll(SynchronousQueue *queue, void *item, long timeoutMs);
+
+static bool queueOffer(SynchronousQueue *queue, void *item, long timeoutMs);
+
+static void queueProfile(SynchronousQueue *queue, const char *name);
+
+static bool queueRegisterWaiter(SynchronousQueue *queue, ConditionWaiter *waiter);
+
+static void queueUnregisterWaiter(SynchronousQueue *queue, ConditionWaiter *waiter);
+
+static void queueClose(SynchronousQueue *queue);
+
+static bool queueIsClosed(SynchronousQueue *queue);
+
+/**
+ * The waiter which parks the current thread, shared by all the synchronous queues.
+ */
+static ThreadLocal threadWaiter = THREAD_LOCAL_INITIALIZER;
+
+static void *newWaiterTL(void *arg) {
+    return newConditionWaiter();
+}
+
+static void freeWaiterTL(void *arg) {
+    freeConditionWaiter(arg);
+}
+
+inline static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+BlockingQueue *newSynchronousQueue(size_t capacity, size_t itemSize) {
+    if (itemSize == 0) {
+        return NULL;
+    }
+
+    SynchronousQueue *queue = calloc(1, sizeof(SynchronousQueue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    // member function binding
+    BlockingQueue parent = {
+            .offer = (bool (*)(struct BlockingQueue *, void *, long)) queueOffer,
+            .free = (void (*)(struct BlockingQueue *)) queueFree,
+            .poll = (bool (*)(struct BlockingQueue *, void *, long)) queuePoll,
+            .profile = (void (*)(struct BlockingQueue *, const char *)) queueProfile,
+            .registerWaiter = (bool (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueRegisterWaiter,
+            .unregisterWaiter = (void (*)(struct BlockingQueue *, struct ConditionWaiter *)) queueUnregisterWaiter,
+            .close = (void (*)(struct BlockingQueue *)) queueClose,
+            .isClosed = (bool (*)(struct BlockingQueue *)) queueIsClosed
+    };
+    memcpy(&queue->parent, &parent, sizeof(BlockingQueue));
+
+    queue->itemSize = itemSize;
+    // spinning only helps if the peer runs on another processor meanwhile
+    queue->spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_COUNT : 0;
+
+    queue->lock = newReentrantLock();
+    if (queue->lock == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    queue->nonEmpty = newCondition(queue->lock);
+    if (queue->nonEmpty == NULL) {
+        queueFree(queue);
+        return NULL;
+    }
+
+    return &queue->parent;
+}
+
+static void queueFree(SynchronousQueue *queue) {
+    if (queue->nonEmpty) {
+        freeCondition(queue->nonEmpty);
+    }
+    if (queue->lock) {
+        freeReentrantLock(queue->lock);
+    }
+    free(queue);
+}
+
+/**
+ * Complete a waiting node, and wake its thread only if it parked. The state is stored before `parked` is loaded,
+ * and the waiter stores `parked` before it loads the state, so one of them sees the other.
+ */
+inline static void completeNode(HandoffNode *node, enum HandoffState state) {
+    atomic_store(&node->state, state);
+    if (atomic_load(&node->parked)) {
+        notifyConditionWaiter(node->waiter);
+    }
+}
+
+/**
+ * Take the first waiting node if it is of the other kind. The lock must be held.
+ */
+inline static HandoffNode *matchNode(SynchronousQueue *queue, bool isData) {
+    HandoffNode *node = queue->head;
+    if (node == NULL || node->isData == isData) {
+        return NULL;
+    }
+    queue->head = node->next;
+    if (queue->head == NULL) {
+        queue->tail = NULL;
+    }
+    return node;
+}
+
+inline static void unlinkNode(SynchronousQueue *queue, HandoffNode *node) {
+    HandoffNode *prev = NULL;
+    for (HandoffNode *current = queue->head; current != NULL; prev = current, current = current->next) {
+        if (current == node) {
+            if (prev == NULL) {
+                queue->head = node->next;
+            } else {
+                prev->next = node->next;
+            }
+            if (queue->tail == node) {
+                queue->tail = prev;
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * Append a node for the current thread, and wait until a peer completes it, the queue is closed or timeout. The
+ * lock must be held, and is released.
+ *
+ * @return return true if matched.
+ */
+static bool awaitNode(SynchronousQueue *queue, void *item, bool isData, long timeoutMs) {
+    ConditionWaiter *waiter = computeIfAbsentThreadLocal(&threadWaiter, newWaiterTL, NULL, freeWaiterTL);
+    if (waiter == NULL) {
+        unlockReentrantLock(queue->lock);
+        return false;
+    }
+
+    HandoffNode node = {.next = NULL, .item = item, .isData = isData, .waiter = waiter};
+    atomic_init(&node.state, HANDOFF_WAITING);
+    atomic_init(&node.parked, false);
+    if (queue->tail == NULL) {
+        queue->head = &node;
+    } else {
+        queue->tail->next = &node;
+    }
+    queue->tail = &node;
+    if (isData) {
+        signalCondition(queue->nonEmpty);
+    }
+    unlockReentrantLock(queue->lock);
+
+    for (int i = 0; i < queue->spins && atomic_load_explicit(&node.state, memory_order_acquire) == HANDOFF_WAITING;
+         ++i) {
+        cpuRelax();
+    }
+
+    if (atomic_load(&node.state) == HANDOFF_WAITING) {
+        // a notification after the reset makes the await return at once
+        resetConditionWaiter(waiter);
+        atomic_store(&node.parked, true);
+        while (atomic_load(&node.state) == HANDOFF_WAITING && timeoutMs != 0) {
+            timeoutMs = awaitConditionWaiter(waiter, timeoutMs);
+        }
+    }
+
+    // the peer completes the node under the lock, so a cancel under the lock cannot race with it, and once the lock
+    // is taken the peer no longer touches the node
+    lockReentrantLock(queue->lock);
+    int state = HANDOFF_WAITING;
+    if (atomic_compare_exchange_strong(&node.state, &state, HANDOFF_CANCELLED)) {
+        unlinkNode(queue, &node);
+    }
+    unlockReentrantLock(queue->lock);
+    return atomic_load_explicit(&node.state, memory_order_acquire) == HANDOFF_MATCHED;
+}
+
+static bool queuePoll(SynchronousQueue *queue, void *item, long timeoutMs) {
+    lockReentrantLock(queue->lock);
+    if (queue->closed) {
+        unlockReentrantLock(queue->lock);
+        return false;
+    }
+
+    HandoffNode *node = matchNode(queue, false);
+    if (node != NULL) {
+        memcpy(item, node->item, queue->itemSize);
+        completeNode(node, HANDOFF_MATCHED);
+        unlockReentrantLock(queue->lock);
+        return true;
+    }
+
+    if (timeoutMs == 0) {
+        unlockReentrantLock(queue->lock);
+        return false;
+    }
+    return awaitNode(queue, item, false, timeoutMs);
+}
+
+static bool queueOffer(SynchronousQueue *queue, void *item, long timeoutMs) {
+    lockReentrantLock(queue->lock);
+    if (queue->closed) {
+        unlockReentrantLock(queue->lock);
+        return false;
+    }
+
+    HandoffNode *node = matchNode(queue, true);
+    if (node != NULL) {
+        memcpy(node->item, item, queue->itemSize);
+        completeNode(node, HANDOFF_MATCHED);
+        unlockReentrantLock(queue->lock);
+        return true;
+    }
+
+    if (timeoutMs == 0) {
+        unlockReentrantLock(queue->lock);
+        return false;
+    }
+    return awaitNode(queue, item, true, timeoutMs);
+}
+
+static void queueProfile(SynchronousQueue *queue, const char *name) {
+    char buffer[LOCK_PROFILE_NAME_MAX];
+    snprintf(buffer, sizeof(buffer), "%s.lock", name);
+    profileReentrantLock(queue->lock, buffer);
+    snprintf(buffer, sizeof(buffer), "%s.nonEmpty", name);
+    profileCondition(queue->nonEmpty, buffer);
+}
+
+static bool queueRegisterWaiter(SynchronousQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->lock);
+    bool registered = registerConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->lock);
+    return registered;
+}
+
+static void queueUnregisterWaiter(SynchronousQueue *queue, ConditionWaiter *waiter) {
+    lockReentrantLock(queue->lock);
+    unregisterConditionWaiter(queue->nonEmpty, waiter);
+    unlockReentrantLock(queue->lock);
+}
+
+static void queueClose(SynchronousQueue *queue) {
+    lockReentrantLock(queue->lock);
+    queue->closed = true;
+    while (queue->head != NULL) {
+        HandoffNode *node = queue->head;
+        queue->head = node->next;
+        completeNode(node, HANDOFF_CLOSED);
+    }
+    queue->tail = NULL;
+    signalAllCondition(queue->nonEmpty);
+    unlockReentrantLock(queue->lock);
+}
+
+static bool queueIsClosed(SynchronousQueue *queue) {
+    lockReentrantLock(queue->lock);
+    bool closed = queue->closed;
+    unlockReentrantLock(queue->lock);
+    return closed;
+}
@@ -4,75 +4,149 @@
 #include <malloc.h>
 #include <stdio.h>
 
-struct ThreadLocalValue {
-    ThreadLocal *key;
+_Thread_local struct ThreadLocalEntry threadLocalInlineEntries[THREAD_LOCAL_INLINE_SLOTS];
+static _Thread_local struct ThreadLocalEntry *overflowEntries = NULL;
+static _Thread_local size_t overflowCapacity = 0;
+static _Thread_local bool exitRegistered = false;
+
+/* process-wide slot allocator */
+static pthread_mutex_t slotMutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t *freeSlots = NULL;
+static size_t freeSlotsSize = 0;
+static size_t freeSlotsCapacity = 0;
+static size_t nextSlot = 0;
+static unsigned long long nextGeneration = 1;
+
+/* the only pthread key, used to run the deleters at thread exit */
+static pthread_once_t exitKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t exitKey;
+static bool exitKeyCreated = false;
+
+/**
+ * Release the value of the entry with its deleter.
+ *
+ * @param entry the thread local entry.
+ */
+inline static void releaseThreadLocalEntry(struct ThreadLocalEntry *entry) {
+    void *item = entry->item;
+    void (*deleter)(void *) = entry->deleter;
+
+    entry->generation = 0;
+    entry->item = NULL;
+    entry->deleter = NULL;
+
+    if (item != NULL && deleter != NULL) {
+        deleter(item);
+    }
+}
 
-    void *item;
+static void releaseThreadEntries(void *ptr) {
+    // the deleters may set thread local variables again, which registers the exit handler again
+    exitRegistered = false;
 
-    void (*deleter)(void *);
-};
+    for (size_t i = 0; i < THREAD_LOCAL_INLINE_SLOTS; ++i) {
+        releaseThreadLocalEntry(&threadLocalInlineEntries[i]);
+    }
+    for (size_t i = 0; i < overflowCapacity; ++i) {
+        releaseThreadLocalEntry(&overflowEntries[i]);
+    }
 
+    if (!exitRegistered) {
+        free(overflowEntries);
+        overflowEntries = NULL;
+        overflowCapacity = 0;
+    }
+}
+
+static void createExitKey() {
+    exitKeyCreated = pthread_key_create(&exitKey, releaseThreadEntries) == 0;
+}
 
-static void freeThreadLocalValue(void *ptr) {
-    if (ptr == NULL) {
-        return;
+/**
+ * Make sure the deleters of the current thread run at thread exit.
+ *
+ * @return return true if success.
+ */
+inline static bool registerThreadExitIfAbsent() {
+    if (exitRegistered) {
+        return true;
     }
 
-    struct ThreadLocalValue *value = ptr;
-    if (value->item) {
-        if (value->deleter) {
-            value->deleter(value->item);
-        }
+    pthread_once(&exitKeyOnce, createExitKey);
+    if (!exitKeyCreated || pthread_setspecific(exitKey, (void *) 1)) {
+        return false;
     }
-    free(value);
+    exitRegistered = true;
+    return true;
 }
 
 inline static bool createThreadStorageIfAbsent(ThreadLocal *threadLocal) {
     if (!atomic_load(&threadLocal->initialized)) {
         pthread_mutex_lock(&threadLocal->mutex);
         if (!atomic_load(&threadLocal->initialized)) {
-            if (pthread_key_create(&threadLocal->key, freeThreadLocalValue)) {
-                pthread_mutex_unlock(&threadLocal->mutex);
-                return false;
-            }
+            // read without the lock by the inline getThreadLocal
+            pthread_mutex_lock(&slotMutex);
+            atomic_store_explicit(&threadLocal->slot, freeSlotsSize > 0 ? freeSlots[--freeSlotsSize] : nextSlot++,
+                                  memory_order_relaxed);
+            atomic_store_explicit(&threadLocal->generation, nextGeneration++, memory_order_relaxed);
+            pthread_mutex_unlock(&slotMutex);
+            atomic_store(&threadLocal->initialized, true);
         }
-        atomic_store(&threadLocal->initialized, true);
         pthread_mutex_unlock(&threadLocal->mutex);
     }
     return true;
 }
 
-inline static struct ThreadLocalValue *computeIfAbsentThreadLocalValue(ThreadLocal *threadLocal) {
-    struct ThreadLocalValue *value = pthread_getspecific(threadLocal->key);
-    if (value == NULL) {
-        value = calloc(1, sizeof(struct ThreadLocalValue));
-        if (value == NULL) {
-            return NULL;
-        }
-
-        if (pthread_setspecific(threadLocal->key, value)) {
-            free(value);
-            return NULL;
-        }
-        value->key = threadLocal;
+/**
+ * Find the entry of the slot in the current thread.
+ *
+ * @param slot  the slot id.
+ * @return      the entry (may be NULL if the slot was never used by the current thread).
+ */
+inline static struct ThreadLocalEntry *getThreadLocalEntry(size_t slot) {
+    if (slot < THREAD_LOCAL_INLINE_SLOTS) {
+        return &threadLocalInlineEntries[slot];
     }
-    return value;
+
+    slot -= THREAD_LOCAL_INLINE_SLOTS;
+    return slot < overflowCapacity ? &overflowEntries[slot] : NULL;
 }
 
-inline static bool setThreadLocalFast(ThreadLocal *threadLocal, void *item, void (*deleter)(void *)) {
-    struct ThreadLocalValue *value = computeIfAbsentThreadLocalValue(threadLocal);
-    if (value == NULL) {
+inline static struct ThreadLocalEntry *computeIfAbsentThreadLocalEntry(size_t slot) {
+    struct ThreadLocalEntry *entry = getThreadLocalEntry(slot);
+    if (entry != NULL) {
+        return entry;
+    }
+
+    size_t index = slot - THREAD_LOCAL_INLINE_SLOTS;
+    size_t capacity = overflowCapacity == 0 ? THREAD_LOCAL_INLINE_SLOTS : overflowCapacity;
+    while (capacity <= index) {
+        capacity *= 2;
+    }
+
+    struct ThreadLocalEntry *entries = realloc(overflowEntries, sizeof(struct ThreadLocalEntry) * capacity);
+    if (entries == NULL) {
         return NULL;
     }
+    memset(entries + overflowCapacity, 0, sizeof(struct ThreadLocalEntry) * (capacity - overflowCapacity));
 
-    if (value->item != NULL) {
-        if (value->deleter != NULL) {
-            value->deleter(value->item);
-        }
+    overflowEntries = entries;
+    overflowCapacity = capacity;
+    return &overflowEntries[index];
+}
+
+inline static bool setThreadLocalFast(ThreadLocal *threadLocal, void *item, void (*deleter)(void *)) {
+    struct ThreadLocalEntry *entry = computeIfAbsentThreadLocalEntry(threadLocal->slot);
+    if (entry == NULL || !registerThreadExitIfAbsent()) {
+        return false;
     }
 
-    value->item = item;
-    value->deleter = deleter;
+    // release the previous value, which may be left by a destroyed thread local variable
+    releaseThreadLocalEntry(entry);
+
+    entry->generation = threadLocal->generation;
+    entry->item = item;
+    entry->deleter = deleter;
     return true;
 }
 
@@ -84,15 +158,15 @@ bool setThreadLocal(ThreadLocal *threadLocal, void *item, void (*deleter)(void *
 }
 
 inline static void *getThreadLocalFast(ThreadLocal *threadLocal) {
-    struct ThreadLocalValue *value = computeIfAbsentThreadLocalValue(threadLocal);
-    if (value == NULL) {
+    struct ThreadLocalEntry *entry = getThreadLocalEntry(threadLocal->slot);
+    if (entry == NULL || entry->generation != threadLocal->generation) {
         return NULL;
     }
-    return value->item;
+    return entry->item;
 }
 
-void *getThreadLocal(ThreadLocal *threadLocal) {
-    if (!createThreadStorageIfAbsent(threadLocal)) {
+void *getOverflowThreadLocal(ThreadLocal *threadLocal) {
+    if (!atomic_load_explicit(&threadLocal->initialized, memory_order_acquire)) {
         return NULL;
     }
     return getThreadLocalFast(threadLocal);
@@ -121,17 +195,38 @@ computeIfAbsentThreadLocal(ThreadLocal *threadLocal, void *(*builder)(void *), v
     if (!setThreadLocalFast(threadLocal, item, deleter)) {
         if (deleter) {
             deleter(item);
-            return NULL;
         }
+        return NULL;
     }
     return item;
 }
 
 void destroyThreadLocal(ThreadLocal *threadLocal) {
-    bool initialized = true;
-    if (atomic_compare_exchange_strong(&threadLocal->initialized, &initialized, false)) {
-        pthread_key_delete(threadLocal->key);
-        threadLocal->key = -1;
+    pthread_mutex_lock(&threadLocal->mutex);
+    if (atomic_load(&threadLocal->initialized)) {
+        atomic_store(&threadLocal->initialized, false);
+
+        struct ThreadLocalEntry *entry = getThreadLocalEntry(threadLocal->slot);
+        if (entry != NULL && entry->generation == threadLocal->generation) {
+            releaseThreadLocalEntry(entry);
+        }
+
+        pthread_mutex_lock(&slotMutex);
+        if (freeSlotsSize == freeSlotsCapacity) {
+            size_t capacity = freeSlotsCapacity == 0 ? THREAD_LOCAL_INLINE_SLOTS : freeSlotsCapacity * 2;
+            size_t *slots = realloc(freeSlots, sizeof(size_t) * capacity);
+            if (slots != NULL) {
+                freeSlots = slots;
+                freeSlotsCapacity = capacity;
+            }
+        }
+        // the slot is leaked if the free list cannot grow
+        if (freeSlotsSize < freeSlotsCapacity) {
+            freeSlots[freeSlotsSize++] = threadLocal->slot;
+        }
+        pthread_mutex_unlock(&slotMutex);
+        // the values left in other threads no longer match
+        atomic_store_explicit(&threadLocal->generation, 0, memory_order_relaxed);
     }
+    pthread_mutex_unlock(&threadLocal->mutex);
 }
-
@@ -0,0 +1,68 @@
+#include "WorkerInternal.h"
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/**
+ * The worker of the current thread, read by every currentWorker, so a plain thread local rather than a ThreadLocal.
+ */
+static _Thread_local Worker *current = NULL;
+
+void startWorker(Worker *worker, size_t id, const WorkerHooks *hooks) {
+    worker->id = id;
+    worker->data = NULL;
+    worker->hooks = hooks;
+    worker->arena = NULL;
+    worker->arenaSize = hooks != NULL && hooks->arenaSize != 0 ? hooks->arenaSize : WORKER_ARENA_DEFAULT_SIZE;
+    worker->arenaUsed = 0;
+    current = worker;
+
+    if (hooks != NULL && hooks->onStart != NULL) {
+        hooks->onStart(worker, hooks->arg);
+    }
+}
+
+void stopWorker(Worker *worker) {
+    const WorkerHooks *hooks = worker->hooks;
+    if (hooks != NULL && hooks->onStop != NULL) {
+        hooks->onStop(worker, hooks->arg);
+    }
+    free(worker->arena);
+    worker->arena = NULL;
+    current = NULL;
+}
+
+Worker *currentWorker() {
+    return current;
+}
+
+size_t getWorkerId(Worker *worker) {
+    return worker->id;
+}
+
+void *getWorkerData(Worker *worker) {
+    return worker->data;
+}
+
+void setWorkerData(Worker *worker, void *data) {
+    worker->data = data;
+}
+
+void *allocateWorkerArena(Worker *worker, size_t size) {
+    if (worker->arena == NULL) {
+        worker->arena = aligned_alloc(alignof(max_align_t), (worker->arenaSize + alignof(max_align_t) - 1)
+                                                            / alignof(max_align_t) * alignof(max_align_t));
+        if (worker->arena == NULL) {
+            return NULL;
+        }
+    }
+
+    // every allocation starts aligned for any type
+    size_t offset = (worker->arenaUsed + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+    if (offset > worker->arenaSize || size > worker->arenaSize - offset) {
+        return NULL;
+    }
+    worker->arenaUsed = offset + size;
+    return worker->arena + offset;
+}
@@ -0,0 +1,42 @@
+#ifndef ZUTIL_CONCURRENT_WORKERINTERNAL_H
+#define ZUTIL_CONCURRENT_WORKERINTERNAL_H
+
+#include "Worker.h"
+#include "ExecutorService.h"
+
+/*
+ * The worker side of Worker.h, for the executors: a worker is embedded in the context of its thread, started on the
+ * thread before the first task and stopped after the last one.
+ */
+
+struct Worker {
+    size_t id;
+    void *data;
+    const WorkerHooks *hooks;
+
+    char *arena;
+    size_t arenaSize;
+    size_t arenaUsed;
+};
+
+/**
+ * Make the worker the current one of the thread, and call onStart.
+ *
+ * @param hooks the hooks of the executor, may be NULL.
+ */
+void startWorker(Worker *worker, size_t id, const WorkerHooks *hooks);
+
+/**
+ * Call onStop, free the arena, and forget the current worker of the thread.
+ */
+void stopWorker(Worker *worker);
+
+/**
+ * Run a task on the worker, then reset the arena.
+ */
+inline static void runWorkerTask(Worker *worker, Runnable *task) {
+    task->fn(task->arg);
+    worker->arenaUsed = 0;
+}
+
+#endif //ZUTIL_CONCURRENT_WORKERINTERNAL_H
@@ -0,0 +1,283 @@
+#include "benchmark.h"
+#include "ArrayBlockingQueue.h"
+#include "LinkedBlockingQueue.h"
+#include "PriorityBlockingQueue.h"
+#include "DelayQueue.h"
+#include "SynchronousQueue.h"
+#include "SegmentedBlockingQueue.h"
+#include "ShardedBlockingQueue.h"
+#include "TypedBlockingQueue.h"
+#include "ExecutorService.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HISTOGRAM_SUB_HALF (1 << (HISTOGRAM_SUB_BITS - 1))
+
+void resetHistogram(Histogram *histogram) {
+    memset(histogram, 0, sizeof(Histogram));
+}
+
+inline static size_t histogramIndex(uint64_t value) {
+    if (value < (1 << HISTOGRAM_SUB_BITS)) {
+        return value;
+    }
+    int shift = 63 - __builtin_clzll(value) - (HISTOGRAM_SUB_BITS - 1);
+    return (size_t) shift * HISTOGRAM_SUB_HALF + (value >> shift);
+}
+
+inline static uint64_t histogramValue(size_t index) {
+    if (index < (1 << HISTOGRAM_SUB_BITS)) {
+        return index;
+    }
+    int shift = (int) (index / HISTOGRAM_SUB_HALF) - 1;
+    uint64_t mantissa = index % HISTOGRAM_SUB_HALF + HISTOGRAM_SUB_HALF;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void recordHistogram(Histogram *histogram, uint64_t value) {
+    histogram->counts[histogramIndex(value)] += 1;
+    histogram->count += 1;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+void mergeHistogram(Histogram *to, const Histogram *from) {
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        to->counts[i] += from->counts[i];
+    }
+    to->count += from->count;
+    if (from->max > to->max) {
+        to->max = from->max;
+    }
+}
+
+uint64_t percentileHistogram(const Histogram *histogram, double percentile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t) (percentile / 100.0 * (double) histogram->count + 0.5);
+    rank = rank == 0 ? 1 : rank;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t value = histogramValue(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+uint64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+size_t parseSizeList(const char *text, size_t *values, size_t max) {
+    size_t size = 0;
+    while (*text != '\0') {
+        char *end;
+        unsigned long long value = strtoull(text, &end, 10);
+        // a count of 0 would leave the threads of the other side waiting forever
+        if (end == text || value == 0 || size == max || (*end != ',' && *end != '\0')) {
+            return 0;
+        }
+        values[size++] = (size_t) value;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return size;
+}
+
+size_t parseNameList(char *text, const char **names, size_t max) {
+    size_t size = 0;
+    char *save;
+    for (char *name = strtok_r(text, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        if (size == max) {
+            return 0;
+        }
+        names[size++] = name;
+    }
+    return size;
+}
+
+DEFINE_BLOCKING_QUEUE(U64BlockingQueue, uint64_t)
+
+DEFINE_BLOCKING_QUEUE(RunnableBlockingQueue, Runnable)
+
+/**
+ * The typed queue through its BlockingQueue wrapper, for 8 byte items in the queue benchmark and Runnable items in
+ * the executor benchmark. Other item sizes are not supported.
+ */
+static BlockingQueue *newTypedBlockingQueue(size_t capacity, size_t itemSize) {
+    if (itemSize == sizeof(uint64_t)) {
+        U64BlockingQueue *queue = newU64BlockingQueue(capacity);
+        return queue == NULL ? NULL : &queue->parent;
+    }
+    if (itemSize == sizeof(Runnable)) {
+        RunnableBlockingQueue *queue = newRunnableBlockingQueue(capacity);
+        return queue == NULL ? NULL : &queue->parent;
+    }
+    return NULL;
+}
+
+/**
+ * Items start with the clock of their offer, or 0, see benchmarkQueue.c.
+ */
+static int compareStamp(const void *a, const void *b) {
+    uint64_t x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * The stamp as a deadline, which expired at the offer, so the delay queue costs its heap and its clock reads.
+ */
+static uint64_t stampDeadline(const void *item) {
+    uint64_t stamp;
+    memcpy(&stamp, item, sizeof(stamp));
+    return stamp;
+}
+
+DEFINE_PRIORITY_BLOCKING_QUEUE_BUILDER(newStampPriorityQueue, compareStamp)
+
+DEFINE_DELAY_QUEUE_BUILDER(newStampDelayQueue, stampDeadline)
+
+const BenchmarkQueue BENCHMARK_QUEUES[] = {
+        {"array",       newArrayBlockingQueue,     false, false},
+        {"linked",      newLinkedBlockingQueue,    false, false},
+        {"segmented",   newSegmentedBlockingQueue, false, false},
+        {"sharded",     newShardedBlockingQueue,   false, false},
+        {"typed",       newTypedBlockingQueue,     false, false},
+        {"priority",    newStampPriorityQueue,     false, false},
+        {"delay",       newStampDelayQueue,        true, false},
+        {"synchronous", newSynchronousQueue,       false, true},
+};
+
+const size_t BENCHMARK_QUEUE_SIZE = sizeof(BENCHMARK_QUEUES) / sizeof(BENCHMARK_QUEUES[0]);
+
+const BenchmarkQueue *findBenchmarkQueue(const char *name) {
+    for (size_t i = 0; i < BENCHMARK_QUEUE_SIZE; ++i) {
+        if (strcmp(BENCHMARK_QUEUES[i].name, name) == 0) {
+            return &BENCHMARK_QUEUES[i];
+        }
+    }
+    return NULL;
+}
+
+bool parseBenchmarkFormat(const char *text, BenchmarkFormat *format) {
+    static const char *const names[] = {"text", "csv", "json"};
+    for (int i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (strcmp(text, names[i]) == 0) {
+            *format = (BenchmarkFormat) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * The first column is a name and left aligned, the others are right aligned.
+ */
+inline static void printTextColumn(FILE *out, size_t index, const char *column, const char *value) {
+    int width = (int) strlen(column);
+    if (index == 0) {
+        fprintf(out, "%-*s", width < 22 ? 22 : width, value);
+    } else {
+        fprintf(out, " %*s", width < 12 ? 12 : width, value);
+    }
+}
+
+void beginBenchmarkReport(BenchmarkReport *report, FILE *out, BenchmarkFormat format,
+                          const char *const *columns, size_t columnSize) {
+    report->out = out;
+    report->format = format;
+    report->columns = columns;
+    report->columnSize = columnSize;
+    report->rows = 0;
+
+    switch (format) {
+        case BENCHMARK_FORMAT_TEXT:
+            for (size_t i = 0; i < columnSize; ++i) {
+                printTextColumn(out, i, columns[i], columns[i]);
+            }
+            fprintf(out, "\n");
+            break;
+        case BENCHMARK_FORMAT_CSV:
+            for (size_t i = 0; i < columnSize; ++i) {
+                fprintf(out, i == 0 ? "%s" : ",%s", columns[i]);
+            }
+            fprintf(out, "\n");
+            break;
+        case BENCHMARK_FORMAT_JSON:
+            fprintf(out, "[");
+            break;
+    }
+    fflush(out);
+}
+
+/**
+ * @return true if the value can be written as a JSON number, strtod also parses nan and inf which JSON has not.
+ */
+inline static bool isNumber(const char *value) {
+    char *end;
+    double number = strtod(value, &end);
+    return end != value && *end == '\0' && isfinite(number);
+}
+
+void addBenchmarkReportRow(BenchmarkReport *report, const char *formats, ...) {
+    char line[1024];
+    va_list args;
+    va_start(args, formats);
+    vsnprintf(line, sizeof(line), formats, args);
+    va_end(args);
+
+    FILE *out = report->out;
+    if (report->format == BENCHMARK_FORMAT_JSON) {
+        fprintf(out, report->rows == 0 ? "\n  {" : ",\n  {");
+    }
+
+    char *value = line;
+    for (size_t i = 0; i < report->columnSize; ++i) {
+        char *end = strchr(value, '|');
+        if (end != NULL) {
+            *end = '\0';
+        }
+
+        switch (report->format) {
+            case BENCHMARK_FORMAT_TEXT:
+                printTextColumn(out, i, report->columns[i], value);
+                break;
+            case BENCHMARK_FORMAT_CSV:
+                fprintf(out, i == 0 ? "%s" : ",%s", value);
+                break;
+            case BENCHMARK_FORMAT_JSON:
+                fprintf(out, isNumber(value) ? "%s\"%s\": %s" : "%s\"%s\": \"%s\"", i == 0 ? "" : ", ",
+                        report->columns[i], value);
+                break;
+        }
+        value = end != NULL ? end + 1 : value + strlen(value);
+    }
+
+    if (report->format == BENCHMARK_FORMAT_JSON) {
+        fprintf(out, "}");
+    } else {
+        fprintf(out, "\n");
+    }
+    report->rows += 1;
+    fflush(out);
+}
+
+void endBenchmarkReport(BenchmarkReport *report) {
+    if (report->format == BENCHMARK_FORMAT_JSON) {
+        fprintf(report->out, report->rows == 0 ? "]\n" : "\n]\n");
+    }
+    fflush(report->out);
+}
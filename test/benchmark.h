@@ -0,0 +1,147 @@
+#ifndef ZUTIL_CONCURRENT_BENCHMARK_H
+#define ZUTIL_CONCURRENT_BENCHMARK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "BlockingQueue.h"
+
+/**
+ * An HDR style latency histogram: values below 2^HISTOGRAM_SUB_BITS are counted exactly, and every power of two
+ * above is split into 2^(HISTOGRAM_SUB_BITS - 1) linear buckets, so a recorded value is off by less than 1/64.
+ */
+#define HISTOGRAM_SUB_BITS 7
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 2) << (HISTOGRAM_SUB_BITS - 1))
+
+typedef struct Histogram {
+    uint64_t count;
+    uint64_t max;
+    uint64_t counts[HISTOGRAM_BUCKETS];
+} Histogram;
+
+/**
+ * Reset the histogram to empty.
+ *
+ * @param histogram the histogram.
+ */
+void resetHistogram(Histogram *histogram);
+
+/**
+ * Record a value, usually a latency in nanoseconds.
+ *
+ * @param histogram the histogram.
+ * @param value     the value.
+ */
+void recordHistogram(Histogram *histogram, uint64_t value);
+
+/**
+ * Add all the values of `from` into `to`.
+ *
+ * @param to    the target histogram.
+ * @param from  the source histogram.
+ */
+void mergeHistogram(Histogram *to, const Histogram *from);
+
+/**
+ * Get the value at a percentile. The highest value equivalent to the bucket is returned.
+ *
+ * @param histogram     the histogram.
+ * @param percentile    the percentile in [0, 100].
+ * @return              the value, or 0 if the histogram is empty.
+ */
+uint64_t percentileHistogram(const Histogram *histogram, double percentile);
+
+/**
+ * @return the monotonic clock in nanoseconds.
+ */
+uint64_t nowNanos();
+
+/**
+ * Parse a comma separated list of positive sizes, e.g. "1,2,4,16".
+ *
+ * @param text      the list.
+ * @param values    the parsed values.
+ * @param max       the capacity of values.
+ * @return          the number of values, or 0 if the list is malformed or has a 0.
+ */
+size_t parseSizeList(const char *text, size_t *values, size_t max);
+
+/**
+ * Split a comma separated list of names in place.
+ *
+ * @param text      the list, modified.
+ * @param names     the names.
+ * @param max       the capacity of names.
+ * @return          the number of names, or 0 if there are more than max.
+ */
+size_t parseNameList(char *text, const char **names, size_t max);
+
+/**
+ * The blocking queue implementations which can be benchmarked, selected by name.
+ */
+typedef struct BenchmarkQueue {
+    const char *name;
+
+    BlockingQueue *(*builder)(size_t capacity, size_t itemSize);
+
+    /**
+     * The queue reads the offer clock at the start of its items, see benchmarkQueue.c, so it cannot hold the
+     * Runnables of an executor.
+     */
+    bool stamped;
+
+    /**
+     * The queue holds no item, an offer succeeds only when a poll is waiting.
+     */
+    bool handoff;
+} BenchmarkQueue;
+
+extern const BenchmarkQueue BENCHMARK_QUEUES[];
+extern const size_t BENCHMARK_QUEUE_SIZE;
+
+/**
+ * @return the queue implementation with the name, or NULL if not found.
+ */
+const BenchmarkQueue *findBenchmarkQueue(const char *name);
+
+typedef enum BenchmarkFormat {
+    BENCHMARK_FORMAT_TEXT,
+    BENCHMARK_FORMAT_CSV,
+    BENCHMARK_FORMAT_JSON,
+} BenchmarkFormat;
+
+/**
+ * Parse "text", "csv" or "json".
+ *
+ * @return return false if the format is unknown.
+ */
+bool parseBenchmarkFormat(const char *text, BenchmarkFormat *format);
+
+/**
+ * A table of results printed as aligned text, CSV with a header line, or a JSON array of objects. Values which
+ * parse as numbers are not quoted in JSON.
+ */
+typedef struct BenchmarkReport {
+    FILE *out;
+    BenchmarkFormat format;
+    const char *const *columns;
+    size_t columnSize;
+    size_t rows;
+} BenchmarkReport;
+
+void beginBenchmarkReport(BenchmarkReport *report, FILE *out, BenchmarkFormat format,
+                          const char *const *columns, size_t columnSize);
+
+/**
+ * Print a row, with one printf style format per column, e.g. "%s|%zu|%.3f" for three columns.
+ *
+ * @param report    the report.
+ * @param formats   the formats of the columns separated by '|'.
+ */
+void addBenchmarkReportRow(BenchmarkReport *report, const char *formats, ...);
+
+void endBenchmarkReport(BenchmarkReport *report);
+
+#endif //ZUTIL_CONCURRENT_BENCHMARK_H
@@ -0,0 +1,87 @@
+#include "ConcurrentHashMap.h"
+#include "FixedThreadPoolExecutor.h"
+#include "LinkedBlockingQueue.h"
+#include "CountDownLatch.h"
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <stdio.h>
+
+static const int MAX_THREADS = 16;
+static const uint64_t KEY_SPACE = 1 << 16;
+static const int OPERATIONS = 1000000;
+
+struct MapBenchmarkContext {
+    CountDownLatch *latch;
+    ConcurrentHashMap *map;
+    int readPercent;
+};
+
+/**
+ * xorshift64, a cheap per-thread random generator.
+ */
+inline static uint64_t nextRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void mapThread(void *arg) {
+    struct MapBenchmarkContext *context = arg;
+    ConcurrentHashMap *map = context->map;
+    uint64_t state = (uint64_t) (uintptr_t) &state | 1;
+
+    for (int i = 0; i < OPERATIONS; ++i) {
+        uint64_t r = nextRandom(&state);
+        uint64_t key = (r >> 8) % KEY_SPACE;
+        int op = (int) (r % 100);
+
+        if (op < context->readPercent) {
+            getU64ConcurrentHashMap(map, key);
+        } else if ((op & 1) == 0) {
+            putU64ConcurrentHashMap(map, key, (void *) (uintptr_t) (key + 1), NULL);
+        } else {
+            removeU64ConcurrentHashMap(map, key);
+        }
+    }
+    decreaseCountDownLatch(context->latch);
+}
+
+static void benchmarkMap(int threads, int readPercent) {
+    ConcurrentHashMap *map = newConcurrentHashMap(16);
+    for (uint64_t key = 0; key < KEY_SPACE; key += 2) {
+        putU64ConcurrentHashMap(map, key, (void *) (uintptr_t) (key + 1), NULL);
+    }
+
+    CountDownLatch *latch = newCountDownLatch(threads);
+    ExecutorService *pool = newFixedThreadPoolExecutor(threads, -1, "map-%d", newLinkedBlockingQueue);
+    struct MapBenchmarkContext context = {.latch = latch, .map = map, .readPercent = readPercent};
+
+    struct timeval s, t;
+    gettimeofday(&s, NULL);
+    for (int i = 0; i < threads; ++i) {
+        pool->submit(pool, mapThread, &context);
+    }
+    awaitCountDownLatch(latch, -1);
+    gettimeofday(&t, NULL);
+
+    double dur = (double) (t.tv_sec - s.tv_sec) * 1000.0 + (double) (t.tv_usec - s.tv_usec) / 1000.0;
+    printf("> threads = %2d, read = %d%%: %f mops\n", threads, readPercent,
+           (double) threads * OPERATIONS / dur / 1000.0);
+
+    pool->free(pool);
+    freeCountDownLatch(latch);
+    freeConcurrentHashMap(map);
+}
+
+void benchmarkConcurrentHashMap() {
+    printf("> concurrent hash map benchmark\n");
+    int readPercents[] = {90, 50};
+    for (int r = 0; r < sizeof(readPercents) / sizeof(int); ++r) {
+        for (int threads = 1; threads <= MAX_THREADS; threads <<= 1) {
+            benchmarkMap(threads, readPercents[r]);
+        }
+    }
+}
@@ -0,0 +1,617 @@
+#include "FixedThreadPoolExecutor.h"
+#include "CachedThreadPoolExecutor.h"
+#include "ScheduledThreadPoolExecutor.h"
+#include "CountDownLatch.h"
+#include "benchmark.h"
+
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_THREAD_COUNTS 16
+#define MAX_NAMES 16
+
+/**
+ * The clock is read once per SUBMIT_SAMPLE submits in the throughput scenario.
+ */
+#define SUBMIT_SAMPLE 64
+
+/**
+ * The number of executors shut down per run in the shutdown scenario.
+ */
+#define SHUTDOWN_SAMPLES 100
+
+static ExecutorService *newFixedExecutor(size_t threads, size_t capacity, BlockingQueueBuilder builder) {
+    return newFixedThreadPoolExecutor(threads, capacity, "bench-%d", builder);
+}
+
+/**
+ * The cached pool queues no task, so it ignores the capacity and the queue: threads bounds its growth.
+ */
+static ExecutorService *newCachedExecutor(size_t threads, size_t capacity, BlockingQueueBuilder builder) {
+    return newCachedThreadPoolExecutor(threads, 60000, "bench-%d");
+}
+
+/**
+ * The scheduled pool used as a plain ExecutorService, a submit goes to its fixed pool without the timing wheel.
+ */
+static ExecutorService *newScheduledExecutor(size_t threads, size_t capacity, BlockingQueueBuilder builder) {
+    ScheduledExecutorService *executor = newScheduledThreadPoolExecutor(threads, capacity, "bench-%d", builder, 1);
+    return executor != NULL ? &executor->parent : NULL;
+}
+
+/**
+ * The executor implementations which can be benchmarked, selected by name with --executor. A handoff executor
+ * accepts a task only when a thread is idle or can be started. An executor which does not use the queue runs once
+ * per scenario, reported with the queue named by QUEUELESS_EXECUTOR_QUEUE.
+ */
+static const struct ExecutorImplementation {
+    const char *name;
+
+    ExecutorService *(*builder)(size_t threads, size_t capacity, BlockingQueueBuilder builder);
+
+    bool handoff;
+
+    bool usesQueue;
+} EXECUTORS[] = {
+        {"fixed",     newFixedExecutor,     false, true},
+        {"cached",    newCachedExecutor,    true,  false},
+        {"scheduled", newScheduledExecutor, false, true},
+};
+
+/**
+ * The queue the executors which do not use the --queue ones hand their tasks over with.
+ */
+#define QUEUELESS_EXECUTOR_QUEUE "synchronous"
+
+struct ExecutorOptions {
+    const struct ExecutorImplementation *executors[MAX_NAMES];
+    size_t executorSize;
+    const BenchmarkQueue *queues[MAX_NAMES];
+    size_t queueSize;
+    const struct Scenario *scenarios[MAX_NAMES];
+    size_t scenarioSize;
+    size_t threads[MAX_THREAD_COUNTS];
+    size_t threadSize;
+    size_t submitters[MAX_THREAD_COUNTS];
+    size_t submitterSize;
+    size_t capacity;
+    size_t tasks;
+    size_t warmup;
+    size_t repetitions;
+    BenchmarkFormat format;
+};
+
+struct ExecutorRun {
+    const struct ExecutorImplementation *implementation;
+    const BenchmarkQueue *queue;
+    const struct ExecutorOptions *options;
+    size_t threads;
+    size_t submitters;
+
+    /* results */
+    Histogram latency;
+    size_t operations;
+    uint64_t elapsed;
+};
+
+/**
+ * A scenario runs once and fills the results of the run, it returns false if the executor cannot be created with
+ * the queue, and the pair is skipped.
+ */
+struct Scenario {
+    const char *name;
+    bool usesSubmitters;
+
+    bool (*run)(struct ExecutorRun *run);
+};
+
+inline static ExecutorService *newExecutor(struct ExecutorRun *run) {
+    return run->implementation->builder(run->threads, run->options->capacity, run->queue->builder);
+}
+
+/**
+ * @return true if a task is only accepted by an idle thread, because nothing buffers it.
+ */
+inline static bool isHandoff(struct ExecutorRun *run) {
+    return run->implementation->handoff || run->queue->handoff;
+}
+
+/**
+ * Submit until the task is accepted, equivalent to a blocking submit.
+ */
+inline static void submitTask(ExecutorService *executor, void (*fn)(void *), void *arg) {
+    while (!executor->submit(executor, fn, arg)) {
+        sched_yield();
+    }
+}
+
+static void emptyTask(void *arg) {
+}
+
+/**
+ * The submit and start time of a task in the latency scenarios.
+ */
+struct TaskSlot {
+    uint64_t submitted;
+    uint64_t started;
+};
+
+/* throughput: empty tasks from the submitters, until shutdown has drained the queue */
+
+struct SubmitterContext {
+    ExecutorService *executor;
+    pthread_barrier_t *barrier;
+    size_t tasks;
+    struct TaskSlot *slots;
+    Histogram latency;
+};
+
+static void *throughputSubmitter(void *arg) {
+    struct SubmitterContext *context = arg;
+    pthread_barrier_wait(context->barrier);
+    for (size_t i = 0; i < context->tasks; ++i) {
+        if (i % SUBMIT_SAMPLE == 0) {
+            uint64_t start = nowNanos();
+            submitTask(context->executor, emptyTask, NULL);
+            recordHistogram(&context->latency, nowNanos() - start);
+        } else {
+            submitTask(context->executor, emptyTask, NULL);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Start the submitters at a barrier, then shut the executor down, which waits for the queued tasks.
+ */
+static void runSubmitters(struct ExecutorRun *run, ExecutorService *executor, void *(*submitter)(void *),
+                          struct TaskSlot *slots) {
+    size_t submitters = run->submitters;
+    size_t tasks = run->options->tasks / submitters;
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, submitters + 1);
+    pthread_t *tids = malloc(sizeof(pthread_t) * submitters);
+    struct SubmitterContext *contexts = calloc(submitters, sizeof(struct SubmitterContext));
+
+    for (size_t i = 0; i < submitters; ++i) {
+        contexts[i].executor = executor;
+        contexts[i].barrier = &barrier;
+        contexts[i].tasks = tasks;
+        contexts[i].slots = slots == NULL ? NULL : slots + i * tasks;
+        pthread_create(&tids[i], NULL, submitter, &contexts[i]);
+    }
+    pthread_barrier_wait(&barrier);
+    uint64_t start = nowNanos();
+    for (size_t i = 0; i < submitters; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    executor->shutdown(executor);
+    run->elapsed = nowNanos() - start;
+    run->operations = tasks * submitters;
+
+    for (size_t i = 0; i < submitters; ++i) {
+        mergeHistogram(&run->latency, &contexts[i].latency);
+    }
+    pthread_barrier_destroy(&barrier);
+    free(contexts);
+    free(tids);
+}
+
+static bool runThroughput(struct ExecutorRun *run) {
+    ExecutorService *executor = newExecutor(run);
+    if (executor == NULL) {
+        return false;
+    }
+    runSubmitters(run, executor, throughputSubmitter, NULL);
+    executor->free(executor);
+    return true;
+}
+
+/* submit-to-start latency: every task records the time it starts */
+
+static void stampTask(void *arg) {
+    struct TaskSlot *slot = arg;
+    atomic_store_explicit(&slot->started, nowNanos(), memory_order_release);
+}
+
+/**
+ * The stamp is taken before every attempt, the task cannot start before the attempt which is accepted.
+ */
+inline static void submitStampTask(ExecutorService *executor, struct TaskSlot *slot) {
+    for (;;) {
+        slot->submitted = nowNanos();
+        if (executor->submit(executor, stampTask, slot)) {
+            return;
+        }
+        sched_yield();
+    }
+}
+
+/**
+ * The pool is idle at every submit: the next task is submitted after the previous one has started.
+ */
+static bool runLatencyIdle(struct ExecutorRun *run) {
+    ExecutorService *executor = newExecutor(run);
+    if (executor == NULL) {
+        return false;
+    }
+    size_t tasks = run->options->tasks / 10;
+    struct TaskSlot *slots = calloc(tasks, sizeof(struct TaskSlot));
+
+    uint64_t start = nowNanos();
+    for (size_t i = 0; i < tasks; ++i) {
+        submitStampTask(executor, &slots[i]);
+        while (atomic_load_explicit(&slots[i].started, memory_order_acquire) == 0) {
+            sched_yield();
+        }
+        recordHistogram(&run->latency, slots[i].started - slots[i].submitted);
+    }
+    run->elapsed = nowNanos() - start;
+    run->operations = tasks;
+
+    executor->free(executor);
+    free(slots);
+    return true;
+}
+
+static void *loadedSubmitter(void *arg) {
+    struct SubmitterContext *context = arg;
+    pthread_barrier_wait(context->barrier);
+    for (size_t i = 0; i < context->tasks; ++i) {
+        submitStampTask(context->executor, &context->slots[i]);
+    }
+    return NULL;
+}
+
+/**
+ * The submitters keep the queue full, so the latency includes the time in the queue.
+ */
+static bool runLatencyLoaded(struct ExecutorRun *run) {
+    ExecutorService *executor = newExecutor(run);
+    if (executor == NULL) {
+        return false;
+    }
+    struct TaskSlot *slots = calloc(run->options->tasks, sizeof(struct TaskSlot));
+    runSubmitters(run, executor, loadedSubmitter, slots);
+    executor->free(executor);
+
+    for (size_t i = 0; i < run->operations; ++i) {
+        recordHistogram(&run->latency, slots[i].started - slots[i].submitted);
+    }
+    free(slots);
+    return true;
+}
+
+/* ping-pong: each task submits the next task of its chain */
+
+struct Chain {
+    ExecutorService *executor;
+    CountDownLatch *done;
+    size_t remaining;
+    uint64_t submitted;
+    Histogram latency;
+};
+
+static void chainTask(void *arg) {
+    struct Chain *chain = arg;
+    recordHistogram(&chain->latency, nowNanos() - chain->submitted);
+    if (--chain->remaining == 0) {
+        decreaseCountDownLatch(chain->done);
+        return;
+    }
+    chain->submitted = nowNanos();
+    submitTask(chain->executor, chainTask, chain);
+}
+
+/**
+ * A chain task submits from a worker, so a handoff executor needs a thread more than the chains, or every worker
+ * runs a chain and no one takes the next task.
+ */
+static bool runPingPong(struct ExecutorRun *run) {
+    if (isHandoff(run) && run->threads <= run->submitters) {
+        return false;
+    }
+    ExecutorService *executor = newExecutor(run);
+    if (executor == NULL) {
+        return false;
+    }
+    size_t chains = run->submitters;
+    size_t hops = run->options->tasks / chains;
+    struct Chain *contexts = calloc(chains, sizeof(struct Chain));
+    CountDownLatch *done = newCountDownLatch((int) chains);
+
+    uint64_t start = nowNanos();
+    for (size_t i = 0; i < chains; ++i) {
+        contexts[i].executor = executor;
+        contexts[i].done = done;
+        contexts[i].remaining = hops;
+        contexts[i].submitted = nowNanos();
+        submitTask(executor, chainTask, &contexts[i]);
+    }
+    awaitCountDownLatch(done, -1);
+    run->elapsed = nowNanos() - start;
+    run->operations = hops * chains;
+
+    for (size_t i = 0; i < chains; ++i) {
+        mergeHistogram(&run->latency, &contexts[i].latency);
+    }
+    executor->free(executor);
+    freeCountDownLatch(done);
+    free(contexts);
+    return true;
+}
+
+/* shutdown: the time to stop an idle executor whose workers are parked */
+
+static void latchTask(void *arg) {
+    decreaseCountDownLatch(arg);
+}
+
+static bool runShutdown(struct ExecutorRun *run) {
+    run->elapsed = 0;
+    for (int i = 0; i < SHUTDOWN_SAMPLES; ++i) {
+        ExecutorService *executor = newExecutor(run);
+        if (executor == NULL) {
+            return false;
+        }
+        CountDownLatch *started = newCountDownLatch((int) run->threads);
+        for (size_t j = 0; j < run->threads; ++j) {
+            submitTask(executor, latchTask, started);
+        }
+        awaitCountDownLatch(started, -1);
+
+        uint64_t start = nowNanos();
+        executor->shutdown(executor);
+        uint64_t elapsed = nowNanos() - start;
+        recordHistogram(&run->latency, elapsed);
+        run->elapsed += elapsed;
+
+        executor->free(executor);
+        freeCountDownLatch(started);
+    }
+    run->operations = SHUTDOWN_SAMPLES;
+    return true;
+}
+
+static const struct Scenario SCENARIOS[] = {
+        {"throughput",     true,  runThroughput},
+        {"latency-idle",   false, runLatencyIdle},
+        {"latency-loaded", true,  runLatencyLoaded},
+        {"ping-pong",      true,  runPingPong},
+        {"shutdown",       false, runShutdown},
+};
+
+static const size_t SCENARIO_SIZE = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+static void benchmarkExecutor(BenchmarkReport *report, struct ExecutorRun *run, const struct Scenario *scenario) {
+    const struct ExecutorOptions *options = run->options;
+    for (size_t i = 0; i < options->warmup + options->repetitions; ++i) {
+        resetHistogram(&run->latency);
+        if (!scenario->run(run)) {
+            fprintf(stderr, "%s executor with %s queue, %zu threads and %zu submitters is not supported, %s skipped\n",
+                    run->implementation->name, run->queue->name, run->threads, run->submitters, scenario->name);
+            return;
+        }
+        if (i < options->warmup) {
+            continue;
+        }
+
+        Histogram *latency = &run->latency;
+        addBenchmarkReportRow(report, "%s|%s|%s|%zu|%zu|%zu|%zu|%.3f|%llu|%llu|%llu|%llu",
+                              run->implementation->name, run->queue->name, scenario->name, run->threads,
+                              scenario->usesSubmitters ? run->submitters : 1, i - options->warmup, run->operations,
+                              (double) run->operations / ((double) run->elapsed / 1000.0),
+                              (unsigned long long) percentileHistogram(latency, 50.0),
+                              (unsigned long long) percentileHistogram(latency, 99.0),
+                              (unsigned long long) percentileHistogram(latency, 99.9),
+                              (unsigned long long) latency->max);
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -e, --executor NAMES      executor implementations, comma separated (default: all)\n"
+            "  -q, --queue NAMES         task queue implementations, comma separated (default: all)\n"
+            "  -S, --scenario NAMES      scenarios, comma separated (default: all)\n"
+            "  -t, --threads COUNTS      pool thread counts, comma separated (default: 4)\n"
+            "  -p, --submitters COUNTS   submitter thread or chain counts, comma separated (default: 1,4)\n"
+            "  -C, --capacity N          task queue capacity (default: 1024)\n"
+            "  -n, --tasks N             tasks per run, the idle latency scenario runs a tenth (default: 1000000)\n"
+            "  -w, --warmup N            warmup runs which are not reported (default: 1)\n"
+            "  -r, --repetitions N       reported runs (default: 3)\n"
+            "  -f, --format FORMAT       text, csv or json (default: text)\n"
+            "\n"
+            "The latency columns are the submit call for throughput, submit-to-start for latency-idle,\n"
+            "latency-loaded and ping-pong, and the shutdown call for shutdown. ping-pong on the cached executor or the\n"
+            "synchronous queue needs more threads than chains. The cached executor hands the tasks over with its own\n"
+            "synchronous queue, so it runs once whatever the queues.\n", program);
+    fprintf(stderr, "executors:");
+    for (size_t i = 0; i < sizeof(EXECUTORS) / sizeof(EXECUTORS[0]); ++i) {
+        fprintf(stderr, " %s", EXECUTORS[i].name);
+    }
+    fprintf(stderr, "\nqueues:");
+    for (size_t i = 0; i < BENCHMARK_QUEUE_SIZE; ++i) {
+        if (!BENCHMARK_QUEUES[i].stamped) {
+            fprintf(stderr, " %s", BENCHMARK_QUEUES[i].name);
+        }
+    }
+    fprintf(stderr, "\nscenarios:");
+    for (size_t i = 0; i < SCENARIO_SIZE; ++i) {
+        fprintf(stderr, " %s", SCENARIOS[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+static bool parseExecutors(char *text, struct ExecutorOptions *options) {
+    const char *names[MAX_NAMES];
+    options->executorSize = parseNameList(text, names, MAX_NAMES);
+    for (size_t i = 0; i < options->executorSize; ++i) {
+        options->executors[i] = NULL;
+        for (size_t j = 0; j < sizeof(EXECUTORS) / sizeof(EXECUTORS[0]); ++j) {
+            if (strcmp(EXECUTORS[j].name, names[i]) == 0) {
+                options->executors[i] = &EXECUTORS[j];
+            }
+        }
+        if (options->executors[i] == NULL) {
+            return false;
+        }
+    }
+    return options->executorSize > 0;
+}
+
+static bool parseQueues(char *text, struct ExecutorOptions *options) {
+    const char *names[MAX_NAMES];
+    options->queueSize = parseNameList(text, names, MAX_NAMES);
+    for (size_t i = 0; i < options->queueSize; ++i) {
+        options->queues[i] = findBenchmarkQueue(names[i]);
+        if (options->queues[i] == NULL || options->queues[i]->stamped) {
+            return false;
+        }
+    }
+    return options->queueSize > 0;
+}
+
+static bool parseScenarios(char *text, struct ExecutorOptions *options) {
+    const char *names[MAX_NAMES];
+    options->scenarioSize = parseNameList(text, names, MAX_NAMES);
+    for (size_t i = 0; i < options->scenarioSize; ++i) {
+        options->scenarios[i] = NULL;
+        for (size_t j = 0; j < SCENARIO_SIZE; ++j) {
+            if (strcmp(SCENARIOS[j].name, names[i]) == 0) {
+                options->scenarios[i] = &SCENARIOS[j];
+            }
+        }
+        if (options->scenarios[i] == NULL) {
+            return false;
+        }
+    }
+    return options->scenarioSize > 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct ExecutorOptions options = {
+            .threads = {4},
+            .threadSize = 1,
+            .submitters = {1, 4},
+            .submitterSize = 2,
+            .capacity = 1024,
+            .tasks = 1000000,
+            .warmup = 1,
+            .repetitions = 3,
+            .format = BENCHMARK_FORMAT_TEXT,
+    };
+    for (size_t i = 0; i < sizeof(EXECUTORS) / sizeof(EXECUTORS[0]) && i < MAX_NAMES; ++i) {
+        options.executors[options.executorSize++] = &EXECUTORS[i];
+    }
+    for (size_t i = 0; i < BENCHMARK_QUEUE_SIZE && options.queueSize < MAX_NAMES; ++i) {
+        if (!BENCHMARK_QUEUES[i].stamped) {
+            options.queues[options.queueSize++] = &BENCHMARK_QUEUES[i];
+        }
+    }
+    for (size_t i = 0; i < SCENARIO_SIZE && i < MAX_NAMES; ++i) {
+        options.scenarios[options.scenarioSize++] = &SCENARIOS[i];
+    }
+
+    static const struct option longOptions[] = {
+            {"executor",    required_argument, NULL, 'e'},
+            {"queue",       required_argument, NULL, 'q'},
+            {"scenario",    required_argument, NULL, 'S'},
+            {"threads",     required_argument, NULL, 't'},
+            {"submitters",  required_argument, NULL, 'p'},
+            {"capacity",    required_argument, NULL, 'C'},
+            {"tasks",       required_argument, NULL, 'n'},
+            {"warmup",      required_argument, NULL, 'w'},
+            {"repetitions", required_argument, NULL, 'r'},
+            {"format",      required_argument, NULL, 'f'},
+            {"help",        no_argument,       NULL, 'h'},
+            {NULL, 0,                          NULL, 0},
+    };
+
+    int opt;
+    bool valid = true;
+    while (valid && (opt = getopt_long(argc, argv, "e:q:S:t:p:C:n:w:r:f:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'e':
+                valid = parseExecutors(optarg, &options);
+                break;
+            case 'q':
+                valid = parseQueues(optarg, &options);
+                break;
+            case 'S':
+                valid = parseScenarios(optarg, &options);
+                break;
+            case 't':
+                options.threadSize = parseSizeList(optarg, options.threads, MAX_THREAD_COUNTS);
+                valid = options.threadSize > 0;
+                break;
+            case 'p':
+                options.submitterSize = parseSizeList(optarg, options.submitters, MAX_THREAD_COUNTS);
+                valid = options.submitterSize > 0;
+                break;
+            case 'C':
+                options.capacity = strtoull(optarg, NULL, 10);
+                valid = options.capacity > 0;
+                break;
+            case 'n':
+                options.tasks = strtoull(optarg, NULL, 10);
+                valid = options.tasks >= 10;
+                break;
+            case 'w':
+                options.warmup = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                options.repetitions = strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                valid = parseBenchmarkFormat(optarg, &options.format);
+                break;
+            default:
+                valid = false;
+                break;
+        }
+    }
+    for (size_t i = 0; valid && i < options.submitterSize; ++i) {
+        valid = options.submitters[i] <= options.tasks;
+    }
+    if (!valid || optind < argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    static const char *const columns[] = {"executor", "queue", "scenario", "threads", "submitters", "run", "ops",
+                                          "mops", "p50_ns", "p99_ns", "p999_ns", "max_ns"};
+    BenchmarkReport report;
+    beginBenchmarkReport(&report, stdout, options.format, columns, sizeof(columns) / sizeof(columns[0]));
+
+    struct ExecutorRun *run = calloc(1, sizeof(struct ExecutorRun));
+    run->options = &options;
+    for (size_t e = 0; e < options.executorSize; ++e) {
+        // the same pool whatever the queue, so it runs once
+        size_t queueSize = options.executors[e]->usesQueue ? options.queueSize : 1;
+        for (size_t q = 0; q < queueSize; ++q) {
+            for (size_t s = 0; s < options.scenarioSize; ++s) {
+                for (size_t t = 0; t < options.threadSize; ++t) {
+                    // scenarios without submitters run once per thread count
+                    size_t submitterSize = options.scenarios[s]->usesSubmitters ? options.submitterSize : 1;
+                    for (size_t p = 0; p < submitterSize; ++p) {
+                        run->implementation = options.executors[e];
+                        run->queue = options.executors[e]->usesQueue ? options.queues[q]
+                                                                     : findBenchmarkQueue(QUEUELESS_EXECUTOR_QUEUE);
+                        run->threads = options.threads[t];
+                        run->submitters = options.submitters[p];
+                        benchmarkExecutor(&report, run, options.scenarios[s]);
+                    }
+                }
+            }
+        }
+    }
+    free(run);
+
+    endBenchmarkReport(&report);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "ObjectPool.h"
+#include "FixedThreadPoolExecutor.h"
+#include "ArrayBlockingQueue.h"
+#include "LinkedBlockingQueue.h"
+#include "CountDownLatch.h"
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <stdio.h>
+
+static const size_t BLOCK_SIZE = 64;
+static const size_t POOL_QUEUE_SIZE = 1024;
+static const int BLOCKS = 1000000;
+
+struct PoolBenchmarkContext {
+    CountDownLatch *latch;
+    BlockingQueue *queue;
+    ObjectPool *pool;
+};
+
+inline static void *allocateBlock(ObjectPool *pool) {
+    return pool != NULL ? allocateObjectPool(pool) : malloc(BLOCK_SIZE);
+}
+
+inline static void freeBlock(ObjectPool *pool, void *block) {
+    if (pool != NULL) {
+        deallocateObjectPool(pool, block);
+    } else {
+        free(block);
+    }
+}
+
+static void blockProducerThread(void *arg) {
+    struct PoolBenchmarkContext *context = arg;
+    for (int i = 0; i < BLOCKS; ++i) {
+        void *block = allocateBlock(context->pool);
+        context->queue->offer(context->queue, &block, -1);
+    }
+    decreaseCountDownLatch(context->latch);
+}
+
+static void blockConsumerThread(void *arg) {
+    struct PoolBenchmarkContext *context = arg;
+    for (int i = 0; i < BLOCKS; ++i) {
+        void *block;
+        context->queue->poll(context->queue, &block, -1);
+        freeBlock(context->pool, block);
+    }
+    decreaseCountDownLatch(context->latch);
+}
+
+inline static double elapsedMs(struct timeval *s, struct timeval *t) {
+    return (double) (t->tv_sec - s->tv_sec) * 1000.0 + (double) (t->tv_usec - s->tv_usec) / 1000.0;
+}
+
+/**
+ * The blocks are allocated by one thread and freed by another, which is the pattern of queue nodes.
+ */
+static void benchmarkCrossThread(ObjectPool *pool, const char *name) {
+    CountDownLatch *latch = newCountDownLatch(2);
+    BlockingQueue *queue = newArrayBlockingQueue(POOL_QUEUE_SIZE, sizeof(void *));
+    ExecutorService *executor = newFixedThreadPoolExecutor(2, -1, "pool-%d", newLinkedBlockingQueue);
+    struct PoolBenchmarkContext context = {.latch = latch, .queue = queue, .pool = pool};
+
+    struct timeval s, t;
+    gettimeofday(&s, NULL);
+    executor->submit(executor, blockConsumerThread, &context);
+    executor->submit(executor, blockProducerThread, &context);
+    awaitCountDownLatch(latch, -1);
+    gettimeofday(&t, NULL);
+
+    printf("> %-6s producer/consumer: %f mops\n", name, BLOCKS / elapsedMs(&s, &t) / 1000.0);
+
+    executor->free(executor);
+    queue->free(queue);
+    freeCountDownLatch(latch);
+}
+
+static void benchmarkSameThread(ObjectPool *pool, const char *name) {
+    void *blocks[64];
+    struct timeval s, t;
+    gettimeofday(&s, NULL);
+    for (int i = 0; i < BLOCKS; i += 64) {
+        for (int j = 0; j < 64; ++j) {
+            blocks[j] = allocateBlock(pool);
+        }
+        for (int j = 0; j < 64; ++j) {
+            freeBlock(pool, blocks[j]);
+        }
+    }
+    gettimeofday(&t, NULL);
+
+    printf("> %-6s same thread: %f mops\n", name, BLOCKS / elapsedMs(&s, &t) / 1000.0);
+}
+
+void benchmarkObjectPool() {
+    printf("> object pool benchmark\n");
+    ObjectPool *pool = newObjectPool(BLOCK_SIZE);
+    benchmarkSameThread(NULL, "malloc");
+    benchmarkSameThread(pool, "pool");
+    benchmarkCrossThread(NULL, "malloc");
+    benchmarkCrossThread(pool, "pool");
+    freeObjectPool(pool);
+}
@@ -1,135 +1,307 @@
-#include "FixedThreadPoolExecutor.h"
-#include "LinkedBlockingQueue.h"
-#include "ArrayBlockingQueue.h"
-#include "CountDownLatch.h"
+#include "benchmark.h"
+#include "StripedCounter.h"
 
+#include <getopt.h>
+#include <pthread.h>
 #include <stdatomic.h>
-#include <sys/time.h>
-#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-static const int CONSUMERS = 16;
-static const int PRODUCERS = 16;
-static const size_t QUEUE_SIZE = 1024;
-static const int TEST_SIZE = 1000000;
+#define MAX_THREAD_COUNTS 16
 
-static void benchmarkQueue(BlockingQueue *queue);
+#define MAX_QUEUES 16
 
-struct BenchmarkContext {
-    CountDownLatch *latch;
+struct QueueOptions {
+    size_t producers[MAX_THREAD_COUNTS];
+    size_t producerSize;
+    size_t consumers[MAX_THREAD_COUNTS];
+    size_t consumerSize;
+    size_t capacity;
+    size_t itemSize;
+    size_t batch;
+    size_t sampleEvery;
+    size_t operations;
+    size_t warmup;
+    size_t repetitions;
+    BenchmarkFormat format;
+    const BenchmarkQueue *queues[MAX_QUEUES];
+    size_t queueSize;
+};
+
+struct QueueRun {
     BlockingQueue *queue;
-    int producers;
-    int consumers;
-    int finished;
-    int exits;
+    const struct QueueOptions *options;
+    size_t producers;
+    size_t consumers;
+    pthread_barrier_t barrier;
+    size_t exits;
+    StripedCounter *polled;
+    pthread_mutex_t mutex;
+    Histogram latency;
 };
 
-void benchmarkLinkedBlockingQueue() {
-    printf("> linked blocking queue benchmark\n");
-    BlockingQueue *queue = newLinkedBlockingQueue(QUEUE_SIZE, sizeof(long long));
-    benchmarkQueue(queue);
-    queue->free(queue);
-}
+/**
+ * Every item starts with the clock of its offer. Only one item in `sampleEvery` is stamped, so the clock is read
+ * once per `sampleEvery` operations; the others carry 0.
+ */
+static void *producerThread(void *arg) {
+    struct QueueRun *run = arg;
+    BlockingQueue *queue = run->queue;
+    size_t sampleEvery = run->options->sampleEvery;
+    char *item = calloc(1, run->options->itemSize);
+
+    pthread_barrier_wait(&run->barrier);
+    for (size_t i = 0; i < run->options->operations; ++i) {
+        uint64_t stamp = i % sampleEvery == 0 ? nowNanos() : 0;
+        memcpy(item, &stamp, sizeof(stamp));
+        queue->offer(queue, item, -1);
+    }
 
-void benchmarkArrayBlockingQueue() {
-    printf("> array blocking queue benchmark\n");
-    BlockingQueue *queue = newArrayBlockingQueue(QUEUE_SIZE, sizeof(long long));
-    benchmarkQueue(queue);
-    queue->free(queue);
+    // the last producer closes the queue, the consumers drain it and stop
+    if (atomic_fetch_add(&run->exits, 1) + 1 == run->producers) {
+        queue->close(queue);
+    }
+    free(item);
+    return NULL;
 }
 
-static void consumerThread(void *arg) {
-    struct BenchmarkContext *context = arg;
-    BlockingQueue *queue = context->queue;
-    CountDownLatch *latch = context->latch;
-    for (;;) {
-        long long x;
-        queue->poll(queue, &x, -1);
-        atomic_fetch_add(&context->finished, 1);
-        if (x == -1) {
-            atomic_fetch_add(&context->exits, 1);
-            decreaseCountDownLatch(latch);
-            return;
+/**
+ * Take up to `batch` items per call, until the queue is closed and empty.
+ */
+static void *consumerThread(void *arg) {
+    struct QueueRun *run = arg;
+    BlockingQueue *queue = run->queue;
+    size_t itemSize = run->options->itemSize;
+    size_t batch = run->options->batch;
+    char *items = calloc(batch, itemSize);
+    Histogram *latency = malloc(sizeof(Histogram));
+    resetHistogram(latency);
+
+    pthread_barrier_wait(&run->barrier);
+    size_t size;
+    while ((size = drainBlockingQueue(queue, items, itemSize, batch, -1)) > 0) {
+        // every consumer adds to its own cell, a shared atomic would bounce between them on every batch
+        addStripedCounter(run->polled, (long long) size);
+        uint64_t now = 0;
+        for (size_t i = 0; i < size; ++i) {
+            uint64_t stamp;
+            memcpy(&stamp, items + i * itemSize, sizeof(stamp));
+            if (stamp != 0) {
+                now = now == 0 ? nowNanos() : now;
+                recordHistogram(latency, now - stamp);
+            }
         }
     }
+
+    pthread_mutex_lock(&run->mutex);
+    mergeHistogram(&run->latency, latency);
+    pthread_mutex_unlock(&run->mutex);
+    free(latency);
+    free(items);
+    return NULL;
+}
+
+/**
+ * Run the producers and consumers once on raw threads. The clock starts when every thread is at the barrier.
+ *
+ * @return the throughput in mops, counted from the items the consumers polled.
+ */
+static double runQueue(struct QueueRun *run) {
+    size_t threads = run->producers + run->consumers;
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    pthread_barrier_init(&run->barrier, NULL, threads + 1);
+    atomic_init(&run->exits, 0);
+    resetHistogram(&run->latency);
+
+    for (size_t i = 0; i < threads; ++i) {
+        pthread_create(&tids[i], NULL, i < run->producers ? producerThread : consumerThread, run);
+    }
+    pthread_barrier_wait(&run->barrier);
+    uint64_t start = nowNanos();
+    for (size_t i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    uint64_t elapsed = nowNanos() - start;
+
+    pthread_barrier_destroy(&run->barrier);
+    free(tids);
+    return (double) sumThenResetStripedCounter(run->polled) / ((double) elapsed / 1000.0);
 }
 
-static void producerThread(void *arg) {
-    struct BenchmarkContext *context = arg;
-    BlockingQueue *queue = context->queue;
-    CountDownLatch *latch = context->latch;
-    for (int i = 0; i < TEST_SIZE; ++i) {
-        long long x = i;
-        queue->offer(queue, &x, -1);
-        atomic_fetch_add(&context->finished, 1);
+static void benchmarkQueue(BenchmarkReport *report, const struct QueueOptions *options,
+                           const BenchmarkQueue *implementation, size_t producers, size_t consumers) {
+    struct QueueRun *run = calloc(1, sizeof(struct QueueRun));
+    run->options = options;
+    run->producers = producers;
+    run->consumers = consumers;
+    run->polled = newStripedCounter();
+    pthread_mutex_init(&run->mutex, NULL);
+    if (run->polled == NULL) {
+        fprintf(stderr, "failed to create the counter of %s queue\n", implementation->name);
+        pthread_mutex_destroy(&run->mutex);
+        free(run);
+        return;
     }
-    if (atomic_fetch_add(&context->exits, 1) + 1 == context->producers) {
-        for (int i = 0; i < context->consumers; ++i) {
-            long long stop = -1;
-            queue->offer(queue, &stop, -1);
+
+    for (size_t i = 0; i < options->warmup + options->repetitions; ++i) {
+        // every run closes its queue
+        run->queue = implementation->builder(options->capacity, options->itemSize);
+        if (run->queue == NULL) {
+            fprintf(stderr, "failed to create %s queue\n", implementation->name);
+            break;
+        }
+        double mops = runQueue(run);
+        run->queue->free(run->queue);
+        if (i < options->warmup) {
+            continue;
         }
+
+        Histogram *latency = &run->latency;
+        addBenchmarkReportRow(report, "%s|%zu|%zu|%zu|%zu|%zu|%zu|%zu|%.3f|%llu|%llu|%llu|%llu",
+                              implementation->name, producers, consumers, options->capacity, options->itemSize,
+                              options->batch, options->sampleEvery, i - options->warmup, mops,
+                              (unsigned long long) percentileHistogram(latency, 50.0),
+                              (unsigned long long) percentileHistogram(latency, 99.0),
+                              (unsigned long long) percentileHistogram(latency, 99.9),
+                              (unsigned long long) latency->max);
     }
-    decreaseCountDownLatch(latch);
+
+    freeStripedCounter(run->polled);
+    pthread_mutex_destroy(&run->mutex);
+    free(run);
 }
 
-static void showResult(long finished, struct timeval *s, struct timeval *t) {
-    double dur = (double) (t->tv_sec - s->tv_sec) * 1000.0 + (double) (t->tv_usec - s->tv_usec) / 1000.0;
-    printf("%f mops\n", (double) finished / dur / 1000.0);
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -q, --queue NAMES         queue implementations, comma separated (default: all)\n"
+            "  -p, --producers COUNTS    producer thread counts, comma separated (default: 1,16)\n"
+            "  -c, --consumers COUNTS    consumer thread counts, comma separated (default: 1,16)\n"
+            "  -C, --capacity N          queue capacity, or \"unbounded\" (default: 1024)\n"
+            "  -s, --item-size BYTES     item size, at least 8 (default: 8)\n"
+            "  -b, --batch N             items a consumer takes per call, with drainBlockingQueue (default: 1)\n"
+            "  -e, --sample-every N      operations per clock read for latency sampling (default: 1)\n"
+            "  -n, --operations N        items offered by each producer (default: 1000000)\n"
+            "  -w, --warmup N            warmup runs which are not reported (default: 1)\n"
+            "  -r, --repetitions N       reported runs (default: 3)\n"
+            "  -f, --format FORMAT       text, csv or json (default: text)\n", program);
+    fprintf(stderr, "queues:");
+    for (size_t i = 0; i < BENCHMARK_QUEUE_SIZE; ++i) {
+        fprintf(stderr, " %s", BENCHMARK_QUEUES[i].name);
+    }
+    fprintf(stderr, "\n");
 }
 
-static void benchmarkQueueMP(BlockingQueue *queue, int producers, int consumers) {
-    
-    CountDownLatch *latch = newCountDownLatch(producers + consumers);
-    ExecutorService *producer = newFixedThreadPoolExecutor(producers, -1, "producer-%d", newLinkedBlockingQueue);
-    ExecutorService *consumer = newFixedThreadPoolExecutor(consumers, -1, "consumer-%d", newLinkedBlockingQueue);
-
-    struct BenchmarkContext producerContext = {
-            .producers = producers,
-            .consumers = consumers,
-            .latch = latch,
-            .finished = 0,
-            .queue = queue,
-            .exits = 0,
-    };
-    
-    struct BenchmarkContext consumerContext = {
-            .producers = producers,
-            .consumers = consumers,
-            .latch = latch,
-            .finished = 0,
-            .queue = queue,
-            .exits = 0,
+static bool parseQueues(char *text, struct QueueOptions *options) {
+    const char *names[MAX_QUEUES];
+    options->queueSize = parseNameList(text, names, MAX_QUEUES);
+    for (size_t i = 0; i < options->queueSize; ++i) {
+        if ((options->queues[i] = findBenchmarkQueue(names[i])) == NULL) {
+            return false;
+        }
+    }
+    return options->queueSize > 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct QueueOptions options = {
+            .producers = {1, 16},
+            .producerSize = 2,
+            .consumers = {1, 16},
+            .consumerSize = 2,
+            .capacity = 1024,
+            .itemSize = 8,
+            .batch = 1,
+            .sampleEvery = 1,
+            .operations = 1000000,
+            .warmup = 1,
+            .repetitions = 3,
+            .format = BENCHMARK_FORMAT_TEXT,
     };
+    for (size_t i = 0; i < BENCHMARK_QUEUE_SIZE && i < MAX_QUEUES; ++i) {
+        options.queues[options.queueSize++] = &BENCHMARK_QUEUES[i];
+    }
 
-    struct timeval s, t;
-    gettimeofday(&s, NULL);
-    for (int i = 0; i < producers; ++i) {
-        producer->submit(producer, producerThread, &producerContext);
+    static const struct option longOptions[] = {
+            {"queue",        required_argument, NULL, 'q'},
+            {"producers",    required_argument, NULL, 'p'},
+            {"consumers",    required_argument, NULL, 'c'},
+            {"capacity",     required_argument, NULL, 'C'},
+            {"item-size",    required_argument, NULL, 's'},
+            {"batch",        required_argument, NULL, 'b'},
+            {"sample-every", required_argument, NULL, 'e'},
+            {"operations",   required_argument, NULL, 'n'},
+            {"warmup",       required_argument, NULL, 'w'},
+            {"repetitions",  required_argument, NULL, 'r'},
+            {"format",       required_argument, NULL, 'f'},
+            {"help",         no_argument,       NULL, 'h'},
+            {NULL, 0,                           NULL, 0},
+    };
 
+    int opt;
+    bool valid = true;
+    while (valid && (opt = getopt_long(argc, argv, "q:p:c:C:s:b:e:n:w:r:f:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'q':
+                valid = parseQueues(optarg, &options);
+                break;
+            case 'p':
+                options.producerSize = parseSizeList(optarg, options.producers, MAX_THREAD_COUNTS);
+                valid = options.producerSize > 0;
+                break;
+            case 'c':
+                options.consumerSize = parseSizeList(optarg, options.consumers, MAX_THREAD_COUNTS);
+                valid = options.consumerSize > 0;
+                break;
+            case 'C':
+                options.capacity = strcmp(optarg, "unbounded") == 0 ? BLOCKING_QUEUE_UNBOUNDED : strtoull(optarg, NULL, 10);
+                valid = options.capacity > 0;
+                break;
+            case 's':
+                options.itemSize = strtoull(optarg, NULL, 10);
+                valid = options.itemSize >= sizeof(uint64_t);
+                break;
+            case 'b':
+                options.batch = strtoull(optarg, NULL, 10);
+                valid = options.batch > 0;
+                break;
+            case 'e':
+                options.sampleEvery = strtoull(optarg, NULL, 10);
+                valid = options.sampleEvery > 0;
+                break;
+            case 'n':
+                options.operations = strtoull(optarg, NULL, 10);
+                break;
+            case 'w':
+                options.warmup = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                options.repetitions = strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                valid = parseBenchmarkFormat(optarg, &options.format);
+                break;
+            default:
+                valid = false;
+                break;
+        }
     }
-    for (int i = 0; i < consumers; ++i) {
-        consumer->submit(consumer, consumerThread, &consumerContext);
+    if (!valid || optind < argc) {
+        usage(argv[0]);
+        return 1;
     }
-    awaitCountDownLatch(latch, -1);
-    gettimeofday(&t, NULL);
-
-    showResult(producerContext.finished + consumerContext.finished, &s, &t);
 
-    freeCountDownLatch(latch);
-    consumer->free(consumer);
-    producer->free(producer);
+    static const char *const columns[] = {"queue", "producers", "consumers", "capacity", "item_size", "batch",
+                                          "sample_every", "run", "mops", "p50_ns", "p99_ns", "p999_ns", "max_ns"};
+    BenchmarkReport report;
+    beginBenchmarkReport(&report, stdout, options.format, columns, sizeof(columns) / sizeof(columns[0]));
+    for (size_t q = 0; q < options.queueSize; ++q) {
+        for (size_t p = 0; p < options.producerSize; ++p) {
+            for (size_t c = 0; c < options.consumerSize; ++c) {
+                benchmarkQueue(&report, &options, options.queues[q], options.producers[p], options.consumers[c]);
+            }
+        }
+    }
+    endBenchmarkReport(&report);
+    return 0;
 }
-
-static void benchmarkQueue(BlockingQueue *queue) {
-    printf("> spsc test: ");
-    fflush(stdout);
-    benchmarkQueueMP(queue, 1, 1);
-    printf("> spmc test: ");
-    fflush(stdout);
-    benchmarkQueueMP(queue, 1, CONSUMERS);
-    printf("> mpsc test: ");
-    fflush(stdout);
-    benchmarkQueueMP(queue, PRODUCERS, 1);
-    printf("> mpmc test: ");
-    fflush(stdout);
-    benchmarkQueueMP(queue, PRODUCERS, CONSUMERS);
-}
\ No newline at end of file
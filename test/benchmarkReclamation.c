@@ -0,0 +1,145 @@
+#include "EpochDomain.h"
+#include "HazardPointerDomain.h"
+#include "FixedThreadPoolExecutor.h"
+#include "LinkedBlockingQueue.h"
+#include "CountDownLatch.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <stdio.h>
+
+static const int MAX_READERS = 8;
+static const int READS = 1000000;
+
+/**
+ * The object behind the shared pointer. A reader which sees check != ~value read a freed object.
+ */
+struct SharedObject {
+    uint64_t value;
+    uint64_t check;
+};
+
+struct ReclaimBenchmarkContext {
+    CountDownLatch *readers;
+    CountDownLatch *writer;
+    EpochDomain *epoch;
+    HazardPointerDomain *hazard;
+    struct SharedObject *shared;
+    bool stop;
+    size_t writes;
+    size_t corrupted;
+};
+
+static size_t freedObjects;
+
+static struct SharedObject *newSharedObject(uint64_t value) {
+    struct SharedObject *object = malloc(sizeof(struct SharedObject));
+    object->value = value;
+    object->check = ~value;
+    return object;
+}
+
+static void deleteSharedObject(void *ptr) {
+    struct SharedObject *object = ptr;
+    object->check = object->value;
+    free(object);
+    atomic_fetch_add_explicit(&freedObjects, 1, memory_order_relaxed);
+}
+
+static void readerThread(void *arg) {
+    struct ReclaimBenchmarkContext *context = arg;
+    size_t corrupted = 0;
+
+    for (int i = 0; i < READS; ++i) {
+        struct SharedObject *object;
+        if (context->hazard != NULL) {
+            object = protectHazardPointerDomain(context->hazard, 0, (void *const *) &context->shared);
+            corrupted += object->check != ~object->value;
+            clearHazardPointerDomain(context->hazard, 0);
+        } else {
+            enterEpochDomain(context->epoch);
+            object = atomic_load(&context->shared);
+            corrupted += object->check != ~object->value;
+            exitEpochDomain(context->epoch);
+        }
+    }
+    atomic_fetch_add(&context->corrupted, corrupted);
+    decreaseCountDownLatch(context->readers);
+}
+
+/**
+ * Replace the shared object and retire the old one until the readers are done, then scan for the last ones.
+ */
+static void writerThread(void *arg) {
+    struct ReclaimBenchmarkContext *context = arg;
+    size_t writes = 0;
+
+    while (!atomic_load(&context->stop)) {
+        struct SharedObject *object = atomic_exchange(&context->shared, newSharedObject(writes));
+        if (context->hazard != NULL) {
+            retireHazardPointerDomain(context->hazard, object, deleteSharedObject);
+        } else {
+            retireEpochDomain(context->epoch, object, deleteSharedObject);
+        }
+        writes += 1;
+    }
+
+    if (context->hazard != NULL) {
+        reclaimHazardPointerDomain(context->hazard);
+    } else {
+        reclaimEpochDomain(context->epoch);
+    }
+    context->writes = writes;
+    decreaseCountDownLatch(context->writer);
+}
+
+static void benchmarkDomain(int readers, bool hazard) {
+    struct ReclaimBenchmarkContext context = {
+            .readers = newCountDownLatch(readers),
+            .writer = newCountDownLatch(1),
+            .epoch = hazard ? NULL : newEpochDomain(),
+            .hazard = hazard ? newHazardPointerDomain(1) : NULL,
+            .shared = newSharedObject(0),
+    };
+    atomic_store(&freedObjects, 0);
+    ExecutorService *pool = newFixedThreadPoolExecutor(readers + 1, -1, "reclaim-%d", newLinkedBlockingQueue);
+
+    struct timeval s, t;
+    gettimeofday(&s, NULL);
+    pool->submit(pool, writerThread, &context);
+    for (int i = 0; i < readers; ++i) {
+        pool->submit(pool, readerThread, &context);
+    }
+    awaitCountDownLatch(context.readers, -1);
+    gettimeofday(&t, NULL);
+    atomic_store(&context.stop, true);
+    awaitCountDownLatch(context.writer, -1);
+
+    // the readers are done, so the final scan of the hazard domain frees every retired object, while the epoch
+    // domain may keep the objects of the last epochs until it is freed
+    double dur = (double) (t.tv_sec - s.tv_sec) * 1000.0 + (double) (t.tv_usec - s.tv_usec) / 1000.0;
+    printf("> %-6s readers = %d: %f mops reads, %zu writes, %zu unreclaimed, %zu corrupted\n",
+           hazard ? "hazard" : "epoch", readers, (double) readers * READS / dur / 1000.0, context.writes,
+           context.writes - atomic_load(&freedObjects), context.corrupted);
+
+    pool->free(pool);
+    if (hazard) {
+        freeHazardPointerDomain(context.hazard);
+    } else {
+        freeEpochDomain(context.epoch);
+    }
+    free(context.shared);
+    freeCountDownLatch(context.readers);
+    freeCountDownLatch(context.writer);
+}
+
+void benchmarkReclamation() {
+    printf("> reclamation benchmark\n");
+    for (int readers = 1; readers <= MAX_READERS; readers <<= 1) {
+        benchmarkDomain(readers, false);
+        benchmarkDomain(readers, true);
+    }
+}
@@ -0,0 +1,356 @@
+#include "SharedMemoryQueue.h"
+#include "benchmark.h"
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_ITEM_SIZES 16
+#define MAX_NAMES 16
+
+struct SharedMemoryOptions {
+    const struct Transport *transports[MAX_NAMES];
+    size_t transportSize;
+    size_t itemSizes[MAX_ITEM_SIZES];
+    size_t itemSizeSize;
+    size_t capacity;
+    size_t batch;
+    size_t operations;
+    size_t warmup;
+    size_t repetitions;
+    BenchmarkFormat format;
+};
+
+/**
+ * The state shared by the producer process and the consumer process, mapped before the fork.
+ */
+struct SharedRun {
+    pthread_barrier_t barrier;
+    bool attached;
+    uint64_t start;
+    uint64_t end;
+    size_t received;
+    Histogram latency;
+};
+
+/**
+ * A transport moves `operations` items of `itemSize` bytes from the parent to a forked child. `run` returns
+ * false if the transport could not be set up.
+ */
+struct Transport {
+    const char *name;
+
+    bool (*run)(const struct SharedMemoryOptions *options, size_t itemSize, struct SharedRun *shared);
+};
+
+/**
+ * Every item starts with the clock of its send, one item per batch is stamped; the monotonic clock is the same
+ * in both processes.
+ */
+inline static void stampItem(char *item, size_t index, size_t batch) {
+    uint64_t stamp = index % batch == 0 ? nowNanos() : 0;
+    memcpy(item, &stamp, sizeof(stamp));
+}
+
+inline static void receiveItem(struct SharedRun *shared, const char *item) {
+    uint64_t stamp;
+    memcpy(&stamp, item, sizeof(stamp));
+    if (stamp != 0) {
+        recordHistogram(&shared->latency, nowNanos() - stamp);
+    }
+    shared->received += 1;
+}
+
+/**
+ * Wait for the child at the barrier and start the clock, the child stops it after the last item.
+ */
+inline static void startRun(struct SharedRun *shared) {
+    pthread_barrier_wait(&shared->barrier);
+    shared->start = nowNanos();
+}
+
+inline static bool waitChild(pid_t child) {
+    int status;
+    return waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* shm: the SharedMemoryQueue, the child attaches by name */
+
+static bool runSharedMemory(const struct SharedMemoryOptions *options, size_t itemSize, struct SharedRun *shared) {
+    char name[64];
+    snprintf(name, sizeof(name), "/zutil-benchmark-%d", (int) getpid());
+    unlinkSharedMemoryQueue(name);
+    BlockingQueue *queue = createSharedMemoryQueue(name, options->capacity, itemSize);
+    if (queue == NULL) {
+        return false;
+    }
+
+    char *item = calloc(1, itemSize);
+    pid_t child = fork();
+    if (child == 0) {
+        // drop the mapping inherited from the parent, and map the queue as an unrelated process would
+        queue->free(queue);
+        queue = attachSharedMemoryQueue(name);
+        shared->attached = queue != NULL;
+        pthread_barrier_wait(&shared->barrier);
+        for (size_t i = 0; queue != NULL && i < options->operations; ++i) {
+            queue->poll(queue, item, -1);
+            receiveItem(shared, item);
+        }
+        shared->end = nowNanos();
+        _exit(queue == NULL ? 1 : 0);
+    }
+
+    if (child > 0) {
+        startRun(shared);
+        for (size_t i = 0; shared->attached && i < options->operations; ++i) {
+            stampItem(item, i, options->batch);
+            queue->offer(queue, item, -1);
+        }
+    }
+    bool success = child > 0 && waitChild(child);
+
+    free(item);
+    queue->free(queue);
+    unlinkSharedMemoryQueue(name);
+    return success;
+}
+
+/* pipe: one write and one read of a whole item per operation, the baseline */
+
+static bool readFully(int fd, char *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(fd, buffer, size);
+        if (n <= 0) {
+            return false;
+        }
+        buffer += n;
+        size -= (size_t) n;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const char *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, buffer, size);
+        if (n <= 0) {
+            return false;
+        }
+        buffer += n;
+        size -= (size_t) n;
+    }
+    return true;
+}
+
+static bool runPipe(const struct SharedMemoryOptions *options, size_t itemSize, struct SharedRun *shared) {
+    int fds[2];
+    if (pipe(fds)) {
+        return false;
+    }
+
+    char *item = calloc(1, itemSize);
+    pid_t child = fork();
+    if (child == 0) {
+        close(fds[1]);
+        pthread_barrier_wait(&shared->barrier);
+        bool valid = true;
+        for (size_t i = 0; valid && i < options->operations; ++i) {
+            if ((valid = readFully(fds[0], item, itemSize))) {
+                receiveItem(shared, item);
+            }
+        }
+        shared->end = nowNanos();
+        _exit(valid ? 0 : 1);
+    }
+
+    close(fds[0]);
+    if (child > 0) {
+        startRun(shared);
+        for (size_t i = 0; i < options->operations; ++i) {
+            stampItem(item, i, options->batch);
+            writeFully(fds[1], item, itemSize);
+        }
+    }
+    close(fds[1]);
+    bool success = child > 0 && waitChild(child);
+
+    free(item);
+    return success;
+}
+
+static const struct Transport TRANSPORTS[] = {
+        {"shm",  runSharedMemory},
+        {"pipe", runPipe},
+};
+
+static const size_t TRANSPORT_SIZE = sizeof(TRANSPORTS) / sizeof(TRANSPORTS[0]);
+
+static void benchmarkTransport(BenchmarkReport *report, const struct SharedMemoryOptions *options,
+                               const struct Transport *transport, size_t itemSize) {
+    struct SharedRun *shared = mmap(NULL, sizeof(struct SharedRun), PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        fprintf(stderr, "failed to map the shared state\n");
+        return;
+    }
+
+    for (size_t i = 0; i < options->warmup + options->repetitions; ++i) {
+        pthread_barrierattr_t attr;
+        pthread_barrierattr_init(&attr);
+        pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_barrier_init(&shared->barrier, &attr, 2);
+        pthread_barrierattr_destroy(&attr);
+        shared->received = 0;
+        resetHistogram(&shared->latency);
+
+        bool success = transport->run(options, itemSize, shared);
+        pthread_barrier_destroy(&shared->barrier);
+        if (!success || shared->received != options->operations) {
+            fprintf(stderr, "%s failed, %zu of %zu items received\n", transport->name, shared->received,
+                    options->operations);
+            break;
+        }
+        if (i < options->warmup) {
+            continue;
+        }
+
+        Histogram *latency = &shared->latency;
+        double mops = (double) options->operations / ((double) (shared->end - shared->start) / 1000.0);
+        addBenchmarkReportRow(report, "%s|%zu|%zu|%zu|%.3f|%llu|%llu|%llu|%llu",
+                              transport->name, itemSize, options->batch, i - options->warmup, mops,
+                              (unsigned long long) percentileHistogram(latency, 50.0),
+                              (unsigned long long) percentileHistogram(latency, 99.0),
+                              (unsigned long long) percentileHistogram(latency, 99.9),
+                              (unsigned long long) latency->max);
+    }
+
+    munmap(shared, sizeof(struct SharedRun));
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -t, --transport NAMES     transports, comma separated (default: all)\n"
+            "  -s, --item-size BYTES     item sizes, at least 8, comma separated (default: 8,64,512)\n"
+            "  -C, --capacity N          shared memory queue capacity in items (default: 1024)\n"
+            "  -b, --batch N             operations per clock read for latency sampling (default: 1)\n"
+            "  -n, --operations N        items sent from the parent to the child (default: 1000000)\n"
+            "  -w, --warmup N            warmup runs which are not reported (default: 1)\n"
+            "  -r, --repetitions N       reported runs (default: 3)\n"
+            "  -f, --format FORMAT       text, csv or json (default: text)\n"
+            "\n"
+            "One producer process sends to one consumer process created by fork().\n", program);
+    fprintf(stderr, "transports:");
+    for (size_t i = 0; i < TRANSPORT_SIZE; ++i) {
+        fprintf(stderr, " %s", TRANSPORTS[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+static bool parseTransports(char *text, struct SharedMemoryOptions *options) {
+    const char *names[MAX_NAMES];
+    options->transportSize = parseNameList(text, names, MAX_NAMES);
+    for (size_t i = 0; i < options->transportSize; ++i) {
+        options->transports[i] = NULL;
+        for (size_t j = 0; j < TRANSPORT_SIZE; ++j) {
+            if (strcmp(TRANSPORTS[j].name, names[i]) == 0) {
+                options->transports[i] = &TRANSPORTS[j];
+            }
+        }
+        if (options->transports[i] == NULL) {
+            return false;
+        }
+    }
+    return options->transportSize > 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct SharedMemoryOptions options = {
+            .itemSizes = {8, 64, 512},
+            .itemSizeSize = 3,
+            .capacity = 1024,
+            .batch = 1,
+            .operations = 1000000,
+            .warmup = 1,
+            .repetitions = 3,
+            .format = BENCHMARK_FORMAT_TEXT,
+    };
+    for (size_t i = 0; i < TRANSPORT_SIZE && i < MAX_NAMES; ++i) {
+        options.transports[options.transportSize++] = &TRANSPORTS[i];
+    }
+
+    static const struct option longOptions[] = {
+            {"transport",   required_argument, NULL, 't'},
+            {"item-size",   required_argument, NULL, 's'},
+            {"capacity",    required_argument, NULL, 'C'},
+            {"batch",       required_argument, NULL, 'b'},
+            {"operations",  required_argument, NULL, 'n'},
+            {"warmup",      required_argument, NULL, 'w'},
+            {"repetitions", required_argument, NULL, 'r'},
+            {"format",      required_argument, NULL, 'f'},
+            {"help",        no_argument,       NULL, 'h'},
+            {NULL, 0,                          NULL, 0},
+    };
+
+    int opt;
+    bool valid = true;
+    while (valid && (opt = getopt_long(argc, argv, "t:s:C:b:n:w:r:f:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                valid = parseTransports(optarg, &options);
+                break;
+            case 's':
+                options.itemSizeSize = parseSizeList(optarg, options.itemSizes, MAX_ITEM_SIZES);
+                valid = options.itemSizeSize > 0;
+                break;
+            case 'C':
+                options.capacity = strtoull(optarg, NULL, 10);
+                valid = options.capacity > 0;
+                break;
+            case 'b':
+                options.batch = strtoull(optarg, NULL, 10);
+                valid = options.batch > 0;
+                break;
+            case 'n':
+                options.operations = strtoull(optarg, NULL, 10);
+                break;
+            case 'w':
+                options.warmup = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                options.repetitions = strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                valid = parseBenchmarkFormat(optarg, &options.format);
+                break;
+            default:
+                valid = false;
+                break;
+        }
+    }
+    for (size_t i = 0; valid && i < options.itemSizeSize; ++i) {
+        valid = options.itemSizes[i] >= sizeof(uint64_t);
+    }
+    if (!valid || optind < argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    static const char *const columns[] = {"transport", "item_size", "batch", "run", "mops", "p50_ns", "p99_ns",
+                                          "p999_ns", "max_ns"};
+    BenchmarkReport report;
+    beginBenchmarkReport(&report, stdout, options.format, columns, sizeof(columns) / sizeof(columns[0]));
+
+    for (size_t t = 0; t < options.transportSize; ++t) {
+        for (size_t s = 0; s < options.itemSizeSize; ++s) {
+            benchmarkTransport(&report, &options, options.transports[t], options.itemSizes[s]);
+        }
+    }
+
+    endBenchmarkReport(&report);
+    return 0;
+}
@@ -0,0 +1,463 @@
+#include "ReentrantLock.h"
+#include "Condition.h"
+#include "CountDownLatch.h"
+#include "ThreadLocal.h"
+#include "benchmark.h"
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_THREAD_COUNTS 16
+#define MAX_NAMES 16
+
+struct SynchronizerOptions {
+    const struct Scenario *scenarios[MAX_NAMES];
+    size_t scenarioSize;
+    size_t threads[MAX_THREAD_COUNTS];
+    size_t threadSize;
+    size_t operations;
+    size_t batch;
+    size_t warmup;
+    size_t repetitions;
+    BenchmarkFormat format;
+};
+
+struct SynchronizerRun {
+    const struct SynchronizerOptions *options;
+    size_t threads;
+
+    /* results */
+    Histogram latency;
+    size_t operations;
+    uint64_t elapsed;
+};
+
+/**
+ * A scenario runs once and fills the results of the run. ns/op is elapsed / operations.
+ */
+struct Scenario {
+    const char *name;
+    bool usesThreads;
+
+    void (*run)(struct SynchronizerRun *run);
+};
+
+/**
+ * Keep the results of the measured calls alive.
+ */
+static volatile uintptr_t sink;
+
+/**
+ * Record the cost per operation of a batch, the clock is read once per batch.
+ */
+inline static void recordBatch(Histogram *latency, uint64_t start, size_t batch) {
+    recordHistogram(latency, (nowNanos() - start) / batch);
+}
+
+/* lock: lock + unlock pairs, with one increment in the critical region */
+
+struct LockContext {
+    ReentrantLock *lock;
+    pthread_barrier_t *barrier;
+    size_t operations;
+    size_t batch;
+    size_t counter;
+    Histogram latency;
+};
+
+static void *lockThread(void *arg) {
+    struct LockContext *context = arg;
+    ReentrantLock *lock = context->lock;
+    size_t batch = context->batch;
+    Histogram *latency = malloc(sizeof(Histogram));
+    resetHistogram(latency);
+
+    pthread_barrier_wait(context->barrier);
+    for (size_t i = 0; i < context->operations; i += batch) {
+        uint64_t start = nowNanos();
+        for (size_t j = 0; j < batch; ++j) {
+            lockReentrantLock(lock);
+            context->counter += 1;
+            unlockReentrantLock(lock);
+        }
+        recordBatch(latency, start, batch);
+    }
+    pthread_barrier_wait(context->barrier);
+
+    lockReentrantLock(lock);
+    mergeHistogram(&context->latency, latency);
+    unlockReentrantLock(lock);
+    free(latency);
+    return NULL;
+}
+
+static void runLock(struct SynchronizerRun *run, size_t threads) {
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    struct LockContext *context = calloc(1, sizeof(struct LockContext));
+    context->lock = newReentrantLock();
+    context->barrier = &barrier;
+    context->batch = run->options->batch;
+    context->operations = run->options->operations / threads / context->batch * context->batch;
+    context->operations = context->operations == 0 ? context->batch : context->operations;
+
+    for (size_t i = 0; i < threads; ++i) {
+        pthread_create(&tids[i], NULL, lockThread, context);
+    }
+    pthread_barrier_wait(&barrier);
+    uint64_t start = nowNanos();
+    pthread_barrier_wait(&barrier);
+    run->elapsed = nowNanos() - start;
+    for (size_t i = 0; i < threads; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    run->operations = context->operations * threads;
+    mergeHistogram(&run->latency, &context->latency);
+
+    freeReentrantLock(context->lock);
+    free(context);
+    free(tids);
+    pthread_barrier_destroy(&barrier);
+}
+
+static void runLockUncontended(struct SynchronizerRun *run) {
+    runLock(run, 1);
+}
+
+static void runLockContended(struct SynchronizerRun *run) {
+    runLock(run, run->threads);
+}
+
+/* condition ping-pong: a round trip is signal + await on both sides */
+
+struct PingPongContext {
+    ReentrantLock *lock;
+    Condition *ping;
+    Condition *pong;
+    int turn;
+    size_t rounds;
+};
+
+static void *pongThread(void *arg) {
+    struct PingPongContext *context = arg;
+    lockReentrantLock(context->lock);
+    for (size_t i = 0; i < context->rounds; ++i) {
+        while (context->turn != 1) {
+            awaitCondition(context->ping, -1);
+        }
+        context->turn = 0;
+        signalCondition(context->pong);
+    }
+    unlockReentrantLock(context->lock);
+    return NULL;
+}
+
+static void runConditionPingPong(struct SynchronizerRun *run) {
+    struct PingPongContext context = {.turn = 0, .rounds = run->options->operations / 10};
+    context.rounds = context.rounds == 0 ? 1 : context.rounds;
+    context.lock = newReentrantLock();
+    context.ping = newCondition(context.lock);
+    context.pong = newCondition(context.lock);
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, pongThread, &context);
+
+    uint64_t begin = nowNanos();
+    lockReentrantLock(context.lock);
+    for (size_t i = 0; i < context.rounds; ++i) {
+        uint64_t start = nowNanos();
+        context.turn = 1;
+        signalCondition(context.ping);
+        while (context.turn != 0) {
+            awaitCondition(context.pong, -1);
+        }
+        recordHistogram(&run->latency, nowNanos() - start);
+    }
+    unlockReentrantLock(context.lock);
+    run->elapsed = nowNanos() - begin;
+    run->operations = context.rounds;
+
+    pthread_join(tid, NULL);
+    freeCondition(context.pong);
+    freeCondition(context.ping);
+    freeReentrantLock(context.lock);
+}
+
+/* latch release: the time from the count down to the wakeup of each waiter */
+
+struct LatchContext {
+    pthread_barrier_t barrier;
+    CountDownLatch *latch;
+    uint64_t released;
+    uint64_t lastWakeup;
+    size_t rounds;
+};
+
+struct LatchWaiter {
+    struct LatchContext *context;
+    Histogram latency;
+};
+
+static void *latchWaiter(void *arg) {
+    struct LatchWaiter *waiter = arg;
+    struct LatchContext *context = waiter->context;
+
+    for (size_t i = 0; i < context->rounds; ++i) {
+        pthread_barrier_wait(&context->barrier);
+        awaitCountDownLatch(context->latch, -1);
+        uint64_t now = nowNanos();
+        recordHistogram(&waiter->latency, now - context->released);
+
+        uint64_t last = atomic_load(&context->lastWakeup);
+        while (now > last && !atomic_compare_exchange_weak(&context->lastWakeup, &last, now));
+        pthread_barrier_wait(&context->barrier);
+    }
+    return NULL;
+}
+
+/**
+ * ns/op is the time until the last waiter wakes up, the percentiles are per waiter.
+ */
+static void runLatchRelease(struct SynchronizerRun *run) {
+    size_t waiters = run->threads;
+    struct LatchContext context = {.rounds = run->options->operations / 10000};
+    context.rounds = context.rounds == 0 ? 1 : context.rounds;
+    pthread_barrier_init(&context.barrier, NULL, waiters + 1);
+    pthread_t *tids = malloc(sizeof(pthread_t) * waiters);
+    struct LatchWaiter *contexts = calloc(waiters, sizeof(struct LatchWaiter));
+    for (size_t i = 0; i < waiters; ++i) {
+        contexts[i].context = &context;
+        pthread_create(&tids[i], NULL, latchWaiter, &contexts[i]);
+    }
+
+    // give the waiters time to park before the release
+    struct timespec park = {.tv_sec = 0, .tv_nsec = 200000};
+    run->elapsed = 0;
+    for (size_t i = 0; i < context.rounds; ++i) {
+        context.latch = newCountDownLatch(1);
+        atomic_store(&context.lastWakeup, 0);
+        pthread_barrier_wait(&context.barrier);
+        nanosleep(&park, NULL);
+
+        context.released = nowNanos();
+        decreaseCountDownLatch(context.latch);
+        pthread_barrier_wait(&context.barrier);
+        run->elapsed += atomic_load(&context.lastWakeup) - context.released;
+        freeCountDownLatch(context.latch);
+    }
+    run->operations = context.rounds;
+
+    for (size_t i = 0; i < waiters; ++i) {
+        pthread_join(tids[i], NULL);
+        mergeHistogram(&run->latency, &contexts[i].latency);
+    }
+    pthread_barrier_destroy(&context.barrier);
+    free(contexts);
+    free(tids);
+}
+
+/* thread local: get and computeIfAbsent of a value which is present */
+
+static void *newValue(void *arg) {
+    return arg;
+}
+
+static void runThreadLocal(struct SynchronizerRun *run, bool compute) {
+    ThreadLocal threadLocal;
+    initThreadLocal(&threadLocal);
+    setThreadLocal(&threadLocal, run, NULL);
+
+    size_t batch = run->options->batch;
+    size_t operations = run->options->operations / batch * batch;
+    operations = operations == 0 ? batch : operations;
+    uintptr_t sum = 0;
+    uint64_t begin = nowNanos();
+    for (size_t i = 0; i < operations; i += batch) {
+        uint64_t start = nowNanos();
+        if (compute) {
+            for (size_t j = 0; j < batch; ++j) {
+                sum += (uintptr_t) computeIfAbsentThreadLocal(&threadLocal, newValue, run, NULL);
+            }
+        } else {
+            for (size_t j = 0; j < batch; ++j) {
+                sum += (uintptr_t) getThreadLocal(&threadLocal);
+            }
+        }
+        recordBatch(&run->latency, start, batch);
+    }
+    run->elapsed = nowNanos() - begin;
+    run->operations = operations;
+    sink = sum;
+
+    destroyThreadLocal(&threadLocal);
+}
+
+static void runThreadLocalGet(struct SynchronizerRun *run) {
+    runThreadLocal(run, false);
+}
+
+static void runThreadLocalCompute(struct SynchronizerRun *run) {
+    runThreadLocal(run, true);
+}
+
+static const struct Scenario SCENARIOS[] = {
+        {"lock-uncontended",     false, runLockUncontended},
+        {"lock-contended",       true,  runLockContended},
+        {"condition-ping-pong",  false, runConditionPingPong},
+        {"latch-release",        true,  runLatchRelease},
+        {"thread-local-get",     false, runThreadLocalGet},
+        {"thread-local-compute", false, runThreadLocalCompute},
+};
+
+static const size_t SCENARIO_SIZE = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+static void benchmarkSynchronizer(BenchmarkReport *report, struct SynchronizerRun *run,
+                                  const struct Scenario *scenario) {
+    const struct SynchronizerOptions *options = run->options;
+    for (size_t i = 0; i < options->warmup + options->repetitions; ++i) {
+        resetHistogram(&run->latency);
+        scenario->run(run);
+        if (i < options->warmup) {
+            continue;
+        }
+
+        Histogram *latency = &run->latency;
+        addBenchmarkReportRow(report, "%s|%zu|%zu|%zu|%.2f|%llu|%llu|%llu|%llu",
+                              scenario->name, scenario->usesThreads ? run->threads : 1, i - options->warmup,
+                              run->operations, (double) run->elapsed / (double) run->operations,
+                              (unsigned long long) percentileHistogram(latency, 50.0),
+                              (unsigned long long) percentileHistogram(latency, 99.0),
+                              (unsigned long long) percentileHistogram(latency, 99.9),
+                              (unsigned long long) latency->max);
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -S, --scenario NAMES      scenarios, comma separated (default: all)\n"
+            "  -t, --threads COUNTS      contending threads or latch waiters, comma separated (default: 2,4)\n"
+            "  -n, --operations N        operations per run (default: 1000000), ping-pong runs a tenth\n"
+            "                            and latch-release one round per 10000\n"
+            "  -b, --batch N             operations per clock read for lock and thread local (default: 64)\n"
+            "  -w, --warmup N            warmup runs which are not reported (default: 1)\n"
+            "  -r, --repetitions N       reported runs (default: 3)\n"
+            "  -f, --format FORMAT       text, csv or json (default: text)\n"
+            "\n"
+            "The percentiles are per operation averaged over a batch for lock and thread local, per round trip\n"
+            "for condition-ping-pong, and per waiter wakeup for latch-release.\n", program);
+    fprintf(stderr, "scenarios:");
+    for (size_t i = 0; i < SCENARIO_SIZE; ++i) {
+        fprintf(stderr, " %s", SCENARIOS[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+static bool parseScenarios(char *text, struct SynchronizerOptions *options) {
+    const char *names[MAX_NAMES];
+    options->scenarioSize = parseNameList(text, names, MAX_NAMES);
+    for (size_t i = 0; i < options->scenarioSize; ++i) {
+        options->scenarios[i] = NULL;
+        for (size_t j = 0; j < SCENARIO_SIZE; ++j) {
+            if (strcmp(SCENARIOS[j].name, names[i]) == 0) {
+                options->scenarios[i] = &SCENARIOS[j];
+            }
+        }
+        if (options->scenarios[i] == NULL) {
+            return false;
+        }
+    }
+    return options->scenarioSize > 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct SynchronizerOptions options = {
+            .threads = {2, 4},
+            .threadSize = 2,
+            .operations = 1000000,
+            .batch = 64,
+            .warmup = 1,
+            .repetitions = 3,
+            .format = BENCHMARK_FORMAT_TEXT,
+    };
+    for (size_t i = 0; i < SCENARIO_SIZE && i < MAX_NAMES; ++i) {
+        options.scenarios[options.scenarioSize++] = &SCENARIOS[i];
+    }
+
+    static const struct option longOptions[] = {
+            {"scenario",    required_argument, NULL, 'S'},
+            {"threads",     required_argument, NULL, 't'},
+            {"operations",  required_argument, NULL, 'n'},
+            {"batch",       required_argument, NULL, 'b'},
+            {"warmup",      required_argument, NULL, 'w'},
+            {"repetitions", required_argument, NULL, 'r'},
+            {"format",      required_argument, NULL, 'f'},
+            {"help",        no_argument,       NULL, 'h'},
+            {NULL, 0,                          NULL, 0},
+    };
+
+    int opt;
+    bool valid = true;
+    while (valid && (opt = getopt_long(argc, argv, "S:t:n:b:w:r:f:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'S':
+                valid = parseScenarios(optarg, &options);
+                break;
+            case 't':
+                options.threadSize = parseSizeList(optarg, options.threads, MAX_THREAD_COUNTS);
+                valid = options.threadSize > 0;
+                break;
+            case 'n':
+                options.operations = strtoull(optarg, NULL, 10);
+                break;
+            case 'b':
+                options.batch = strtoull(optarg, NULL, 10);
+                valid = options.batch > 0;
+                break;
+            case 'w':
+                options.warmup = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                options.repetitions = strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                valid = parseBenchmarkFormat(optarg, &options.format);
+                break;
+            default:
+                valid = false;
+                break;
+        }
+    }
+    for (size_t i = 0; valid && i < options.threadSize; ++i) {
+        valid = options.threads[i] > 0;
+    }
+    if (!valid || optind < argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    static const char *const columns[] = {"scenario", "threads", "run", "ops", "ns_per_op", "p50_ns", "p99_ns",
+                                          "p999_ns", "max_ns"};
+    BenchmarkReport report;
+    beginBenchmarkReport(&report, stdout, options.format, columns, sizeof(columns) / sizeof(columns[0]));
+
+    struct SynchronizerRun *run = calloc(1, sizeof(struct SynchronizerRun));
+    run->options = &options;
+    for (size_t s = 0; s < options.scenarioSize; ++s) {
+        // scenarios without threads run once
+        size_t threadSize = options.scenarios[s]->usesThreads ? options.threadSize : 1;
+        for (size_t t = 0; t < threadSize; ++t) {
+            run->threads = options.threads[t];
+            benchmarkSynchronizer(&report, run, options.scenarios[s]);
+        }
+    }
+    free(run);
+
+    endBenchmarkReport(&report);
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "BlockingQueue.hpp"
+#include "ExecutorService.hpp"
+#include "Synchronizer.hpp"
+#include "LinkedBlockingQueue.h"
+
+#include <cstdio>
+#include <string>
+
+/*
+ * The C++17 wrappers are header only, this example keeps them compiling against the C API and runs them once.
+ */
+int main() {
+    constexpr int count = 1000;
+
+    // a C queue under trivially copyable items, a ring of slots of the wrapper under the others
+    zutil::BlockingQueue<int> numbers(64, newLinkedBlockingQueue);
+    zutil::BlockingQueue<std::string> names(64);
+    zutil::CountDownLatch latch(2);
+
+    long long sum = 0;
+    size_t offered = 0;
+    size_t length = 0;
+    {
+        zutil::ExecutorService executor = zutil::ExecutorService::fixed(4);
+        executor.submit([&] {
+            for (int i = 1; i <= count; ++i) {
+                numbers.offer(i);
+            }
+            numbers.close();
+        });
+        executor.submit([&] {
+            for (int i = 1; i <= count; ++i) {
+                std::string name = std::to_string(i);
+                offered += name.size();
+                names.offer(std::move(name));
+            }
+            names.close();
+        });
+        executor.submit([&] {
+            while (std::optional<int> number = numbers.poll()) {
+                sum += *number;
+            }
+            latch.countDown();
+        });
+        executor.submit([&] {
+            std::string name;
+            while (names.poll(name)) {
+                length += name.size();
+            }
+            latch.countDown();
+        });
+        latch.await();
+    }
+
+    printf("sum %lld, length %zu\n", sum, length);
+    return sum == (long long) count * (count + 1) / 2 && length == offered ? 0 : 1;
+}
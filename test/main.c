@@ -1,17 +1,54 @@
 #include "FixedThreadPoolExecutor.h"
+#include "ScheduledThreadPoolExecutor.h"
+#include "CachedThreadPoolExecutor.h"
 #include "LinkedBlockingQueue.h"
 #include "ArrayBlockingQueue.h"
+#include "PriorityBlockingQueue.h"
+#include "DelayQueue.h"
+#include "SynchronousQueue.h"
+#include "SegmentedBlockingQueue.h"
+#include "ShardedBlockingQueue.h"
+#include "ExecutorCompletionService.h"
+#include "Actor.h"
+#include "Pipeline.h"
+#include "CountDownLatch.h"
+#include "ByteRingBuffer.h"
+#include "Disruptor.h"
+#include "LockProfiler.h"
 
+#include <pthread.h>
+#include <sched.h>
 #include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include <sys/epoll.h>
 #include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
 
 void executorExample();
 void arrayBlockingQueueExample();
 void linkedBlockingQueueExample();
-void benchmarkArrayBlockingQueue();
-void benchmarkLinkedBlockingQueue();
+void segmentedBlockingQueueExample();
+void shardedBlockingQueueExample();
+void pollAnyExample();
+void priorityQueueExample();
+void delayQueueExample();
+void synchronousQueueExample();
+void closeExample();
+void eventFdExample();
+void actorExample();
+void pipelineExample();
+void workerExample();
+void scheduledExecutorExample();
+void byteRingBufferExample();
+void disruptorExample();
+void benchmarkConcurrentHashMap();
+void benchmarkObjectPool();
+void benchmarkReclamation();
 
 void blockingQueueExample(BlockingQueue *queue, int queueSize);
 
@@ -19,8 +56,27 @@ int main() {
     executorExample();
     arrayBlockingQueueExample();
     linkedBlockingQueueExample();
-    benchmarkArrayBlockingQueue();
-    benchmarkLinkedBlockingQueue();
+    segmentedBlockingQueueExample();
+    shardedBlockingQueueExample();
+    pollAnyExample();
+    priorityQueueExample();
+    delayQueueExample();
+    synchronousQueueExample();
+    closeExample();
+    eventFdExample();
+    actorExample();
+    pipelineExample();
+    workerExample();
+    scheduledExecutorExample();
+    byteRingBufferExample();
+    disruptorExample();
+    benchmarkConcurrentHashMap();
+    benchmarkObjectPool();
+    benchmarkReclamation();
+
+    if (isLockProfilingEnabled()) {
+        dumpLockProfiles(stdout, LOCK_PROFILE_ORDER_WAIT_TIME);
+    }
 }
 
 void foo(void *arg) {
@@ -68,6 +124,7 @@ void linkedBlockingQueueExample() {
     printf("> linked blocking queue test\n");
     int queueSize = 12;
     BlockingQueue *queue = newLinkedBlockingQueue(queueSize, sizeof(int));
+    profileBlockingQueue(queue, "linked-example");
     blockingQueueExample(queue, queueSize);
     queue->free(queue);
 
@@ -78,10 +135,437 @@ void linkedBlockingQueueExample() {
     }
 }
 
+void segmentedBlockingQueueExample() {
+    printf("> segmented blocking queue test\n");
+    BlockingQueue *queue = newSegmentedBlockingQueue(BLOCKING_QUEUE_UNBOUNDED, sizeof(int));
+    profileBlockingQueue(queue, "segmented-example");
+
+    // the items span several segments, the drained ones are recycled
+    int itemCount = 5000;
+    for (int i = 0; i < itemCount; ++i) {
+        queue->offer(queue, &i, -1);
+    }
+    int inOrder = 0;
+    int item;
+    while (queue->poll(queue, &item, 0)) {
+        inOrder += item == inOrder;
+    }
+    printf("polled %d of %d items in order\n", inOrder, itemCount);
+    queue->free(queue);
+}
+
+void shardedBlockingQueueExample() {
+    printf("> sharded blocking queue test\n");
+
+    // the lanes split the queue of the executor, each worker polls its home lane first
+    int taskFinish = 0;
+    ExecutorService *pool = newFixedThreadPoolExecutor(4, 1024, "sharded-%d", newShardedBlockingQueue);
+    for (int i = 0; i < 100000; ++i) {
+        if (!pool->submit(pool, foo, &taskFinish)) {
+            foo(&taskFinish);
+        }
+    }
+    pool->shutdown(pool);
+    printf("number of finished tasks = %d\n", taskFinish);
+    pool->free(pool);
+}
+
+void pollAnyExample() {
+    printf("> poll any test\n");
+    BlockingQueue *queues[] = {
+            newArrayBlockingQueue(4, sizeof(int)),
+            newLinkedBlockingQueue(4, sizeof(int)),
+    };
+    const char *names[] = {"control", "bulk"};
+
+    for (int i = 0; i < 2; ++i) {
+        queues[1]->offer(queues[1], &i, -1);
+    }
+    int control = 100;
+    queues[0]->offer(queues[0], &control, -1);
+
+    // the control queue goes first with the priority order
+    size_t index = 0;
+    int item;
+    while (pollAnyBlockingQueue(queues, 2, &index, &item, 100, POLL_ANY_PRIORITY)) {
+        printf("pollAny() = %d from %s\n", item, names[index]);
+    }
+    printf("timeout (100 ms): pollAny() = null\n");
+
+    for (int i = 0; i < 2; ++i) {
+        queues[i]->free(queues[i]);
+    }
+}
+
+void sleepTask(void *arg) {
+    struct timespec interval = {.tv_sec = 0, .tv_nsec = 100000000};
+    nanosleep(&interval, NULL);
+}
+
+void closeExample() {
+    printf("> close test\n");
+    BlockingQueue *queue = newLinkedBlockingQueue(4, sizeof(int));
+    for (int i = 0; i < 2; ++i) {
+        queue->offer(queue, &i, -1);
+    }
+
+    // the items offered before close are still polled, then poll fails without waiting
+    queue->close(queue);
+    int item = -1;
+    if (!queue->offer(queue, &item, -1)) {
+        printf("closed: queue->offer(%d) fails\n", item);
+    }
+    while (queue->poll(queue, &item, -1)) {
+        printf("queue.poll() = %d\n", item);
+    }
+    printf("closed and empty: queue->poll() = null\n");
+    queue->free(queue);
+
+    // shutdownNow returns the tasks which never ran
+    ExecutorService *pool = newFixedThreadPoolExecutor(1, BLOCKING_QUEUE_UNBOUNDED, "close-%d", newLinkedBlockingQueue);
+    for (int i = 0; i < 4; ++i) {
+        pool->submit(pool, sleepTask, NULL);
+    }
+    size_t size;
+    Runnable *pending = pool->shutdownNow(pool, &size);
+    printf("shutdownNow() returns %zu pending tasks\n", size);
+    free(pending);
+    pool->free(pool);
+}
+
+void squareTask(void *arg) {
+    int *x = arg;
+    *x = *x * *x;
+}
+
+void eventFdExample() {
+    printf("> eventfd test\n");
+    BlockingQueue *queue = newLinkedBlockingQueue(BLOCKING_QUEUE_UNBOUNDED, sizeof(int));
+    QueueEventFd *queueEvent = newQueueEventFd(queue);
+    ExecutorService *pool = newFixedThreadPoolExecutor(2, 16, "event-%d", newLinkedBlockingQueue);
+    ExecutorCompletionService *service = newExecutorCompletionService(pool);
+    QueueEventFd *completionEvent = getExecutorCompletionServiceEventFd(service);
+
+    int epoll = epoll_create1(0);
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = queueEvent};
+    epoll_ctl(epoll, EPOLL_CTL_ADD, getQueueEventFd(queueEvent), &event);
+    event.data.ptr = completionEvent;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, getQueueEventFd(completionEvent), &event);
+
+    // three items make the queue readable once, three tasks complete on the pool
+    int squares[] = {2, 3, 4};
+    for (int i = 0; i < 3; ++i) {
+        queue->offer(queue, &i, -1);
+        submitExecutorCompletionService(service, squareTask, &squares[i]);
+    }
+
+    int received = 0;
+    while (received < 6) {
+        struct epoll_event ready[2];
+        int n = epoll_wait(epoll, ready, 2, 1000);
+        for (int i = 0; i < n; ++i) {
+            // reset before draining, an offer after it makes the eventfd readable again
+            resetQueueEventFd(ready[i].data.ptr);
+            if (ready[i].data.ptr == queueEvent) {
+                int item;
+                while (queue->poll(queue, &item, 0)) {
+                    printf("event loop: queue.poll() = %d\n", item);
+                    received += 1;
+                }
+            } else {
+                Runnable task;
+                while (pollExecutorCompletionService(service, &task, 0)) {
+                    printf("event loop: task completed, result = %d\n", *(int *) task.arg);
+                    received += 1;
+                }
+            }
+        }
+        if (n <= 0) {
+            break;
+        }
+    }
+
+    close(epoll);
+    pool->shutdown(pool);
+    freeExecutorCompletionService(service);
+    pool->free(pool);
+    freeQueueEventFd(queueEvent);
+    queue->free(queue);
+}
+
+/**
+ * A token passed around a ring of actors, each actor forwards it to the next one.
+ */
+struct Token {
+    ActorMessage header;
+    int hops;
+};
+
+struct RingActor {
+    Actor *next;
+    CountDownLatch *done;
+};
+
+void receiveToken(void *state, ActorMessage *message) {
+    struct RingActor *self = state;
+    struct Token *token = (struct Token *) message;
+    if (--token->hops == 0) {
+        decreaseCountDownLatch(self->done);
+    } else {
+        sendActor(self->next, &token->header);
+    }
+}
+
+void actorExample() {
+    printf("> actor test\n");
+    int actorCount = 100000;
+    int tokenCount = 16;
+    int hops = 100000;
+    ExecutorService *pool = newFixedThreadPoolExecutor(4, BLOCKING_QUEUE_UNBOUNDED, "actor-%d", newLinkedBlockingQueue);
+    CountDownLatch *done = newCountDownLatch(tokenCount);
+
+    // the actors own no thread, a hundred thousand of them share the pool
+    struct RingActor *states = calloc(actorCount, sizeof(struct RingActor));
+    Actor **actors = calloc(actorCount, sizeof(Actor *));
+    for (int i = 0; i < actorCount; ++i) {
+        actors[i] = newActor(pool, receiveToken, &states[i], 32);
+    }
+    for (int i = 0; i < actorCount; ++i) {
+        states[i].next = actors[(i + 1) % actorCount];
+        states[i].done = done;
+    }
+
+    struct timeval tv0;
+    gettimeofday(&tv0, NULL);
+    struct Token *tokens = calloc(tokenCount, sizeof(struct Token));
+    for (int i = 0; i < tokenCount; ++i) {
+        tokens[i].hops = hops;
+        sendActor(actors[i * (actorCount / tokenCount)], &tokens[i].header);
+    }
+    awaitCountDownLatch(done, -1);
+
+    struct timeval tv1;
+    gettimeofday(&tv1, NULL);
+    double diff = (double) (tv1.tv_sec - tv0.tv_sec) * 1000.0 + (double) (tv1.tv_usec - tv0.tv_usec) / 1000.0;
+    printf("%d actors, %d messages, elapsed time = %f ms\n", actorCount, tokenCount * hops, diff);
+
+    pool->shutdown(pool);
+    for (int i = 0; i < actorCount; ++i) {
+        freeActor(actors[i]);
+    }
+    pool->free(pool);
+    freeCountDownLatch(done);
+    free(tokens);
+    free(actors);
+    free(states);
+}
+
+void *parseStage(void *item, void *arg) {
+    return (void *) ((uintptr_t) item * 2);
+}
+
+void *sumStage(void *item, void *arg) {
+    atomic_fetch_add((long *) arg, (long) (uintptr_t) item);
+    return NULL;
+}
+
+void pipelineExample() {
+    printf("> pipeline test\n");
+    long sum = 0;
+    PipelineStageConfig stages[] = {
+            {.name = "parse", .process = parseStage, .parallelism = 2, .capacity = 256, .batchSize = 32},
+            {.name = "sum", .process = sumStage, .arg = &sum, .parallelism = 1, .builder = newLinkedBlockingQueue,
+                    .capacity = 256, .batchSize = 64},
+    };
+    Pipeline *pipeline = newPipeline(stages, 2, 10);
+
+    int itemCount = 100000;
+    for (int i = 1; i <= itemCount; ++i) {
+        submitPipeline(pipeline, (void *) (uintptr_t) i, -1);
+    }
+    PipelineStageStats stats[2];
+    getPipelineStats(pipeline, stats);
+    for (int i = 0; i < 2; ++i) {
+        printf("stage %s: threads = %zu, depth = %lld, processed = %lld, %.0f items/s\n", stats[i].name,
+               stats[i].threads, stats[i].depth, stats[i].processed, stats[i].throughput);
+    }
+
+    // shutdown waits until every item went through the stages
+    shutdownPipeline(pipeline);
+    printf("sum = %ld\n", sum);
+    freePipeline(pipeline);
+}
+
+void onWorkerStart(Worker *worker, void *arg) {
+    atomic_fetch_add((int *) arg, 1);
+}
+
+void onWorkerStop(Worker *worker, void *arg) {
+    atomic_fetch_sub((int *) arg, 1);
+}
+
+void scratchTask(void *arg) {
+    long *counts = arg;
+    Worker *worker = currentWorker();
+
+    // scratch memory without malloc, reclaimed when the task returns
+    char *buffer = allocateWorkerArena(worker, 1024);
+    memset(buffer, 0, 1024);
+
+    // the worker id indexes per-worker data, no atomic needed
+    counts[getWorkerId(worker)] += 1;
+}
+
+void workerExample() {
+    printf("> worker test\n");
+    size_t threadSize = 4;
+    int liveWorkers = 0;
+    long counts[4] = {0};
+    WorkerHooks hooks = {.onStart = onWorkerStart, .onStop = onWorkerStop, .arg = &liveWorkers, .arenaSize = 4096};
+    ExecutorService *pool = newFixedThreadPoolExecutorWithHooks(threadSize, BLOCKING_QUEUE_UNBOUNDED, "worker-%d",
+                                                                newLinkedBlockingQueue, &hooks);
+    for (int i = 0; i < 100000; ++i) {
+        pool->submit(pool, scratchTask, counts);
+    }
+    pool->shutdown(pool);
+
+    long total = 0;
+    for (size_t i = 0; i < threadSize; ++i) {
+        printf("worker %zu ran %ld tasks\n", i, counts[i]);
+        total += counts[i];
+    }
+    printf("total = %ld, live workers after shutdown = %d\n", total, liveWorkers);
+    pool->free(pool);
+}
+
+void tickTask(void *arg) {
+    printf("tick %d\n", atomic_fetch_add((int *) arg, 1));
+}
+
+void timeoutTask(void *arg) {
+    printf("timeout fired\n");
+}
+
+void scheduledExecutorExample() {
+    printf("> scheduled executor test\n");
+    ScheduledExecutorService *scheduler = newScheduledThreadPoolExecutor(2, BLOCKING_QUEUE_UNBOUNDED, "timer-%d",
+                                                                         newLinkedBlockingQueue, 1);
+
+    // a heartbeat every 100 ms, a timeout which fires, and one cancelled before its delay
+    int ticks = 0;
+    uint64_t heartbeat = scheduler->scheduleAtFixedRate(scheduler, tickTask, &ticks, 0, 100);
+    scheduler->schedule(scheduler, timeoutTask, NULL, 250);
+    uint64_t timeout = scheduler->schedule(scheduler, timeoutTask, NULL, 1000);
+    if (scheduler->cancel(scheduler, timeout)) {
+        printf("cancelled the 1000 ms timeout\n");
+    }
+
+    struct timespec interval = {.tv_sec = 0, .tv_nsec = 350000000};
+    nanosleep(&interval, NULL);
+    scheduler->cancel(scheduler, heartbeat);
+    scheduler->parent.free(&scheduler->parent);
+}
+
+int compareInt(const void *a, const void *b) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return x < y ? -1 : x > y;
+}
+
+void priorityQueueExample() {
+    printf("> priority blocking queue test\n");
+    BlockingQueue *queue = newPriorityBlockingQueue(BLOCKING_QUEUE_UNBOUNDED, sizeof(int), compareInt);
+    int items[] = {5, 1, 4, 2, 3};
+    for (int i = 0; i < 5; ++i) {
+        queue->offer(queue, &items[i], -1);
+    }
+    int item;
+    while (queue->poll(queue, &item, 0)) {
+        printf("queue.poll() = %d\n", item);
+    }
+    queue->free(queue);
+}
+
+/**
+ * An item of the delay queue, which carries its deadline.
+ */
+struct DelayedMessage {
+    uint64_t deadline;
+    const char *text;
+};
+
+uint64_t messageDeadline(const void *item) {
+    return ((const struct DelayedMessage *) item)->deadline;
+}
+
+void delayQueueExample() {
+    printf("> delay queue test\n");
+    BlockingQueue *queue = newDelayQueue(BLOCKING_QUEUE_UNBOUNDED, sizeof(struct DelayedMessage), messageDeadline);
+    struct DelayedMessage messages[] = {
+            {deadlineDelayQueue(200), "after 200 ms"},
+            {deadlineDelayQueue(100), "after 100 ms"},
+    };
+    for (int i = 0; i < 2; ++i) {
+        queue->offer(queue, &messages[i], -1);
+    }
+
+    struct DelayedMessage message;
+    if (!queue->poll(queue, &message, 0)) {
+        printf("no deadline expired: queue->poll() = null\n");
+    }
+    while (queue->poll(queue, &message, 1000)) {
+        printf("queue.poll() = %s\n", message.text);
+    }
+    queue->free(queue);
+}
+
+void *handoffConsumer(void *arg) {
+    BlockingQueue *queue = arg;
+    int item;
+    while (queue->poll(queue, &item, -1)) {
+        printf("queue.poll() = %d\n", item);
+    }
+    return NULL;
+}
+
+void synchronousQueueExample() {
+    printf("> synchronous queue test\n");
+    BlockingQueue *queue = newSynchronousQueue(0, sizeof(int));
+
+    // nobody waits, the item cannot be handed off
+    int item = 0;
+    if (!queue->offer(queue, &item, 0)) {
+        printf("no consumer: queue->offer(0) fails\n");
+    }
+
+    // every offer returns once the consumer took the item
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, handoffConsumer, queue);
+    for (item = 1; item <= 3; ++item) {
+        queue->offer(queue, &item, -1);
+    }
+    queue->close(queue);
+    pthread_join(consumer, NULL);
+    queue->free(queue);
+
+    // the cached pool starts a thread only when no idle one takes the task
+    int taskFinish = 0;
+    ExecutorService *pool = newCachedThreadPoolExecutor(4, 1000, "cached-%d");
+    for (int i = 0; i < 1000; ++i) {
+        while (!pool->submit(pool, foo, &taskFinish)) {
+            sched_yield();
+        }
+    }
+    pool->shutdown(pool);
+    printf("number of finished tasks = %d\n", taskFinish);
+    pool->free(pool);
+}
+
 void arrayBlockingQueueExample() {
     printf("> array blocking queue test\n");
     int queueSize = 12;
     BlockingQueue *queue = newArrayBlockingQueue(queueSize, sizeof(int));
+    profileBlockingQueue(queue, "array-example");
     blockingQueueExample(queue, queueSize);
     queue->free(queue);
 }
@@ -110,4 +594,65 @@ void blockingQueueExample(BlockingQueue *queue, int queueSize) {
     if (!queue->poll(queue, &num, 1000)) {
         printf("timeout (1000 ms): queue->poll() = null\n");
     }
-}
\ No newline at end of file
+}
+void byteRingBufferExample() {
+    printf("> byte ring buffer test\n");
+    ByteRingBuffer *ring = newByteRingBuffer(256);
+
+    // copy a record, or reserve the space and write the record in place
+    const char *hello = "hello";
+    offerByteRingBuffer(ring, hello, strlen(hello), -1);
+    const char *world = "world, written in place";
+    char *record = reserveByteRingBuffer(ring, strlen(world), -1);
+    memcpy(record, world, strlen(world));
+    commitByteRingBuffer(ring, record);
+
+    if (reserveByteRingBuffer(ring, maxRecordByteRingBuffer(ring) + 1, 0) == NULL) {
+        printf("record longer than %zu bytes is rejected\n", maxRecordByteRingBuffer(ring));
+    }
+
+    ByteRecord records[8];
+    size_t size = pollByteRingBuffer(ring, records, 8, -1);
+    for (size_t i = 0; i < size; ++i) {
+        printf("ring.poll() = %.*s\n", (int) records[i].length, (const char *) records[i].data);
+    }
+    releaseByteRingBuffer(ring);
+
+    if (pollByteRingBuffer(ring, records, 8, 100) == 0) {
+        printf("timeout (100 ms): ring.poll() = null\n");
+    }
+    freeByteRingBuffer(ring);
+}
+
+void disruptorExample() {
+    printf("> disruptor test\n");
+    Disruptor *disruptor = newDisruptor(16, sizeof(int));
+
+    // process sees an entry after both journal and replicate released it
+    DisruptorConsumer *journal = addConsumerDisruptor(disruptor, NULL, 0);
+    DisruptorConsumer *replicate = addConsumerDisruptor(disruptor, NULL, 0);
+    DisruptorConsumer *dependencies[] = {journal, replicate};
+    DisruptorConsumer *process = addConsumerDisruptor(disruptor, dependencies, 2);
+
+    uint64_t first;
+    claimDisruptor(disruptor, 3, &first, -1);
+    for (int i = 0; i < 3; ++i) {
+        *(int *) entryDisruptor(disruptor, first + i) = i;
+    }
+    publishDisruptor(disruptor, first, 3);
+
+    size_t size = waitForDisruptorConsumer(journal, &first, -1);
+    printf("journal sees %zu entries from %d\n", size, *(int *) entryDisruptor(disruptor, first));
+    releaseDisruptorConsumer(journal, size);
+
+    if (waitForDisruptorConsumer(process, &first, 100) == 0) {
+        printf("timeout (100 ms): process waits for replicate\n");
+    }
+
+    size = waitForDisruptorConsumer(replicate, &first, -1);
+    releaseDisruptorConsumer(replicate, size);
+    size = waitForDisruptorConsumer(process, &first, -1);
+    printf("process sees %zu entries after journal and replicate\n", size);
+    releaseDisruptorConsumer(process, size);
+    freeDisruptor(disruptor);
+}